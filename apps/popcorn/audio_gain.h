@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_AUDIO_GAIN_H
+#define _POPCORN_AUDIO_GAIN_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Gain (volume) for interleaved 16 bit stereo, ramped linearly from one value to another over a buffer, so that
+// volume changes don't cause zipper noise. Gains are 16.16 fixed point, with AUDIO_GAIN_UNITY being full volume.
+//
+// These are plain inline functions (no SDK dependencies) so that gain_bench can check and time them on the host.
+
+#define AUDIO_GAIN_UNITY 0x10000
+
+// ramp across count stereo frames
+static inline int32_t audio_gain_step(int32_t from, int32_t to, uint32_t count) {
+    return (to - from) / (int32_t) count;
+}
+
+static inline uint32_t audio_gain_scale(uint32_t sample, int32_t gain) {
+#if __ARM_FEATURE_DSP
+    // both halves with a 32x16 multiply each, and pack them back together
+    int32_t l, r;
+    uint32_t out;
+    __asm ("smulwb %0, %1, %2" : "=r" (l) : "r" (gain), "r" (sample));
+    __asm ("smulwt %0, %1, %2" : "=r" (r) : "r" (gain), "r" (sample));
+    __asm ("pkhbt %0, %1, %2, lsl #16" : "=r" (out) : "r" (l), "r" (r));
+    return out;
+#else
+    // note we only use the top 8 fractional bits of the gain, so as not to overflow 32 bits
+    int32_t g = gain >> 8;
+    int32_t l = ((int16_t) sample * g) >> 8;
+    int32_t r = (((int32_t) sample >> 16) * g) >> 8;
+    return (uint16_t) l | (((uint32_t) r) << 16u);
+#endif
+}
+
+// apply gain (ramping by step per frame) to count frames in place
+static inline void audio_gain_apply(uint32_t *samples, uint32_t count, int32_t gain, int32_t step) {
+    if (!step) {
+        if (gain == AUDIO_GAIN_UNITY) return;
+        if (!gain) {
+            // muted; no need to multiply anything
+            memset(samples, 0, count * 4);
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        samples[i] = audio_gain_scale(samples[i], gain);
+        gain += step;
+    }
+}
+
+// reverse the order of the frames in s1[0, count) and s2[0, count) into each other (i.e. s1[i] <-> s2[count - 1 - i]),
+// applying the gain ramp (as it is after the reversal) at the same time; gain1 and gain2 are the gains for the
+// first frame of s1 and s2 respectively
+static inline void audio_gain_reverse(uint32_t *s1, uint32_t *s2, uint32_t count, int32_t gain1, int32_t gain2,
+                                      int32_t step) {
+    if (!step && gain1 == gain2) {
+        if (!gain1) {
+            memset(s1, 0, count * 4);
+            memset(s2, 0, count * 4);
+            return;
+        }
+        if (gain1 == AUDIO_GAIN_UNITY) {
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t tmp = s1[i];
+                s1[i] = s2[count - 1 - i];
+                s2[count - 1 - i] = tmp;
+            }
+            return;
+        }
+    }
+    gain2 += step * (int32_t) (count - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t tmp = s1[i];
+        s1[i] = audio_gain_scale(s2[count - 1 - i], gain1);
+        s2[count - 1 - i] = audio_gain_scale(tmp, gain2);
+        gain1 += step;
+        gain2 -= step;
+    }
+}
+
+#endif
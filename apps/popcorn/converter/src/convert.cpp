@@ -12,7 +12,11 @@
 #include <set>
 #include <functional>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
+#include "platypus_2x1.h"
+#include "pl2.h"
 
 // add a word at the end of every row with debug information
 // #define ADD_EOR_DEBUGGING
@@ -571,6 +575,157 @@ bool compress_image(const char *name, uint w, uint h, std::vector<unsigned char>
 
 #endif
 
+// 2x1 variant (PL2_FORMAT_2X1): each row coded separately, see platypus_2x1.h. tolerance is the largest error (per 5 bit
+// channel) we accept from runs and deltas; 0 is lossless (after dithering).
+#ifdef ENCODE_565
+#define RGB565 true
+#else
+#define RGB565 false
+#endif
+
+struct rgb5 {
+    int r, g, b;
+};
+
+static inline rgb5 pixel5(const uint8_t *p) {
+    return {p[0] >> 3, p[1] >> 3, p[2] >> 3};
+}
+
+static inline uint16_t pack5(rgb5 c) {
+    return to_5n5(c.r, c.g, c.b);
+}
+
+static inline int error5(rgb5 a, rgb5 b) {
+    return std::max({abs(a.r - b.r), abs(a.g - b.g), abs(a.b - b.b)});
+}
+
+// best delta token for b relative to a; returns the error
+static int choose_delta(rgb5 a, rgb5 b, uint8_t &token) {
+    int best = 0x7fffffff;
+    for (uint scale = 0; scale < 2; scale++) {
+        int ch_a[3] = {a.r, a.g, a.b};
+        int ch_b[3] = {b.r, b.g, b.b};
+        uint t = scale << 1u;
+        int worst = 0;
+        for (int ch = 0; ch < 3; ch++) {
+            int ch_best = 0x7fffffff;
+            uint ch_code = 0;
+            for (uint code = 0; code < 4; code++) {
+                int v = ch_a[ch] + platypus_2x1_channel_delta(code, scale);
+                if (v < 0 || v > 31) continue; // mustn't overflow into the next channel
+                if (abs(v - ch_b[ch]) < ch_best) {
+                    ch_best = abs(v - ch_b[ch]);
+                    ch_code = code;
+                }
+            }
+            t |= ch_code << (2u + 2u * ch);
+            worst = std::max(worst, ch_best);
+        }
+        if (worst < best) {
+            best = worst;
+            token = t;
+        }
+    }
+    return best;
+}
+
+static uint compress_row_2x1(uint w, const uint8_t *base, uint8_t *&d, uint tolerance) {
+    uint8_t *start = d;
+    uint16_t raw_flag = platypus_2x1_raw_flag(RGB565);
+    uint blocks = w / 2;
+    for (uint x = 0; x < blocks;) {
+        rgb5 a = pixel5(base + x * 6);
+        rgb5 b = pixel5(base + x * 6 + 3);
+        // a run of blocks close enough to the first pixel
+        uint n = 0;
+        while (x + n < blocks && n < 128 &&
+               error5(a, pixel5(base + (x + n) * 6)) <= (int) tolerance &&
+               error5(a, pixel5(base + (x + n) * 6 + 3)) <= (int) tolerance) {
+            n++;
+        }
+        uint8_t token = 0;
+        if (n) {
+            write_word(d, pack5(a));
+            *d++ = 1u | ((n - 1) << 1u);
+            x += n;
+        } else if (choose_delta(a, b, token) <= (int) tolerance) {
+            write_word(d, pack5(a));
+            *d++ = token;
+            x++;
+        } else {
+            write_word(d, raw_flag | pack5(a));
+            write_word(d, pack5(b));
+            x++;
+        }
+    }
+    while (3u & (uintptr_t)(d - start)) *d++ = 0; // need aligned rows
+    return d - start;
+}
+
+// check the row decodes to within tolerance of the source, and takes exactly the bytes we wrote (this is done even
+// in release builds, as it is what stops us writing a movie popcorn can't play)
+static void check_row_2x1(uint w, const uint8_t *base, const uint8_t *row, uint row_bytes, uint tolerance) {
+    static int16_t deltas[PLATYPUS_2X1_DELTA_COUNT];
+    static bool deltas_built;
+    if (!deltas_built) {
+        platypus_2x1_build_deltas(deltas, RGB565);
+        deltas_built = true;
+    }
+    std::vector<uint32_t> compressed((row_bytes + 3) / 4);
+    memcpy(compressed.data(), row, row_bytes);
+    std::vector<uint32_t> out(w / 2);
+    const uint32_t *end = platypus_2x1_decompress_row(out.data(), compressed.data(), w / 2, deltas,
+                                                      platypus_2x1_raw_flag(RGB565));
+    bool ok = end == compressed.data() + row_bytes / 4;
+    for (uint x = 0; x < w && ok; x++) {
+        uint p = (out[x / 2] >> (16u * (x & 1u))) & 0xffffu;
+        rgb5 decoded = {(int) (p & 0x1fu), (int) ((p >> GSHIFT) & 0x1fu), (int) ((p >> BSHIFT) & 0x1fu)};
+        ok = error5(decoded, pixel5(base + x * 3)) <= (int) tolerance;
+    }
+    if (!ok) {
+        fprintf(stderr, "2x1 row failed to decode correctly\n");
+        exit(-1);
+    }
+}
+
+static uint compress_image_2x1(uint w, uint h, std::vector<unsigned char> &source, std::vector<unsigned char> &dest,
+                               std::vector<uint32_t> &line_offsets, std::vector<uint8_t> &row_splits, uint tolerance) {
+    assert(!((w|h)&1u));
+    uint8_t *d = &dest[0];
+    line_offsets.clear();
+    row_splits.clear();
+    for(uint y=0; y < h; y+=2) {
+        uint8_t *base = &source[y * w * 3];
+        uint8_t *base2 = base + w * 3;
+        line_offsets.push_back(d - &dest[0]);
+        uint8_t *row0 = d;
+        uint row0_bytes = compress_row_2x1(w, base, d, tolerance);
+        uint8_t *row1 = d;
+        uint row1_bytes = compress_row_2x1(w, base2, d, tolerance);
+        assert(row0_bytes / 4 < 256);
+        row_splits.push_back(row0_bytes / 4);
+        check_row_2x1(w, base, row0, row0_bytes, tolerance);
+        check_row_2x1(w, base2, row1, row1_bytes, tolerance);
+    }
+    line_offsets.push_back(d - &dest[0]);
+    uint size = d - &dest[0];
+    while (d < dest.end().base()) *d++ = 0;
+    return size;
+}
+
+// the lowest tolerance at which the frame fits in budget bytes (or the highest we allow, if it doesn't)
+static uint compress_image_2x1_budget(uint w, uint h, std::vector<unsigned char> &source,
+                                      std::vector<unsigned char> &dest, std::vector<uint32_t> &line_offsets,
+                                      std::vector<uint8_t> &row_splits, uint budget, uint &tolerance) {
+    const uint max_tolerance = 6;
+    uint size;
+    for (tolerance = 0; ; tolerance++) {
+        size = compress_image_2x1(w, h, source, dest, line_offsets, row_splits, tolerance);
+        if (size <= budget || tolerance == max_tolerance) break;
+    }
+    return size;
+}
+
 void write_hword(uint word, FILE *out) {
     assert(word < 0x10000);
     fputc(word & 0xff, out);
@@ -588,36 +743,7 @@ uint8_t to_bcd(uint x) {
     return (x/10)*16 + (x%10);
 }
 
-#define PLAT_MAJOR 0
-#define PLAT_MINOR 60
-
-struct frame_header {
-    uint32_t mark0;
-    uint32_t mark1;
-    uint32_t magic;
-    uint8_t major, minior, debug, spare;
-    uint32_t sector_number; // relative to start of stream
-    uint32_t frame_number;
-    uint8_t hh, mm, ss, ff; // good old CD days (bcd)
-    uint32_t header_words;
-    uint16_t width;
-    uint16_t height;
-    uint32_t image_words;
-    uint32_t audio_words; // just to confirm really
-    uint32_t audio_freq;
-    uint8_t audio_channels; // always assume 16 bit
-    uint8_t pad[3];
-    uint32_t unused[4]; // little space for expansion
-    uint32_t total_sectors;
-    uint32_t last_sector;
-    // 1, 2, 4, 8 frame increments
-    uint32_t forward_frame_sector[4];
-    uint32_t backward_frame_sectors[4];
-    // h/2 + 1 row_offsets, last one should == image_words
-    uint16_t row_offsets[];
-} __attribute__((packed));
-
-int encode_movie(const char *filename, const char *audio_filename, const char *filename_out, int start_frame) {
+int encode_movie(const char *filename, const char *audio_filename, const char *filename_out, int start_frame, bool two_by_one) {
     worst_frame = 0;
     total_cost = 0;
     max_cost = 0;
@@ -639,6 +765,9 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
     std::vector<unsigned char> source;
     std::vector<unsigned char> dest;
     std::vector<uint32_t> line_offsets;
+    std::vector<uint8_t> row_splits;
+    uint tolerance_counts[7] = {0};
+    int over_budget = 0;
     line_offsets.resize(120);
     source.resize(size3);
     dest.resize(size2);
@@ -689,6 +818,18 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
         {
             worst_frame = i;
         }
+        if (two_by_one) {
+            // the same frame coded 2x2 sets the budget, so we get the full vertical detail in the same bandwidth
+            uint budget = line_offsets[h / 2];
+            uint tolerance;
+            uint size = compress_image_2x1_budget(w, h, source, dest, line_offsets, row_splits, budget, tolerance);
+            if (size > budget) {
+                printf("warning: frame %d is %d bytes coded 2x1 even at tolerance %d, over the 2x2 size of %d\n", i,
+                       size, tolerance, budget);
+                over_budget++;
+            }
+            tolerance_counts[tolerance]++;
+        }
         int fb = 0;
         uint32_t l = 0;
         for(uint32_t o : line_offsets)
@@ -732,9 +873,10 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
             static_assert(sizeof(header) <= 512);
             memset(&header, 0, sizeof(header));
             header.mark0 = header.mark1 = 0xffffffff;
-            header.magic = ('T' << 24) | ('A' << 16) | ('L' << 8) | 'P';
+            header.magic = PLATYPUS_MAGIC;
             header.major = PLAT_MAJOR;
             header.minior = PLAT_MINOR;
+            header.format = two_by_one ? PL2_FORMAT_2X1 : PL2_FORMAT_2X2;
 #ifdef ADD_EOR_DEBUGGING
             header.debug = 1;
 #endif
@@ -745,7 +887,7 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
             header.mm = to_bcd((n / (60 * 30)) % 60);
             header.ss = to_bcd((n / 30) % 60);
             header.ff = to_bcd(n % 30);
-            header.header_words = ((sizeof(header) + (h+1) + 1) + 3) / 4;
+            header.header_words = ((sizeof(header) + (h+1) + 1 + (two_by_one ? h / 2 : 0)) + 3) / 4;
             assert(header.header_words <= 128);
             for(int f=0;f<4;f++) {
                 header.forward_frame_sector[f] = header.backward_frame_sectors[f] = 0xffffffff;
@@ -771,6 +913,10 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
                 write_hword(off, file_out);
                 sector_offset += 2;
             }
+            if (two_by_one) {
+                fwrite(&row_splits[0], 1, h / 2, file_out);
+                sector_offset += h / 2;
+            }
             assert(sector_offset <= 0x200);
             sector_offset = pad_sector(sector_offset, file_out);
             if (audio_file)
@@ -805,10 +951,10 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
         fwrite(&total_sectors, 4, 1, file_out);
         uint32_t v;
         v = frame_sectors[frames-1]; fwrite(&v, 4, 1, file_out);
-        v = i < frames - 1 ? frame_sectors[i+1] : 0xffffffff; fwrite(&v, 4, 1, file_out);
-        v = i < frames - 2 ? frame_sectors[i+2] : 0xffffffff; fwrite(&v, 4, 1, file_out);
-        v = i < frames - 4 ? frame_sectors[i+4] : 0xffffffff; fwrite(&v, 4, 1, file_out);
-        v = i < frames - 8 ? frame_sectors[i+8] : 0xffffffff; fwrite(&v, 4, 1, file_out);
+        v = i + 1 < frames ? frame_sectors[i+1] : 0xffffffff; fwrite(&v, 4, 1, file_out);
+        v = i + 2 < frames ? frame_sectors[i+2] : 0xffffffff; fwrite(&v, 4, 1, file_out);
+        v = i + 4 < frames ? frame_sectors[i+4] : 0xffffffff; fwrite(&v, 4, 1, file_out);
+        v = i + 8 < frames ? frame_sectors[i+8] : 0xffffffff; fwrite(&v, 4, 1, file_out);
         v = i >= 1 ? frame_sectors[i-1] : 0xffffffff; fwrite(&v, 4, 1, file_out);
         v = i >= 2 ? frame_sectors[i-2] : 0xffffffff; fwrite(&v, 4, 1, file_out);
         v = i >= 4 ? frame_sectors[i-4] : 0xffffffff; fwrite(&v, 4, 1, file_out);
@@ -819,13 +965,23 @@ int encode_movie(const char *filename, const char *audio_filename, const char *f
     printf("last frame at %d\n", frame_sectors[frames-1]);
     printf("Worst frame %d mic %d mac %d avg %d maxl %d\n", worst_frame, min_cost, max_cost, (int)((total_cost * w * (long)h) / total_vals), worst_length);
     printf("%d %d %d, fbmax %d bfc %d/%ld\n", blcount, lcount, (int)(100l * blcount / lcount), fbmax, bfcount, frames);
+    if (two_by_one) {
+        printf("2x1 frames by tolerance:");
+        for (uint t = 0; t < sizeof(tolerance_counts) / sizeof(tolerance_counts[0]); t++) printf(" %d", tolerance_counts[t]);
+        printf(", over budget %d\n", over_budget);
+    }
     return 0;
 }
 
 int main(int argc, char **argv) {
+    bool two_by_one = argc > 1 && !strcmp(argv[1], "--2x1");
+    if (two_by_one) {
+        argc--;
+        argv++;
+    }
     if (argc != 4) {
-        fprintf(stderr, "usage: convert <rgb_file> <pcm_file> <output_file.pl2>\n");
+        fprintf(stderr, "usage: convert [--2x1] <rgb_file> <pcm_file> <output_file.pl2>\n");
         return -1;
     }
-    return encode_movie(argv[1], argv[2], argv[3], 0);
+    return encode_movie(argv[1], argv[2], argv[3], 0, two_by_one);
 }
@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/sd_card.h"
+#include "fat.h"
+
+// we read the FAT this many sectors at a time when walking cluster chains
+#define FAT_BUFFER_SECTORS ((FAT_SCRATCH_WORDS - 128) / 128)
+static_assert(FAT_BUFFER_SECTORS > 0, "");
+
+struct fat_volume {
+    bool exfat;
+    uint8_t sectors_per_cluster_shift;
+    uint32_t fat_sector;
+    uint32_t cluster_base_sector; // sector of cluster 2
+    uint32_t cluster_count;
+    uint32_t root_cluster;
+    uint32_t *dir_buffer;
+    uint32_t *fat_buffer;
+    uint32_t fat_buffer_sector;
+};
+
+// this is all init time stuff, and there isn't a lot of stack on the core doing it, so keep things out of the way
+static struct fat_volume volume;
+static struct dir_walk {
+    const char *extension;
+    fat_file_callback callback;
+    void *context;
+    struct fat_file file;
+    // FAT32 long file name
+    bool lfn_valid;
+    uint8_t lfn_checksum;
+    // exFAT file directory entry set
+    uint remaining_secondary_count;
+    uint name_length;
+    uint name_pos;
+    bool is_directory;
+    bool no_fat_chain;
+    uint32_t first_cluster;
+} walk;
+
+static inline uint16_t le16(const uint8_t *p) {
+    return p[0] | (p[1] << 8u);
+}
+
+static inline uint32_t le32(const uint8_t *p) {
+    return le16(p) | (le16(p + 2) << 16u);
+}
+
+static inline uint64_t le64(const uint8_t *p) {
+    return le32(p) | (((uint64_t) le32(p + 4)) << 32u);
+}
+
+static inline uint32_t cluster_sector(const struct fat_volume *v, uint32_t cluster) {
+    return v->cluster_base_sector + ((cluster - 2) << v->sectors_per_cluster_shift);
+}
+
+// returns 0 at the end of the chain (or if the chain is broken)
+static uint32_t next_cluster(struct fat_volume *v, uint32_t cluster) {
+    uint32_t sector = v->fat_sector + cluster / 128;
+    if (sector - v->fat_buffer_sector >= FAT_BUFFER_SECTORS) {
+        if (sd_readblocks_sync(v->fat_buffer, sector, FAT_BUFFER_SECTORS) < 0) {
+            v->fat_buffer_sector = -FAT_BUFFER_SECTORS;
+            return 0;
+        }
+        v->fat_buffer_sector = sector;
+    }
+    uint32_t next = v->fat_buffer[(sector - v->fat_buffer_sector) * 128 + (cluster & 127u)];
+    if (!v->exfat) next &= 0x0fffffff;
+    return next >= 2 && next < v->cluster_count + 2 ? next : 0;
+}
+
+static bool mount(struct fat_volume *v, uint32_t volume_sector, const uint8_t *b) {
+    if (le16(b + 510) != 0xaa55) return false;
+    if (!memcmp(b + 3, "EXFAT   ", 8)) {
+        if (b[0x6c] != 9) {
+            printf("exFAT volume @ %d does not use 512 byte sectors\n", (int) volume_sector);
+            return false;
+        }
+        v->exfat = true;
+        v->sectors_per_cluster_shift = b[0x6d];
+        v->fat_sector = volume_sector + le32(b + 0x50);
+        v->cluster_base_sector = volume_sector + le32(b + 0x58);
+        v->cluster_count = le32(b + 0x5c);
+        v->root_cluster = le32(b + 0x60);
+    } else if (!memcmp(b + 0x52, "FAT32   ", 8)) {
+        uint sectors_per_cluster = b[0x0d];
+        if (le16(b + 0x0b) != 512 || !sectors_per_cluster || (sectors_per_cluster & (sectors_per_cluster - 1))) {
+            printf("FAT32 volume @ %d has unsupported geometry\n", (int) volume_sector);
+            return false;
+        }
+        v->exfat = false;
+        v->sectors_per_cluster_shift = __builtin_ctz(sectors_per_cluster);
+        v->fat_sector = volume_sector + le16(b + 0x0e);
+        v->cluster_base_sector = v->fat_sector + b[0x10] * le32(b + 0x24);
+        uint32_t total_sectors = le16(b + 0x13) ? le16(b + 0x13) : le32(b + 0x20);
+        v->cluster_count = (total_sectors - (v->cluster_base_sector - volume_sector)) >> v->sectors_per_cluster_shift;
+        v->root_cluster = le32(b + 0x2c);
+    } else {
+        return false;
+    }
+    v->fat_buffer_sector = -FAT_BUFFER_SECTORS;
+    printf("Found %s volume @ %d\n", v->exfat ? "exFAT" : "FAT32", (int) volume_sector);
+    return true;
+}
+
+static void build_extents(struct fat_volume *v, struct fat_file *file, uint32_t first_cluster, bool no_fat_chain) {
+    file->extent_count = 0;
+    uint cluster_shift = 9 + v->sectors_per_cluster_shift;
+    uint32_t clusters = (uint32_t) ((file->size + (1u << cluster_shift) - 1) >> cluster_shift);
+    if (!clusters || first_cluster < 2) return;
+    if (no_fat_chain) {
+        // exFAT tells us directly that the file is contiguous
+        file->extents[0].sector = cluster_sector(v, first_cluster);
+        file->extents[0].sector_count = clusters << v->sectors_per_cluster_shift;
+        file->extent_count = 1;
+        return;
+    }
+    uint32_t cluster = first_cluster;
+    struct fat_extent *e = NULL;
+    for (uint32_t i = 0; i < clusters; i++) {
+        if (!cluster) {
+            printf("'%s' has a broken cluster chain\n", file->name);
+            file->extent_count = 0;
+            return;
+        }
+        uint32_t sector = cluster_sector(v, cluster);
+        if (e && e->sector + e->sector_count == sector) {
+            e->sector_count += 1u << v->sectors_per_cluster_shift;
+        } else {
+            if (file->extent_count == FAT_MAX_EXTENTS) {
+                // no point looking any further
+                file->extent_count++;
+                return;
+            }
+            e = &file->extents[file->extent_count++];
+            e->sector = sector;
+            e->sector_count = 1u << v->sectors_per_cluster_shift;
+        }
+        cluster = i + 1 < clusters ? next_cluster(v, cluster) : 0;
+    }
+}
+
+static bool has_extension(const char *name, const char *extension) {
+    size_t name_len = strlen(name);
+    size_t ext_len = strlen(extension);
+    if (name_len <= ext_len) return false;
+    name += name_len - ext_len;
+    for (size_t i = 0; i < ext_len; i++) {
+        char c = name[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c != extension[i]) return false;
+    }
+    return true;
+}
+
+static void found_file(struct fat_volume *v, struct dir_walk *w, uint32_t first_cluster, bool no_fat_chain) {
+    if (has_extension(w->file.name, w->extension)) {
+        build_extents(v, &w->file, first_cluster, no_fat_chain);
+        w->callback(&w->file, w->context);
+    }
+}
+
+static inline char name_char(uint16_t c) {
+    return c < 0x80 ? (char) c : '?';
+}
+
+static uint8_t short_name_checksum(const uint8_t *e) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t) (((sum & 1u) << 7u) + (sum >> 1u) + e[i]);
+    }
+    return sum;
+}
+
+// return false at the end of the directory
+static bool fat32_dir_entry(struct fat_volume *v, struct dir_walk *w, const uint8_t *e) {
+    if (!e[0]) return false;
+    if (e[0] == 0xe5) {
+        w->lfn_valid = false;
+        return true;
+    }
+    uint8_t attr = e[11];
+    if ((attr & 0x3f) == 0x0f) {
+        // long file name pieces precede the short entry, last piece first
+        static const uint8_t char_offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+        uint ordinal = e[0] & 0x1fu;
+        if (e[0] & 0x40) {
+            memset(w->file.name, 0, sizeof(w->file.name));
+            w->lfn_valid = true;
+            w->lfn_checksum = e[13];
+        } else if (!w->lfn_valid || e[13] != w->lfn_checksum) {
+            w->lfn_valid = false;
+            return true;
+        }
+        if (!ordinal) {
+            w->lfn_valid = false;
+            return true;
+        }
+        for (uint i = 0; i < count_of(char_offsets); i++) {
+            uint pos = (ordinal - 1) * 13 + i;
+            uint16_t c = le16(e + char_offsets[i]);
+            if (pos < FAT_MAX_NAME_LENGTH && c != 0xffff) {
+                w->file.name[pos] = name_char(c);
+            }
+        }
+        return true;
+    }
+    bool have_lfn = w->lfn_valid && w->lfn_checksum == short_name_checksum(e);
+    w->lfn_valid = false;
+    if (attr & 0x18) return true; // volume label or directory
+    if (!have_lfn) {
+        char *n = w->file.name;
+        for (int i = 0; i < 8 && e[i] != ' '; i++) *n++ = name_char(e[i]);
+        if (e[8] != ' ') {
+            *n++ = '.';
+            for (int i = 8; i < 11 && e[i] != ' '; i++) *n++ = name_char(e[i]);
+        }
+        *n = 0;
+    }
+    w->file.size = le32(e + 28);
+    found_file(v, w, (le16(e + 20) << 16u) | le16(e + 26), false);
+    return true;
+}
+
+// return false at the end of the directory
+static bool exfat_dir_entry(struct fat_volume *v, struct dir_walk *w, const uint8_t *e) {
+    switch (e[0]) {
+        case 0x00:
+            return false;
+        case 0x85: // file
+            w->remaining_secondary_count = e[1];
+            w->is_directory = le16(e + 4) & 0x10;
+            w->name_length = w->name_pos = 0;
+            memset(w->file.name, 0, sizeof(w->file.name));
+            return true;
+        case 0xc0: // stream extension
+            if (!w->remaining_secondary_count) return true;
+            w->no_fat_chain = e[1] & 2u;
+            w->name_length = e[3];
+            w->first_cluster = le32(e + 20);
+            w->file.size = le64(e + 24);
+            break;
+        case 0xc1: // file name
+            if (!w->remaining_secondary_count) return true;
+            for (uint i = 0; i < 15 && w->name_pos < w->name_length; i++, w->name_pos++) {
+                if (w->name_pos < FAT_MAX_NAME_LENGTH) {
+                    w->file.name[w->name_pos] = name_char(le16(e + 2 + i * 2));
+                }
+            }
+            break;
+        default:
+            // other in use secondary entries still count towards the set
+            if ((e[0] & 0xc0) != 0xc0 || !w->remaining_secondary_count) return true;
+            break;
+    }
+    if (!--w->remaining_secondary_count && !w->is_directory) {
+        found_file(v, w, w->first_cluster, w->no_fat_chain);
+    }
+    return true;
+}
+
+static void walk_root_directory(struct fat_volume *v, struct dir_walk *w) {
+    uint32_t cluster = v->root_cluster;
+    w->lfn_valid = false;
+    w->remaining_secondary_count = 0;
+    while (cluster >= 2) {
+        uint32_t sector = cluster_sector(v, cluster);
+        for (uint s = 0; s < (1u << v->sectors_per_cluster_shift); s++) {
+            if (sd_readblocks_sync(v->dir_buffer, sector + s, 1) < 0) {
+                printf("failed to read directory sector %d\n", (int) (sector + s));
+                return;
+            }
+            const uint8_t *b = (const uint8_t *) v->dir_buffer;
+            for (uint i = 0; i < 512; i += 32) {
+                if (!(v->exfat ? exfat_dir_entry(v, w, b + i) : fat32_dir_entry(v, w, b + i))) {
+                    return;
+                }
+            }
+        }
+        cluster = next_cluster(v, cluster);
+    }
+}
+
+int fat_find_files(uint32_t volume_sector, const char *extension, uint32_t *scratch, fat_file_callback callback,
+                   void *context) {
+    const uint8_t *b = (const uint8_t *) scratch;
+    volume.dir_buffer = scratch;
+    volume.fat_buffer = scratch + 128;
+    walk.extension = extension;
+    walk.callback = callback;
+    walk.context = context;
+    if (sd_readblocks_sync(scratch, volume_sector, 1) < 0) return 0;
+    if (mount(&volume, volume_sector, b)) {
+        walk_root_directory(&volume, &walk);
+        return 1;
+    }
+    if (volume_sector || le16(b + 510) != 0xaa55) return 0;
+    // MBR partitioned
+    uint32_t partition_sectors[4];
+    uint partition_count = 0;
+    for (uint i = 0; i < 4; i++) {
+        const uint8_t *p = b + 446 + i * 16;
+        uint8_t type = p[4];
+        // FAT32 CHS, FAT32 LBA, or exFAT/NTFS (which we tell apart from the boot sector)
+        if (type == 0x0b || type == 0x0c || type == 0x07) {
+            partition_sectors[partition_count++] = le32(p + 8);
+        }
+    }
+    int found = 0;
+    for (uint i = 0; i < partition_count; i++) {
+        if (sd_readblocks_sync(scratch, partition_sectors[i], 1) >= 0 &&
+            mount(&volume, partition_sectors[i], b)) {
+            walk_root_directory(&volume, &walk);
+            found++;
+        }
+    }
+    return found;
+}
+
+int gpt_find_partitions(uint32_t *scratch, gpt_partition_callback callback, void *context) {
+    const uint8_t *b = (const uint8_t *) scratch;
+    if (sd_readblocks_sync(scratch, 1, 1) < 0) return -1;
+    // todo crc
+    if (le64(b) != 0x5452415020494645ULL || le32(b + 12) != 92) return -1;
+    uint32_t table_sector = (uint32_t) le64(b + 72);
+    uint32_t table_count = le32(b + 80);
+    uint32_t entry_size = le32(b + 84);
+    // entries must not straddle sectors
+    if (entry_size < 128 || 512 % entry_size) return -1;
+    printf("Found GPT with %d entries at %d\n", (int) table_count, (int) table_sector);
+    int found = 0;
+    for (uint32_t i = 0; i < table_count; i++) {
+        uint32_t offset = (i * entry_size) % 512;
+        if (!offset && sd_readblocks_sync(scratch, table_sector + (i * entry_size) / 512, 1) < 0) break;
+        const uint8_t *entry = b + offset;
+        // unused entries have a zero partition type GUID
+        if (!le64(entry) && !le64(entry + 8)) continue;
+        struct gpt_partition partition;
+        partition.first_sector = (uint32_t) le64(entry + 32);
+        partition.sector_count = (uint32_t) (le64(entry + 40) + 1 - le64(entry + 32));
+        uint len;
+        for (len = 0; len < 36 && le16(entry + 56 + len * 2); len++) {
+            partition.name[len] = (char) le16(entry + 56 + len * 2);
+        }
+        partition.name[len] = 0;
+        callback(&partition, context);
+        found++;
+    }
+    return found;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_FAT_H
+#define _POPCORN_FAT_H
+
+#include "pico.h"
+
+// Minimal read-only GPT and FAT32/exFAT support; just enough to find movie files in the root directory of a card
+// formatted on a PC/Mac. All the work happens once at startup: each file's cluster chain is walked to build
+// an extent map. The player only accepts files which turn out to be a single contiguous extent, so that it
+// can keep issuing large multi-block reads straight from (start_sector + frame sector) with no per-cluster
+// lookups at playback time.
+
+#define FAT_MAX_NAME_LENGTH 63
+#define FAT_MAX_EXTENTS 8
+
+// scratch space needed by fat_find_files (a directory sector, and 8 sectors of FAT to make walking
+// the cluster chains of large files bearable)
+#define FAT_SCRATCH_WORDS (128 * 9)
+
+struct fat_extent {
+    uint32_t sector;
+    uint32_t sector_count;
+};
+
+struct fat_file {
+    char name[FAT_MAX_NAME_LENGTH + 1];
+    uint64_t size;
+    // if the file is more fragmented than FAT_MAX_EXTENTS we stop counting, and extent_count == FAT_MAX_EXTENTS + 1
+    uint extent_count;
+    struct fat_extent extents[FAT_MAX_EXTENTS];
+};
+
+// called for each file in the root directory with the matching extension (contiguous or not)
+typedef void (*fat_file_callback)(const struct fat_file *file, void *context);
+
+/**
+ * Look for a FAT32 or exFAT file system at volume_sector, or if volume_sector is 0 also via an MBR partition
+ * table at sector 0, and call the callback for every file in the root directory whose name ends in extension
+ * (case insensitive, e.g. ".pl2")
+ *
+ * \param volume_sector the first sector of the volume (or 0 to look for an MBR or "superfloppy" volume)
+ * \param extension the file extension to look for including the '.'
+ * \param scratch at least FAT_SCRATCH_WORDS words of scratch space
+ * \return the number of file systems scanned (i.e. 0 if none was found)
+ */
+int fat_find_files(uint32_t volume_sector, const char *extension, uint32_t *scratch, fat_file_callback callback,
+                   void *context);
+
+struct gpt_partition {
+    uint32_t first_sector;
+    uint32_t sector_count;
+    char name[37]; // ASCII-fied partition name
+};
+
+// called for each used GPT partition entry
+typedef void (*gpt_partition_callback)(const struct gpt_partition *partition, void *context);
+
+/**
+ * Look for a GPT partition table at sector 1 and call the callback for every used partition entry (a movie written
+ * raw into a partition, or a regular file system to pass to fat_find_files). The callback may do its own reads, but
+ * must not touch scratch.
+ *
+ * \param scratch at least 128 words of scratch space
+ * \return the number of partitions found, or -1 if there is no GPT
+ */
+int gpt_find_partitions(uint32_t *scratch, gpt_partition_callback callback, void *context);
+
+static inline bool fat_file_is_contiguous(const struct fat_file *file) {
+    return file->extent_count == 1;
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Checks the scanline_filter.h filters against a per channel reference, and times each of them per pair of 320 pixel
+// rows (i.e. per movie row). Exits with a non zero status if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scanline_filter.h"
+
+#define ROW_WORDS 160
+
+static int failures;
+
+static void fill(uint32_t *row, uint32_t words, unsigned seed) {
+    srand(seed);
+    for (uint32_t i = 0; i < words; i++) {
+        row[i] = (uint32_t) rand() ^ ((uint32_t) rand() << 16);
+    }
+    row[0] = 0xffff0000u;
+}
+
+static void channels(uint32_t p, bool rgb565, uint32_t c[3]) {
+    c[0] = p & 0x1f;
+    c[1] = (p >> 5) & (rgb565 ? 0x3f : 0x1f);
+    c[2] = (p >> (rgb565 ? 11 : 10)) & 0x1f;
+}
+
+static void check_pixel(const char *what, bool rgb565, uint32_t i, uint32_t in, uint32_t out, int num, int den) {
+    uint32_t ci[3], co[3];
+    channels(in, rgb565, ci);
+    channels(out, rgb565, co);
+    for (int c = 0; c < 3; c++) {
+        // the filters may round either way, so allow for that
+        uint32_t expected = ci[c] * num / den;
+        if (co[c] + 1 < expected || co[c] > expected + 1) {
+            if (failures++ < 10) {
+                printf("FAIL %s %s: pixel %d channel %d in %d out %d expected %d\n", what, rgb565 ? "565" : "555", i, c,
+                       ci[c], co[c], expected);
+            }
+        }
+    }
+    // 555 keeps the top bit clear
+    if (!rgb565 && (out & 0x8000)) {
+        if (failures++ < 10) printf("FAIL %s 555: pixel %d has the top bit set\n", what, i);
+    }
+}
+
+static void check_scale(const char *what, uint8_t ops, bool rgb565, int num, int den) {
+    uint32_t in[ROW_WORDS], row0[ROW_WORDS], row1[ROW_WORDS];
+    fill(in, ROW_WORDS, ops);
+    if (!rgb565) {
+        for (int i = 0; i < ROW_WORDS; i++) in[i] &= 0x7fff7fff;
+    }
+    memcpy(row0, in, sizeof(in));
+    memcpy(row1, in, sizeof(in));
+    scanline_filter_apply(ops, row0, row1, ROW_WORDS, NULL, rgb565);
+    bool first_row_too = !(ops & SCANLINE_FILTER_SCANLINES);
+    for (uint32_t i = 0; i < ROW_WORDS * 2; i++) {
+        uint32_t p = in[i / 2] >> (16 * (i & 1));
+        check_pixel(what, rgb565, i, p, row1[i / 2] >> (16 * (i & 1)), num, den);
+        if (first_row_too) {
+            check_pixel(what, rgb565, i, p, row0[i / 2] >> (16 * (i & 1)), num, den);
+        } else if (row0[i / 2] != in[i / 2]) {
+            if (failures++ < 10) printf("FAIL %s: first row changed at pixel %d\n", what, i);
+        }
+    }
+}
+
+static void check_lut(bool rgb565) {
+    struct scanline_filter_lut lut;
+    // an identity table must give back what went in
+    scanline_filter_build_lut(&lut, rgb565, 1.0f, 1.0f);
+    uint32_t in[ROW_WORDS], row0[ROW_WORDS], row1[ROW_WORDS];
+    fill(in, ROW_WORDS, 3);
+    if (!rgb565) {
+        for (int i = 0; i < ROW_WORDS; i++) in[i] &= 0x7fff7fff;
+    }
+    memcpy(row0, in, sizeof(in));
+    memcpy(row1, in, sizeof(in));
+    scanline_filter_apply(SCANLINE_FILTER_LUT, row0, row1, ROW_WORDS, &lut, rgb565);
+    if (memcmp(row0, in, sizeof(in)) || memcmp(row1, in, sizeof(in))) {
+        failures++;
+        printf("FAIL identity lut %s\n", rgb565 ? "565" : "555");
+    }
+    // and a brightening table must not wrap at the top
+    scanline_filter_build_lut(&lut, rgb565, 2.0f, 1.0f);
+    uint32_t white = rgb565 ? 0xffffffffu : 0x7fff7fffu;
+    row0[0] = white;
+    scanline_filter_lut_row(row0, 1, &lut);
+    if (row0[0] != white) {
+        failures++;
+        printf("FAIL bright lut %s: white became %08x\n", rgb565 ? "565" : "555", row0[0]);
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile uint32_t sink;
+
+static void time_ops(const char *what, uint8_t ops) {
+    static uint32_t row0[ROW_WORDS], row1[ROW_WORDS];
+    struct scanline_filter_lut lut;
+    scanline_filter_build_lut(&lut, true, 1.1f, 0.8f);
+    fill(row0, ROW_WORDS, 1);
+    fill(row1, ROW_WORDS, 2);
+    const int iterations = 200000;
+    double t0 = now();
+    for (int n = 0; n < iterations; n++) {
+        scanline_filter_apply(ops, row0, row1, ROW_WORDS, &lut, true);
+        sink += row0[n % ROW_WORDS];
+    }
+    double t = now() - t0;
+    printf("%-24s %8.1f ns/row pair\n", what, t * 1e9 / iterations);
+}
+
+int main(void) {
+    for (int rgb565 = 0; rgb565 < 2; rgb565++) {
+        check_scale("dim", SCANLINE_FILTER_DIM, rgb565, 1, 2);
+        check_scale("scanlines", SCANLINE_FILTER_SCANLINES, rgb565, 3, 4);
+        check_lut(rgb565);
+    }
+    printf("%s\n\n", failures ? "checks FAILED" : "checks passed");
+
+    time_ops("none", SCANLINE_FILTER_NONE);
+    time_ops("dim", SCANLINE_FILTER_DIM);
+    time_ops("scanlines", SCANLINE_FILTER_SCANLINES);
+    time_ops("lut", SCANLINE_FILTER_LUT);
+    time_ops("lut + scanlines", SCANLINE_FILTER_LUT | SCANLINE_FILTER_SCANLINES);
+    return failures ? 1 : 0;
+}
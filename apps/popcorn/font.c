@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "font.h"
+
+struct font *build_font(const lv_font_t *font, uint32_t width_words, bool rgb565) {
+    struct font *f = (struct font *) calloc(1, sizeof(struct font));
+    f->width_words = width_words;
+    f->height = font->line_height;
+
+    uint16_t colors[16];
+    for (int i = 0; i < 16; i++) {
+        if (rgb565) {
+            colors[i] = 0x41 * i + 0x800 * (i / 2);
+        } else {
+            colors[i] = 0x21 * i + 0x400 * (i / 2);
+        }
+    }
+    uint32_t font_size_words = font->line_height * width_words;
+    uint32_t *pixels = (uint32_t *) calloc(4, font->dsc->cmaps->range_length * font_size_words);
+    f->pixels = pixels;
+    f->glyph_words = f->width_words * f->height;
+    uint32_t *p = pixels;
+
+    for (int c = 0; c < font->dsc->cmaps->range_length; c++) {
+        // inefficient but simple
+        assert(p == f->pixels + c * f->glyph_words);
+        const lv_font_fmt_txt_glyph_dsc_t *g = &font->dsc->glyph_dsc[c + 1];
+        const uint8_t *b = font->dsc->glyph_bitmap + g->bitmap_index;
+        int bi = 0;
+        for (int y = 0; y < (int) f->height; y++) {
+            int ey = y - f->height + font->base_line + g->ofs_y + g->box_h;
+            for (int x = 0; x < (int) f->width_words * 2; x++) {
+                uint32_t pixel;
+                int ex = x - g->ofs_x;
+                if (ex >= 0 && ex < g->box_w && ey >= 0 && ey < g->box_h) {
+                    pixel = bi & 1 ? colors[b[bi >> 1] & 0xf] : colors[b[bi >> 1] >> 4];
+                    bi++;
+                } else {
+                    pixel = 0;
+                }
+                if (!(x & 1)) {
+                    *p = pixel;
+                } else {
+                    *p++ |= pixel << 16;
+                }
+            }
+            if (ey >= 0 && ey < g->box_h) {
+                for (int x = f->width_words * 2 - g->ofs_x; x < g->box_w; x++) {
+                    bi++;
+                }
+            }
+        }
+    }
+    return f;
+}
@@ -1,7 +1,8 @@
 #ifndef SOFTWARE_FONT_H
 #define SOFTWARE_FONT_H
 
-#include "pico.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 typedef struct {
     uint16_t bitmap_index;
@@ -35,4 +36,19 @@ extern const lv_font_t lcd12;
 extern const lv_font_t lcd18;
 
 #define LV_ATTRIBUTE_LARGE_CONST
+
+// a font rendered to fixed width glyphs of 16 bit pixels, ready to be copied into the menu overlay
+struct font {
+    uint32_t width_words;
+    uint32_t height;
+    uint32_t glyph_words; // == width_words * height;
+    const uint32_t *pixels;
+};
+
+// pre-rendered versions of the above (see font_gen), so we don't have to do this at startup
+extern const struct font font12_prebuilt;
+extern const struct font font18_prebuilt;
+
+struct font *build_font(const lv_font_t *font, uint32_t width_words, bool rgb565);
+
 #endif //SOFTWARE_FONT_H
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Generates font_prebuilt.c (the menu fonts rendered for both RGB555 and RGB565), so that popcorn doesn't have to
+// render them into RAM at startup. Run as: font_gen > ../font_prebuilt.c
+
+#include <stdio.h>
+#include "font.h"
+
+static void dump(const char *name, const lv_font_t *lv_font, uint32_t width_words, bool rgb565) {
+    struct font *f = build_font(lv_font, width_words, rgb565);
+    uint32_t words = lv_font->dsc->cmaps->range_length * f->glyph_words;
+    printf("static const uint32_t %s_pixels[%d] = {", name, (int) words);
+    for (uint32_t i = 0; i < words; i++) {
+        printf("%s0x%08x,", (i % 8) ? " " : "\n        ", f->pixels[i]);
+    }
+    printf("\n};\n\n");
+}
+
+static void dump_all(bool rgb565) {
+    dump("font12", &lcd12, 4, rgb565);
+    dump("font18", &lcd18, 5, rgb565);
+}
+
+int main(void) {
+    printf("/*\n"
+           " * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.\n"
+           " *\n"
+           " * SPDX-License-Identifier: BSD-3-Clause\n"
+           " */\n\n"
+           "// generated by font_gen; do not edit\n\n"
+           "#include \"font.h\"\n\n"
+           "#ifdef PLATYPUS_565\n");
+    dump_all(true);
+    printf("#else\n");
+    dump_all(false);
+    printf("#endif\n\n");
+    printf("const struct font font12_prebuilt = {4, %d, %d, font12_pixels};\n", lcd12.line_height, 4 * lcd12.line_height);
+    printf("const struct font font18_prebuilt = {5, %d, %d, font18_pixels};\n", lcd18.line_height, 5 * lcd18.line_height);
+    return 0;
+}
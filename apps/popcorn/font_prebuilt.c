@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// generated by font_gen; do not edit
+
+#include "font.h"
+
+#ifdef PLATYPUS_565
+static const uint32_t font12_pixels[468] = {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x22490000, 0x000008c3, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x2acb330c, 0x22492acb, 0x000008c3,
+        0x11040000, 0x000019c7, 0x22080000, 0x00001104, 0x11450000, 0x00002208, 0x330c0000, 0x00001104,
+        0x19c70000, 0x08c31145, 0x22490041, 0x00000000, 0x11450000, 0x19c70041, 0x224908c3, 0x00000000,
+        0x330c0000, 0x00001104, 0x3b8e0000, 0x00000000, 0x330c0000, 0x00000000, 0x330c0041, 0x00000000,
+        0x2a8a0000, 0x2acb2acb, 0x19c72acb, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x2249330c, 0x00001104, 0x00000000, 0x00000000, 0x22080000, 0x00002208, 0x00000000,
+        0x00000000, 0x22080000, 0x00001104, 0x00000000, 0x00000000, 0x19c70000, 0x00001104, 0x00000000,
+        0x00000000, 0x19860000, 0x00000000, 0x00000000, 0x00000000, 0x334d0000, 0x00000000, 0x00000000,
+        0x00000000, 0x3bcf0000, 0x00000000, 0x00000000, 0x00000000, 0x2a8a0000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x2acb330c, 0x22492acb, 0x000008c3,
+        0x00000000, 0x00000000, 0x22080000, 0x00001104, 0x00000000, 0x00000000, 0x330c0000, 0x000008c3,
+        0x00000000, 0x08c308c3, 0x2a8a08c3, 0x00000000, 0x11450000, 0x22082249, 0x08c32208, 0x00000000,
+        0x330c0000, 0x00001104, 0x00000000, 0x00000000, 0x330c0000, 0x00000000, 0x00000000, 0x00000000,
+        0x2a8a0000, 0x2acb2acb, 0x11452acb, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x2acb330c, 0x22492acb, 0x000008c3, 0x00000000, 0x00000000, 0x22080000, 0x00001104,
+        0x00000000, 0x00000000, 0x330c0000, 0x000008c3, 0x00000000, 0x08c308c3, 0x2a8a08c3, 0x00000000,
+        0x00000000, 0x22082208, 0x330c2208, 0x00000000, 0x00000000, 0x00000000, 0x334d0000, 0x00000000,
+        0x00000000, 0x00000000, 0x330c0041, 0x00000000, 0x22490000, 0x2acb2acb, 0x2a8a2a8a, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x08820000, 0x00001986, 0x11040000, 0x000008c3,
+        0x11040000, 0x00002249, 0x22080000, 0x00001104, 0x11450000, 0x00002208, 0x330c0000, 0x00001104,
+        0x19c70000, 0x08c319c7, 0x2acb08c3, 0x00000000, 0x00000000, 0x220819c7, 0x330c2208, 0x00000000,
+        0x00000000, 0x00000000, 0x334d0000, 0x00000000, 0x00000000, 0x00000000, 0x330c0041, 0x00000000,
+        0x00000000, 0x00000000, 0x2a8a0041, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x08820000, 0x2acb2249, 0x11452acb, 0x00000000, 0x11040000, 0x00002249, 0x00000000, 0x00000000,
+        0x11450000, 0x00002208, 0x00000000, 0x00000000, 0x19c70000, 0x08c319c7, 0x088208c3, 0x00000000,
+        0x00000000, 0x220819c7, 0x330c2208, 0x00000000, 0x00000000, 0x00000000, 0x334d0000, 0x00000000,
+        0x00000000, 0x00000000, 0x330c0041, 0x00000000, 0x22490000, 0x2acb2acb, 0x2a8a2a8a, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x2acb330c, 0x2acb2acb, 0x000008c3,
+        0x11040000, 0x000019c7, 0x00000000, 0x00000000, 0x11450000, 0x00002208, 0x00000000, 0x00000000,
+        0x19c70000, 0x08c32208, 0x088208c3, 0x00000000, 0x11450000, 0x22082208, 0x330c2208, 0x00000000,
+        0x330c0000, 0x00001104, 0x3b8e0000, 0x00000000, 0x330c0000, 0x00000000, 0x330c0041, 0x00000000,
+        0x2a8a0000, 0x2acb2acb, 0x19c72acb, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x2acb330c, 0x22492acb, 0x000008c3, 0x00000000, 0x00000000, 0x22080000, 0x00001104,
+        0x00000000, 0x00000000, 0x330c0000, 0x000008c3, 0x00000000, 0x00000000, 0x22490000, 0x00000000,
+        0x00000000, 0x00000000, 0x22490000, 0x00000000, 0x00000000, 0x00000000, 0x334d0000, 0x00000000,
+        0x00000000, 0x00000000, 0x330c0041, 0x00000000, 0x00000000, 0x00000000, 0x22490041, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x2acb330c, 0x22492acb, 0x000008c3,
+        0x11040000, 0x000019c7, 0x22080000, 0x00001104, 0x11450000, 0x00002208, 0x330c0000, 0x00001104,
+        0x19c70000, 0x08c32208, 0x2acb08c3, 0x00000000, 0x11450000, 0x22082208, 0x330c2208, 0x00000000,
+        0x330c0000, 0x00001104, 0x3b8e0000, 0x00000000, 0x330c0000, 0x00000000, 0x330c0041, 0x00000000,
+        0x2a8a0000, 0x2acb2acb, 0x19c72acb, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x2acb2acb, 0x2a8a2acb, 0x000008c3, 0x11040000, 0x00002208, 0x22080000, 0x00001104,
+        0x11040000, 0x00002208, 0x2a8a0000, 0x00001104, 0x22080000, 0x08c32208, 0x2acb08c3, 0x00000041,
+        0x00000000, 0x220819c7, 0x2a8a2208, 0x00000000, 0x00000000, 0x00000000, 0x3bcf0000, 0x00000000,
+        0x00000000, 0x00000000, 0x330c0000, 0x00000000, 0x22490000, 0x2acb2acb, 0x19c72acb, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00410000, 0x00000882, 0x00000000, 0x00000000, 0x08c30000, 0x00001145, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x22490000, 0x000008c3, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+};
+
+static const uint32_t font18_pixels[845] = {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x004108c3, 0x00000000, 0x00000000, 0x00000000, 0x00410000,
+        0x19c73bcf, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x22490041, 0x2acb2acb, 0x2acb2acb, 0x08c32208, 0x00000000, 0x2a8a08c3,
+        0x330c330c, 0x2acb330c, 0x22082acb, 0x00000000, 0x3b8e19c7, 0x00000000, 0x00000000, 0x19c73b8e,
+        0x00000000, 0x330c2208, 0x00000000, 0x00000000, 0x11043bcf, 0x00000000, 0x330c2a8a, 0x00000000,
+        0x00000000, 0x11043bcf, 0x00000000, 0x08c32a8a, 0x19c70000, 0x00000882, 0x00412acb, 0x00000000,
+        0x00001145, 0x330c0882, 0x00001145, 0x00002208, 0x00000000, 0x11043bcf, 0x00000000, 0x19c70000,
+        0x00003b8e, 0x00000000, 0x11043bcf, 0x00000000, 0x22080000, 0x0000330c, 0x08820000, 0x08c33bcf,
+        0x00000000, 0x2a8a0000, 0x0000330c, 0x11040000, 0x08c33bcf, 0x08c308c3, 0x224908c3, 0x00001986,
+        0x08c30000, 0x3b8e2acb, 0x3bcf3bcf, 0x3bcf3bcf, 0x00001104, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x22490041, 0x22082acb, 0x00001145, 0x00000000, 0x00000000,
+        0x22080041, 0x2249330c, 0x00002acb, 0x00000000, 0x00000000, 0x00000000, 0x330c0000, 0x00002a8a,
+        0x00000000, 0x00000000, 0x00000000, 0x330c0000, 0x00002208, 0x00000000, 0x00000000, 0x00000000,
+        0x3b8e0000, 0x000019c7, 0x00000000, 0x00000000, 0x00000000, 0x22490000, 0x000008c3, 0x00000000,
+        0x00000000, 0x00000000, 0x19860000, 0x00000882, 0x00000000, 0x00000000, 0x00000000, 0x3bcf08c3,
+        0x00000041, 0x00000000, 0x00000000, 0x00000000, 0x3bcf1104, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x3b8e19c7, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x330c2208, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x22491145, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x22490041, 0x2acb2acb, 0x2acb2acb, 0x08c32208,
+        0x00000000, 0x22080041, 0x330c330c, 0x2acb330c, 0x22082acb, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x19863bcf, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x11043bcf, 0x00000000,
+        0x00000000, 0x00000000, 0x00410000, 0x11043bcf, 0x00000000, 0x11450000, 0x19c719c7, 0x198619c7,
+        0x0000330c, 0x00000000, 0x2acb1145, 0x330c330c, 0x2acb330c, 0x00000041, 0x00000000, 0x11043bcf,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x11043bcf, 0x00000000, 0x00000000, 0x00000000,
+        0x08820000, 0x08c33bcf, 0x00000000, 0x00000000, 0x00000000, 0x11040000, 0x08c33bcf, 0x08c308c3,
+        0x08c308c3, 0x00000000, 0x08c30000, 0x3b8e2acb, 0x3bcf3bcf, 0x3bcf3bcf, 0x00001104, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x22490041, 0x2acb2acb, 0x2acb2acb,
+        0x08c32208, 0x00000000, 0x22080041, 0x330c330c, 0x2acb330c, 0x22082acb, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x19863bcf, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x11043bcf,
+        0x00000000, 0x00000000, 0x00000000, 0x00410000, 0x11043bcf, 0x00000000, 0x11450000, 0x19c719c7,
+        0x198619c7, 0x0000330c, 0x00000000, 0x2acb0000, 0x330c330c, 0x2acb330c, 0x00002208, 0x00000000,
+        0x00000000, 0x00000000, 0x19c70000, 0x0000334d, 0x00000000, 0x00000000, 0x00000000, 0x22080000,
+        0x0000330c, 0x00000000, 0x00000000, 0x00000000, 0x2a8a0000, 0x00002acb, 0x00000000, 0x08c30882,
+        0x08c308c3, 0x330c08c3, 0x00002208, 0x08c30000, 0x3bcf3bcf, 0x3bcf3bcf, 0x2acb3bcf, 0x00001145,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x19c70041, 0x00000000,
+        0x00000000, 0x08c31104, 0x00000000, 0x3b8e1104, 0x00000000, 0x00000000, 0x22082acb, 0x00000000,
+        0x3b8e19c7, 0x00000000, 0x00000000, 0x19c73b8e, 0x00000000, 0x330c2208, 0x00000000, 0x00000000,
+        0x11043bcf, 0x00000000, 0x330c2a8a, 0x00000000, 0x00000000, 0x11043bcf, 0x00000000, 0x22082a8a,
+        0x19c719c7, 0x19c719c7, 0x0041330c, 0x00000000, 0x2acb0000, 0x330c330c, 0x330c330c, 0x00002a8a,
+        0x00000000, 0x00000000, 0x00000000, 0x19c70000, 0x00003b8e, 0x00000000, 0x00000000, 0x00000000,
+        0x22080000, 0x0000330c, 0x00000000, 0x00000000, 0x00000000, 0x2a8a0000, 0x0000330c, 0x00000000,
+        0x00000000, 0x00000000, 0x330c0000, 0x00002208, 0x00000000, 0x00000000, 0x00000000, 0x22080000,
+        0x00001145, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x19c70041,
+        0x2acb330c, 0x2acb2acb, 0x00001104, 0x00000000, 0x3b8e1104, 0x330c2249, 0x2acb330c, 0x00000000,
+        0x00000000, 0x3b8e19c7, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x330c2208, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x330c2a8a, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x22082a8a, 0x19c719c7, 0x19c719c7, 0x00000041, 0x00000000, 0x2acb0000, 0x330c330c, 0x330c330c,
+        0x00002249, 0x00000000, 0x00000000, 0x00000000, 0x19c70000, 0x0000334d, 0x00000000, 0x00000000,
+        0x00000000, 0x22080000, 0x0000330c, 0x00000000, 0x00000000, 0x00000000, 0x2a8a0000, 0x00002acb,
+        0x00000000, 0x08c30882, 0x08c308c3, 0x330c08c3, 0x00002208, 0x08c30000, 0x3bcf3bcf, 0x3bcf3bcf,
+        0x2acb3bcf, 0x00001145, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x22490041, 0x2acb2acb, 0x2acb2acb, 0x11042acb, 0x00000000, 0x2a8a08c3, 0x330c330c, 0x330c330c,
+        0x08822249, 0x00000000, 0x3b8e19c7, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x330c2208,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x330c2a8a, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x22082a8a, 0x19c719c7, 0x19c719c7, 0x00000041, 0x00000000, 0x2acb1145, 0x330c330c,
+        0x330c330c, 0x00002a8a, 0x00000000, 0x11043bcf, 0x00000000, 0x19c70000, 0x00003b8e, 0x00000000,
+        0x11043bcf, 0x00000000, 0x22080000, 0x0000330c, 0x08820000, 0x08c33bcf, 0x00000000, 0x2a8a0000,
+        0x0000330c, 0x11040000, 0x08c33bcf, 0x08c308c3, 0x224908c3, 0x00001986, 0x08c30000, 0x3b8e2acb,
+        0x3bcf3bcf, 0x3bcf3bcf, 0x00001104, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x22490041, 0x2acb2acb, 0x2acb2acb, 0x08c32208, 0x00000000, 0x22080041, 0x330c330c,
+        0x2acb330c, 0x22082acb, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x19863bcf, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x11043bcf, 0x00000000, 0x00000000, 0x00000000, 0x00410000,
+        0x11043bcf, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0000330c, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x000019c7, 0x00000000, 0x00000000, 0x00000000, 0x19c70000, 0x0000334d,
+        0x00000000, 0x00000000, 0x00000000, 0x22080000, 0x0000330c, 0x00000000, 0x00000000, 0x00000000,
+        0x2a8a0000, 0x00002acb, 0x00000000, 0x00000000, 0x00000000, 0x330c0000, 0x00002208, 0x00000000,
+        0x00000000, 0x00000000, 0x22490000, 0x00001145, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x22490041, 0x2acb2acb, 0x2acb2acb, 0x08c32208, 0x00000000, 0x2a8a08c3,
+        0x330c330c, 0x2acb330c, 0x22082acb, 0x00000000, 0x3b8e19c7, 0x00000000, 0x00000000, 0x19c73b8e,
+        0x00000000, 0x330c2208, 0x00000000, 0x00000000, 0x11043bcf, 0x00000000, 0x330c2a8a, 0x00000000,
+        0x00000000, 0x11043bcf, 0x00000000, 0x22082a8a, 0x19c719c7, 0x19c719c7, 0x0041330c, 0x00000000,
+        0x2acb1145, 0x330c330c, 0x330c330c, 0x00002a8a, 0x00000000, 0x11043bcf, 0x00000000, 0x19c70000,
+        0x00003b8e, 0x00000000, 0x11043bcf, 0x00000000, 0x22080000, 0x0000330c, 0x08820000, 0x08c33bcf,
+        0x00000000, 0x2a8a0000, 0x0000330c, 0x11040000, 0x08c33bcf, 0x08c308c3, 0x224908c3, 0x00001986,
+        0x08c30000, 0x3b8e2acb, 0x3bcf3bcf, 0x3bcf3bcf, 0x00001104, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x22490000, 0x2acb2acb, 0x2acb2acb, 0x110419c7, 0x00000000,
+        0x2a8a08c3, 0x330c330c, 0x330c330c, 0x22082acb, 0x00000000, 0x3bcf1145, 0x00000000, 0x00000000,
+        0x2208330c, 0x00000000, 0x330c2208, 0x00000000, 0x00000000, 0x11453bcf, 0x00000000, 0x330c2208,
+        0x00000000, 0x00000000, 0x11043bcf, 0x00000000, 0x22082249, 0x19c719c7, 0x19c719c7, 0x08c32acb,
+        0x00000000, 0x2acb0000, 0x330c330c, 0x330c330c, 0x000019c7, 0x00000000, 0x00000000, 0x00000000,
+        0x11450000, 0x00003bcf, 0x00000000, 0x00000000, 0x00000000, 0x22080000, 0x0000330c, 0x00000000,
+        0x00000000, 0x00000000, 0x22080000, 0x0000330c, 0x00000000, 0x08c30882, 0x08c308c3, 0x224908c3,
+        0x00002208, 0x08c30000, 0x3bcf3bcf, 0x3bcf3bcf, 0x3bcf3bcf, 0x00001104, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x198608c3, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x2acb19c7, 0x00000041, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x004108c3, 0x00000000,
+        0x00000000, 0x00000000, 0x00410000, 0x19c73bcf, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+};
+
+#else
+static const uint32_t font12_pixels[468] = {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x11290000, 0x00000463, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x156b198c, 0x1129156b, 0x00000463,
+        0x08840000, 0x00000ce7, 0x11080000, 0x00000884, 0x08a50000, 0x00001108, 0x198c0000, 0x00000884,
+        0x0ce70000, 0x046308a5, 0x11290021, 0x00000000, 0x08a50000, 0x0ce70021, 0x11290463, 0x00000000,
+        0x198c0000, 0x00000884, 0x1dce0000, 0x00000000, 0x198c0000, 0x00000000, 0x198c0021, 0x00000000,
+        0x154a0000, 0x156b156b, 0x0ce7156b, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x1129198c, 0x00000884, 0x00000000, 0x00000000, 0x11080000, 0x00001108, 0x00000000,
+        0x00000000, 0x11080000, 0x00000884, 0x00000000, 0x00000000, 0x0ce70000, 0x00000884, 0x00000000,
+        0x00000000, 0x0cc60000, 0x00000000, 0x00000000, 0x00000000, 0x19ad0000, 0x00000000, 0x00000000,
+        0x00000000, 0x1def0000, 0x00000000, 0x00000000, 0x00000000, 0x154a0000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x156b198c, 0x1129156b, 0x00000463,
+        0x00000000, 0x00000000, 0x11080000, 0x00000884, 0x00000000, 0x00000000, 0x198c0000, 0x00000463,
+        0x00000000, 0x04630463, 0x154a0463, 0x00000000, 0x08a50000, 0x11081129, 0x04631108, 0x00000000,
+        0x198c0000, 0x00000884, 0x00000000, 0x00000000, 0x198c0000, 0x00000000, 0x00000000, 0x00000000,
+        0x154a0000, 0x156b156b, 0x08a5156b, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x156b198c, 0x1129156b, 0x00000463, 0x00000000, 0x00000000, 0x11080000, 0x00000884,
+        0x00000000, 0x00000000, 0x198c0000, 0x00000463, 0x00000000, 0x04630463, 0x154a0463, 0x00000000,
+        0x00000000, 0x11081108, 0x198c1108, 0x00000000, 0x00000000, 0x00000000, 0x19ad0000, 0x00000000,
+        0x00000000, 0x00000000, 0x198c0021, 0x00000000, 0x11290000, 0x156b156b, 0x154a154a, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x04420000, 0x00000cc6, 0x08840000, 0x00000463,
+        0x08840000, 0x00001129, 0x11080000, 0x00000884, 0x08a50000, 0x00001108, 0x198c0000, 0x00000884,
+        0x0ce70000, 0x04630ce7, 0x156b0463, 0x00000000, 0x00000000, 0x11080ce7, 0x198c1108, 0x00000000,
+        0x00000000, 0x00000000, 0x19ad0000, 0x00000000, 0x00000000, 0x00000000, 0x198c0021, 0x00000000,
+        0x00000000, 0x00000000, 0x154a0021, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x04420000, 0x156b1129, 0x08a5156b, 0x00000000, 0x08840000, 0x00001129, 0x00000000, 0x00000000,
+        0x08a50000, 0x00001108, 0x00000000, 0x00000000, 0x0ce70000, 0x04630ce7, 0x04420463, 0x00000000,
+        0x00000000, 0x11080ce7, 0x198c1108, 0x00000000, 0x00000000, 0x00000000, 0x19ad0000, 0x00000000,
+        0x00000000, 0x00000000, 0x198c0021, 0x00000000, 0x11290000, 0x156b156b, 0x154a154a, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x156b198c, 0x156b156b, 0x00000463,
+        0x08840000, 0x00000ce7, 0x00000000, 0x00000000, 0x08a50000, 0x00001108, 0x00000000, 0x00000000,
+        0x0ce70000, 0x04631108, 0x04420463, 0x00000000, 0x08a50000, 0x11081108, 0x198c1108, 0x00000000,
+        0x198c0000, 0x00000884, 0x1dce0000, 0x00000000, 0x198c0000, 0x00000000, 0x198c0021, 0x00000000,
+        0x154a0000, 0x156b156b, 0x0ce7156b, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x156b198c, 0x1129156b, 0x00000463, 0x00000000, 0x00000000, 0x11080000, 0x00000884,
+        0x00000000, 0x00000000, 0x198c0000, 0x00000463, 0x00000000, 0x00000000, 0x11290000, 0x00000000,
+        0x00000000, 0x00000000, 0x11290000, 0x00000000, 0x00000000, 0x00000000, 0x19ad0000, 0x00000000,
+        0x00000000, 0x00000000, 0x198c0021, 0x00000000, 0x00000000, 0x00000000, 0x11290021, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x156b198c, 0x1129156b, 0x00000463,
+        0x08840000, 0x00000ce7, 0x11080000, 0x00000884, 0x08a50000, 0x00001108, 0x198c0000, 0x00000884,
+        0x0ce70000, 0x04631108, 0x156b0463, 0x00000000, 0x08a50000, 0x11081108, 0x198c1108, 0x00000000,
+        0x198c0000, 0x00000884, 0x1dce0000, 0x00000000, 0x198c0000, 0x00000000, 0x198c0021, 0x00000000,
+        0x154a0000, 0x156b156b, 0x0ce7156b, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x156b156b, 0x154a156b, 0x00000463, 0x08840000, 0x00001108, 0x11080000, 0x00000884,
+        0x08840000, 0x00001108, 0x154a0000, 0x00000884, 0x11080000, 0x04631108, 0x156b0463, 0x00000021,
+        0x00000000, 0x11080ce7, 0x154a1108, 0x00000000, 0x00000000, 0x00000000, 0x1def0000, 0x00000000,
+        0x00000000, 0x00000000, 0x198c0000, 0x00000000, 0x11290000, 0x156b156b, 0x0ce7156b, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00210000, 0x00000442, 0x00000000, 0x00000000, 0x04630000, 0x000008a5, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x11290000, 0x00000463, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+};
+
+static const uint32_t font18_pixels[845] = {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00210463, 0x00000000, 0x00000000, 0x00000000, 0x00210000,
+        0x0ce71def, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x11290021, 0x156b156b, 0x156b156b, 0x04631108, 0x00000000, 0x154a0463,
+        0x198c198c, 0x156b198c, 0x1108156b, 0x00000000, 0x1dce0ce7, 0x00000000, 0x00000000, 0x0ce71dce,
+        0x00000000, 0x198c1108, 0x00000000, 0x00000000, 0x08841def, 0x00000000, 0x198c154a, 0x00000000,
+        0x00000000, 0x08841def, 0x00000000, 0x0463154a, 0x0ce70000, 0x00000442, 0x0021156b, 0x00000000,
+        0x000008a5, 0x198c0442, 0x000008a5, 0x00001108, 0x00000000, 0x08841def, 0x00000000, 0x0ce70000,
+        0x00001dce, 0x00000000, 0x08841def, 0x00000000, 0x11080000, 0x0000198c, 0x04420000, 0x04631def,
+        0x00000000, 0x154a0000, 0x0000198c, 0x08840000, 0x04631def, 0x04630463, 0x11290463, 0x00000cc6,
+        0x04630000, 0x1dce156b, 0x1def1def, 0x1def1def, 0x00000884, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x11290021, 0x1108156b, 0x000008a5, 0x00000000, 0x00000000,
+        0x11080021, 0x1129198c, 0x0000156b, 0x00000000, 0x00000000, 0x00000000, 0x198c0000, 0x0000154a,
+        0x00000000, 0x00000000, 0x00000000, 0x198c0000, 0x00001108, 0x00000000, 0x00000000, 0x00000000,
+        0x1dce0000, 0x00000ce7, 0x00000000, 0x00000000, 0x00000000, 0x11290000, 0x00000463, 0x00000000,
+        0x00000000, 0x00000000, 0x0cc60000, 0x00000442, 0x00000000, 0x00000000, 0x00000000, 0x1def0463,
+        0x00000021, 0x00000000, 0x00000000, 0x00000000, 0x1def0884, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x1dce0ce7, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x198c1108, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x112908a5, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x11290021, 0x156b156b, 0x156b156b, 0x04631108,
+        0x00000000, 0x11080021, 0x198c198c, 0x156b198c, 0x1108156b, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x0cc61def, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x08841def, 0x00000000,
+        0x00000000, 0x00000000, 0x00210000, 0x08841def, 0x00000000, 0x08a50000, 0x0ce70ce7, 0x0cc60ce7,
+        0x0000198c, 0x00000000, 0x156b08a5, 0x198c198c, 0x156b198c, 0x00000021, 0x00000000, 0x08841def,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x08841def, 0x00000000, 0x00000000, 0x00000000,
+        0x04420000, 0x04631def, 0x00000000, 0x00000000, 0x00000000, 0x08840000, 0x04631def, 0x04630463,
+        0x04630463, 0x00000000, 0x04630000, 0x1dce156b, 0x1def1def, 0x1def1def, 0x00000884, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x11290021, 0x156b156b, 0x156b156b,
+        0x04631108, 0x00000000, 0x11080021, 0x198c198c, 0x156b198c, 0x1108156b, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x0cc61def, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x08841def,
+        0x00000000, 0x00000000, 0x00000000, 0x00210000, 0x08841def, 0x00000000, 0x08a50000, 0x0ce70ce7,
+        0x0cc60ce7, 0x0000198c, 0x00000000, 0x156b0000, 0x198c198c, 0x156b198c, 0x00001108, 0x00000000,
+        0x00000000, 0x00000000, 0x0ce70000, 0x000019ad, 0x00000000, 0x00000000, 0x00000000, 0x11080000,
+        0x0000198c, 0x00000000, 0x00000000, 0x00000000, 0x154a0000, 0x0000156b, 0x00000000, 0x04630442,
+        0x04630463, 0x198c0463, 0x00001108, 0x04630000, 0x1def1def, 0x1def1def, 0x156b1def, 0x000008a5,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0ce70021, 0x00000000,
+        0x00000000, 0x04630884, 0x00000000, 0x1dce0884, 0x00000000, 0x00000000, 0x1108156b, 0x00000000,
+        0x1dce0ce7, 0x00000000, 0x00000000, 0x0ce71dce, 0x00000000, 0x198c1108, 0x00000000, 0x00000000,
+        0x08841def, 0x00000000, 0x198c154a, 0x00000000, 0x00000000, 0x08841def, 0x00000000, 0x1108154a,
+        0x0ce70ce7, 0x0ce70ce7, 0x0021198c, 0x00000000, 0x156b0000, 0x198c198c, 0x198c198c, 0x0000154a,
+        0x00000000, 0x00000000, 0x00000000, 0x0ce70000, 0x00001dce, 0x00000000, 0x00000000, 0x00000000,
+        0x11080000, 0x0000198c, 0x00000000, 0x00000000, 0x00000000, 0x154a0000, 0x0000198c, 0x00000000,
+        0x00000000, 0x00000000, 0x198c0000, 0x00001108, 0x00000000, 0x00000000, 0x00000000, 0x11080000,
+        0x000008a5, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0ce70021,
+        0x156b198c, 0x156b156b, 0x00000884, 0x00000000, 0x1dce0884, 0x198c1129, 0x156b198c, 0x00000000,
+        0x00000000, 0x1dce0ce7, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x198c1108, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x198c154a, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x1108154a, 0x0ce70ce7, 0x0ce70ce7, 0x00000021, 0x00000000, 0x156b0000, 0x198c198c, 0x198c198c,
+        0x00001129, 0x00000000, 0x00000000, 0x00000000, 0x0ce70000, 0x000019ad, 0x00000000, 0x00000000,
+        0x00000000, 0x11080000, 0x0000198c, 0x00000000, 0x00000000, 0x00000000, 0x154a0000, 0x0000156b,
+        0x00000000, 0x04630442, 0x04630463, 0x198c0463, 0x00001108, 0x04630000, 0x1def1def, 0x1def1def,
+        0x156b1def, 0x000008a5, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x11290021, 0x156b156b, 0x156b156b, 0x0884156b, 0x00000000, 0x154a0463, 0x198c198c, 0x198c198c,
+        0x04421129, 0x00000000, 0x1dce0ce7, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x198c1108,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x198c154a, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x1108154a, 0x0ce70ce7, 0x0ce70ce7, 0x00000021, 0x00000000, 0x156b08a5, 0x198c198c,
+        0x198c198c, 0x0000154a, 0x00000000, 0x08841def, 0x00000000, 0x0ce70000, 0x00001dce, 0x00000000,
+        0x08841def, 0x00000000, 0x11080000, 0x0000198c, 0x04420000, 0x04631def, 0x00000000, 0x154a0000,
+        0x0000198c, 0x08840000, 0x04631def, 0x04630463, 0x11290463, 0x00000cc6, 0x04630000, 0x1dce156b,
+        0x1def1def, 0x1def1def, 0x00000884, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x11290021, 0x156b156b, 0x156b156b, 0x04631108, 0x00000000, 0x11080021, 0x198c198c,
+        0x156b198c, 0x1108156b, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0cc61def, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x08841def, 0x00000000, 0x00000000, 0x00000000, 0x00210000,
+        0x08841def, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0000198c, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000ce7, 0x00000000, 0x00000000, 0x00000000, 0x0ce70000, 0x000019ad,
+        0x00000000, 0x00000000, 0x00000000, 0x11080000, 0x0000198c, 0x00000000, 0x00000000, 0x00000000,
+        0x154a0000, 0x0000156b, 0x00000000, 0x00000000, 0x00000000, 0x198c0000, 0x00001108, 0x00000000,
+        0x00000000, 0x00000000, 0x11290000, 0x000008a5, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x11290021, 0x156b156b, 0x156b156b, 0x04631108, 0x00000000, 0x154a0463,
+        0x198c198c, 0x156b198c, 0x1108156b, 0x00000000, 0x1dce0ce7, 0x00000000, 0x00000000, 0x0ce71dce,
+        0x00000000, 0x198c1108, 0x00000000, 0x00000000, 0x08841def, 0x00000000, 0x198c154a, 0x00000000,
+        0x00000000, 0x08841def, 0x00000000, 0x1108154a, 0x0ce70ce7, 0x0ce70ce7, 0x0021198c, 0x00000000,
+        0x156b08a5, 0x198c198c, 0x198c198c, 0x0000154a, 0x00000000, 0x08841def, 0x00000000, 0x0ce70000,
+        0x00001dce, 0x00000000, 0x08841def, 0x00000000, 0x11080000, 0x0000198c, 0x04420000, 0x04631def,
+        0x00000000, 0x154a0000, 0x0000198c, 0x08840000, 0x04631def, 0x04630463, 0x11290463, 0x00000cc6,
+        0x04630000, 0x1dce156b, 0x1def1def, 0x1def1def, 0x00000884, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x11290000, 0x156b156b, 0x156b156b, 0x08840ce7, 0x00000000,
+        0x154a0463, 0x198c198c, 0x198c198c, 0x1108156b, 0x00000000, 0x1def08a5, 0x00000000, 0x00000000,
+        0x1108198c, 0x00000000, 0x198c1108, 0x00000000, 0x00000000, 0x08a51def, 0x00000000, 0x198c1108,
+        0x00000000, 0x00000000, 0x08841def, 0x00000000, 0x11081129, 0x0ce70ce7, 0x0ce70ce7, 0x0463156b,
+        0x00000000, 0x156b0000, 0x198c198c, 0x198c198c, 0x00000ce7, 0x00000000, 0x00000000, 0x00000000,
+        0x08a50000, 0x00001def, 0x00000000, 0x00000000, 0x00000000, 0x11080000, 0x0000198c, 0x00000000,
+        0x00000000, 0x00000000, 0x11080000, 0x0000198c, 0x00000000, 0x04630442, 0x04630463, 0x11290463,
+        0x00001108, 0x04630000, 0x1def1def, 0x1def1def, 0x1def1def, 0x00000884, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0cc60463, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x156b0ce7, 0x00000021, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00210463, 0x00000000,
+        0x00000000, 0x00000000, 0x00210000, 0x0ce71def, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+};
+
+#endif
+
+const struct font font12_prebuilt = {4, 9, 36, font12_pixels};
+const struct font font18_prebuilt = {5, 13, 65, font18_pixels};
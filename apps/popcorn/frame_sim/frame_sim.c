@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Estimates whether popcorn can decode every row of a .pl2 in time, without needing the hardware. The cost of
+// decoding a row is modelled as a fixed cost plus a cost per token of each kind (the 2x2 platypus tokens, and the 2x1
+// ones), and the two render cores are simulated against the scanline deadlines at a given sys_clk. Frames with rows
+// that would be late (shown as magenta, or worse make the video lose sync) are listed.
+//
+// The default costs are only guesses, so without calibration frame_sim warns, and doesn't estimate the clock needed.
+// To calibrate them, build popcorn with POPCORN_DECODE_STATS=1, play the movie,
+// capture the UART output, and pass it with --calibrate; the costs are then fitted (least squares) to the measured
+// rows. The fitted model is printed in a form that can be passed back with --model.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pl2.h"
+#include "platypus_2x1.h"
+
+#define MOVIE_ROWS 120
+#define ROW_BLOCKS 160
+// 640x480 VGA timing as used by popcorn: 800 pixel clocks a line at 25MHz, 525 lines a frame
+#define LINE_NS 32000
+#define VBLANK_LINES 45
+#define SCANLINE_BUFFER_COUNT 16
+// everything else done per scanline buffer (or linked pair) besides decoding
+#define DEFAULT_OVERHEAD_CYCLES 600
+
+enum {
+    COST_ROW,       // per decode call
+    COST_2X2_RAW,   // 7 byte raw 2x2 block
+    COST_2X2_PAT32, // 4 byte color + 1 of 32 patterns
+    COST_2X2_PAT4,  // 3 byte color + 1 of 4 patterns
+    COST_2X1_RAW,
+    COST_2X1_DELTA,
+    COST_2X1_RUN,   // per run token
+    COST_2X1_RUN_BLOCK, // per block filled by a run
+    COST_COUNT
+};
+
+static const char *const cost_names[COST_COUNT] = {
+        "row", "2x2_raw", "2x2_pat32", "2x2_pat4", "2x1_raw", "2x1_delta", "2x1_run", "2x1_run_block"
+};
+
+// cycles; guesses for the assembly 2x2 decoder and the C 2x1 one, not measured
+static double model[COST_COUNT] = {40, 34, 26, 22, 14, 15, 12, 3};
+// set by --calibrate or --model
+static bool model_calibrated;
+
+struct row_counts {
+    // [0] is the first row of the pair and [1] the second; for 2x2 everything is in [0]
+    uint32_t counts[2][COST_COUNT];
+};
+
+static struct {
+    double sys_clk_mhz;
+    bool single_row;
+    uint overhead;
+    bool verbose;
+    bool rgb565;
+} options = {48, false, DEFAULT_OVERHEAD_CYCLES, false, true};
+
+static FILE *movie;
+static uint32_t *frame_sectors;
+static uint32_t frame_count;
+static uint8_t header_buffer[512];
+static uint8_t *image;
+static size_t image_size;
+
+static void fail(const char *message) {
+    fprintf(stderr, "%s\n", message);
+    exit(1);
+}
+
+static const struct frame_header *read_header(uint32_t sector) {
+    if (fseek(movie, (long) sector * 512, SEEK_SET) || 1 != fread(header_buffer, 512, 1, movie)) return NULL;
+    const struct frame_header *head = (const struct frame_header *) header_buffer;
+    return pl2_is_frame_header(head) ? head : NULL;
+}
+
+static void index_frames(void) {
+    uint32_t sector = 0;
+    uint32_t capacity = 0;
+    while (true) {
+        const struct frame_header *head = read_header(sector);
+        if (!head) {
+            if (!frame_count) fail("not a .pl2 file");
+            fprintf(stderr, "warning: bad frame header at sector %d; stopping there\n", sector);
+            break;
+        }
+        if (frame_count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            frame_sectors = realloc(frame_sectors, capacity * sizeof(uint32_t));
+        }
+        frame_sectors[frame_count++] = sector;
+        uint32_t next = head->forward_frame_sector[0];
+        if (next == 0xffffffff) break;
+        sector = next;
+    }
+}
+
+// reads the frame's header and image data; returns NULL if it can't
+static const struct frame_header *read_frame(uint32_t frame) {
+    static uint8_t frame_header[512];
+    const struct frame_header *head = read_header(frame_sectors[frame]);
+    if (!head) return NULL;
+    memcpy(frame_header, header_buffer, 512);
+    head = (const struct frame_header *) frame_header;
+    size_t bytes = head->image_words * 4;
+    if (bytes > image_size) {
+        image = realloc(image, bytes);
+        image_size = bytes;
+    }
+    long offset = (long) (frame_sectors[frame] + 1 + (head->audio_words + 127) / 128) * 512;
+    if (fseek(movie, offset, SEEK_SET) || 1 != fread(image, bytes, 1, movie)) return NULL;
+    return head;
+}
+
+// count the tokens in one row pair; returns false if the data doesn't make sense
+static bool count_row(const struct frame_header *head, uint row, struct row_counts *rc) {
+    memset(rc, 0, sizeof(*rc));
+    uint32_t from = head->row_offsets[row] * 4u;
+    uint32_t to = head->row_offsets[row + 1] * 4u;
+    if (from > to || to > head->image_words * 4u) return false;
+    if (head->format == PL2_FORMAT_2X1) {
+        uint16_t raw_flag = platypus_2x1_raw_flag(options.rgb565);
+        uint32_t split = from + pl2_row_splits(head)[row] * 4u;
+        for (uint part = 0; part < 2; part++) {
+            const uint8_t *p = image + (part ? split : from);
+            const uint8_t *end = image + (part ? to : split);
+            uint32_t *c = rc->counts[part];
+            c[COST_ROW] = 1;
+            for (uint blocks = 0; blocks < ROW_BLOCKS;) {
+                if (p + 3 > end) return false;
+                if ((p[0] | (p[1] << 8u)) & raw_flag) {
+                    c[COST_2X1_RAW]++;
+                    blocks++;
+                    p += 4;
+                } else if (p[2] & 1) {
+                    c[COST_2X1_RUN]++;
+                    c[COST_2X1_RUN_BLOCK] += (p[2] >> 1u) + 1;
+                    blocks += (p[2] >> 1u) + 1;
+                    p += 3;
+                } else {
+                    c[COST_2X1_DELTA]++;
+                    blocks++;
+                    p += 3;
+                }
+            }
+        }
+    } else {
+        // (this matches the 565 converter output, which is what popcorn is built for)
+        const uint8_t *p = image + from;
+        const uint8_t *end = image + to;
+        uint32_t *c = rc->counts[0];
+        c[COST_ROW] = 1;
+        for (uint blocks = 0; blocks < ROW_BLOCKS; blocks++) {
+            if (p + 3 > end) return false;
+            if (p[0] & 0x20) {
+                c[COST_2X2_RAW]++;
+                p += 7;
+            } else if (p[2] & 1) {
+                c[COST_2X2_PAT32]++;
+                p += 4;
+            } else {
+                c[COST_2X2_PAT4]++;
+                p += 3;
+            }
+        }
+    }
+    return true;
+}
+
+static double cost_of(const uint32_t *counts) {
+    double cycles = 0;
+    for (uint i = 0; i < COST_COUNT; i++) cycles += counts[i] * model[i];
+    return cycles;
+}
+
+// the decode cycles for what popcorn decodes when generating a scanline buffer: in linked mode a pair of rows; in
+// single row mode a whole 2x2 pair, or just one 2x1 row
+static double unit_cycles(const struct frame_header *head, const struct row_counts *rc, uint half) {
+    if (!options.single_row || head->format != PL2_FORMAT_2X1) {
+        return cost_of(rc->counts[0]) + cost_of(rc->counts[1]);
+    }
+    return cost_of(rc->counts[half]);
+}
+
+struct frame_result {
+    uint32_t late_units;
+    double min_slack; // cycles; negative if late
+};
+
+// two cores take scanline buffers in order as they become free; a buffer can't be started until the one
+// SCANLINE_BUFFER_COUNT before it has been displayed, and must be done before it is itself displayed
+static struct frame_result simulate_frame(const double *cycles, uint units, double sys_clk_mhz) {
+    double unit_lines = options.single_row ? 2 : 4;
+    uint buffers = options.single_row ? SCANLINE_BUFFER_COUNT : SCANLINE_BUFFER_COUNT / 2;
+    double line_cycles = LINE_NS * sys_clk_mhz / 1000.0;
+    double period = unit_lines * line_cycles;
+    double core_free[2] = {-VBLANK_LINES * line_cycles, -VBLANK_LINES * line_cycles};
+    struct frame_result r = {0, INFINITY};
+    for (uint u = 0; u < units; u++) {
+        uint core = core_free[0] <= core_free[1] ? 0 : 1;
+        double release = ((double) u - buffers + 1) * period;
+        double start = fmax(core_free[core], release);
+        double finish = start + cycles[u] + options.overhead;
+        core_free[core] = finish;
+        double slack = u * period - finish;
+        if (slack < 0) r.late_units++;
+        if (slack < r.min_slack) r.min_slack = slack;
+    }
+    return r;
+}
+
+// per unit cycles for a frame; returns the number of units, or 0 if the frame is bad
+static uint frame_cycles(uint32_t frame, double *cycles) {
+    const struct frame_header *head = read_frame(frame);
+    if (!head || head->height != 2 * MOVIE_ROWS) return 0;
+    uint units = 0;
+    for (uint row = 0; row < MOVIE_ROWS; row++) {
+        struct row_counts rc;
+        if (!count_row(head, row, &rc)) return 0;
+        for (uint half = 0; half < (options.single_row ? 2 : 1); half++) {
+            cycles[units++] = unit_cycles(head, &rc, half);
+        }
+    }
+    return units;
+}
+
+static void simulate(void) {
+    static double cycles[2 * MOVIE_ROWS];
+    uint32_t late_frames = 0, bad_frames = 0;
+    uint32_t worst_frame = 0;
+    double worst_slack = INFINITY;
+    double total_cycles = 0, peak_row = 0;
+    uint32_t listed = 0;
+    for (uint32_t f = 0; f < frame_count; f++) {
+        uint units = frame_cycles(f, cycles);
+        if (!units) {
+            bad_frames++;
+            continue;
+        }
+        for (uint u = 0; u < units; u++) {
+            total_cycles += cycles[u];
+            peak_row = fmax(peak_row, cycles[u]);
+        }
+        struct frame_result r = simulate_frame(cycles, units, options.sys_clk_mhz);
+        if (r.min_slack < worst_slack) {
+            worst_slack = r.min_slack;
+            worst_frame = f;
+        }
+        if (r.late_units) {
+            late_frames++;
+            if (options.verbose || listed < 20) {
+                const struct frame_header *head = read_header(frame_sectors[f]);
+                printf("late frame=%d time=%02x:%02x:%02x.%02x rows_late=%d worst_by=%.0f cycles\n", f, head->hh,
+                       head->mm, head->ss, head->ff, r.late_units, -r.min_slack);
+                listed++;
+            }
+        }
+    }
+    uint units_per_frame = options.single_row ? 2 * MOVIE_ROWS : MOVIE_ROWS;
+    printf("\n%d frames at %.0fMHz (%s): %d late", frame_count, options.sys_clk_mhz,
+           options.single_row ? "single row" : "linked rows", late_frames);
+    if (bad_frames) printf(", %d unreadable", bad_frames);
+    printf("\naverage decode %.0f cycles per scanline buffer, peak %.0f; worst frame %d with %.0f cycles slack\n",
+           total_cycles / ((double) (frame_count - bad_frames) * units_per_frame), peak_row, worst_frame, worst_slack);
+
+    if (!model_calibrated) {
+        printf("WARNING: these results use the default (uncalibrated) costs, so are only a rough guess, and no clock\n"
+               "         estimate is given. Calibrate with --calibrate (or pass a calibrated --model)\n");
+        return;
+    }
+    // how fast would we need to go for the worst frame to be ok
+    if (frame_cycles(worst_frame, cycles)) {
+        double lo = 1, hi = 1000;
+        while (hi - lo > 0.5) {
+            double mid = (lo + hi) / 2;
+            if (simulate_frame(cycles, units_per_frame, mid).late_units) lo = mid; else hi = mid;
+        }
+        printf("worst frame needs about %.0fMHz\n", hi);
+    }
+}
+
+// ---------------------------------------------------------------- calibration
+
+#define MAX_SAMPLES 65536
+
+static void calibrate(const char *log_filename) {
+    FILE *log = fopen(log_filename, "r");
+    if (!log) fail("can't open calibration log");
+    static double features[MAX_SAMPLES][COST_COUNT];
+    static double measured[MAX_SAMPLES];
+    uint n = 0;
+    uint skipped = 0;
+    char line[256];
+    uint32_t cached_frame = (uint32_t) -1;
+    const struct frame_header *head = NULL;
+    while (fgets(line, sizeof(line), log) && n < MAX_SAMPLES) {
+        uint frame, row, part, cycles;
+        const char *p = strstr(line, "decode frame=");
+        if (!p || 4 != sscanf(p, "decode frame=%u row=%u part=%u cycles=%u", &frame, &row, &part, &cycles)) continue;
+        // frame numbers are per movie, so this assumes the log is for this movie
+        if (frame >= frame_count || row >= MOVIE_ROWS || part > 2) {
+            skipped++;
+            continue;
+        }
+        if (frame != cached_frame) {
+            head = read_frame(frame);
+            cached_frame = frame;
+        }
+        struct row_counts rc;
+        if (!head || !count_row(head, row, &rc)) {
+            skipped++;
+            continue;
+        }
+        for (uint i = 0; i < COST_COUNT; i++) {
+            features[n][i] = part ? rc.counts[part - 1][i] : rc.counts[0][i] + rc.counts[1][i];
+        }
+        measured[n++] = cycles;
+    }
+    fclose(log);
+    if (n < 8) fail("not enough decode samples in the calibration log (build popcorn with POPCORN_DECODE_STATS=1)");
+
+    // least squares, pulled (weakly) towards the current model; for 2x2 the token counts always add up to the same
+    // number of blocks, so they and the per row cost can't be separated without it, and costs for tokens that never
+    // appear stay as they were
+    double ata[COST_COUNT][COST_COUNT + 1] = {{0}};
+    for (uint s = 0; s < n; s++) {
+        for (uint i = 0; i < COST_COUNT; i++) {
+            for (uint j = 0; j < COST_COUNT; j++) ata[i][j] += features[s][i] * features[s][j];
+            ata[i][COST_COUNT] += features[s][i] * measured[s];
+        }
+    }
+    double trace = 0;
+    for (uint i = 0; i < COST_COUNT; i++) trace += ata[i][i];
+    double lambda = 1e-4 * trace / COST_COUNT;
+    for (uint i = 0; i < COST_COUNT; i++) {
+        ata[i][i] += lambda;
+        ata[i][COST_COUNT] += lambda * model[i];
+    }
+    // gaussian elimination with partial pivoting
+    for (uint i = 0; i < COST_COUNT; i++) {
+        uint pivot = i;
+        for (uint k = i + 1; k < COST_COUNT; k++) if (fabs(ata[k][i]) > fabs(ata[pivot][i])) pivot = k;
+        for (uint j = 0; j <= COST_COUNT; j++) {
+            double t = ata[i][j];
+            ata[i][j] = ata[pivot][j];
+            ata[pivot][j] = t;
+        }
+        for (uint k = 0; k < COST_COUNT; k++) {
+            if (k == i) continue;
+            double f = ata[k][i] / ata[i][i];
+            for (uint j = i; j <= COST_COUNT; j++) ata[k][j] -= f * ata[i][j];
+        }
+    }
+    for (uint i = 0; i < COST_COUNT; i++) model[i] = ata[i][COST_COUNT] / ata[i][i];
+    model_calibrated = true;
+
+    double sum_sq = 0, worst = 0;
+    for (uint s = 0; s < n; s++) {
+        double predicted = 0;
+        for (uint i = 0; i < COST_COUNT; i++) predicted += features[s][i] * model[i];
+        double error = predicted - measured[s];
+        sum_sq += error * error;
+        worst = fmax(worst, fabs(error) / measured[s]);
+    }
+    printf("calibrated from %d samples (%d skipped): rms error %.0f cycles, worst %.1f%%\n", n, skipped,
+           sqrt(sum_sq / n), worst * 100);
+    for (uint i = 0; i < COST_COUNT; i++) printf("  %-14s %6.1f\n", cost_names[i], model[i]);
+    printf("  (--model ");
+    for (uint i = 0; i < COST_COUNT; i++) printf("%s%.1f", i ? "," : "", model[i]);
+    printf(")\n\n");
+}
+
+static void parse_model(const char *s) {
+    for (uint i = 0; i < COST_COUNT; i++) {
+        char *end;
+        model[i] = strtod(s, &end);
+        if (end == s || (i < COST_COUNT - 1 && *end != ',')) fail("--model needs a comma separated cost for each of "
+                                                                  "row,2x2_raw,2x2_pat32,2x2_pat4,2x1_raw,2x1_delta,"
+                                                                  "2x1_run,2x1_run_block");
+        s = end + 1;
+    }
+    model_calibrated = true;
+}
+
+int main(int argc, char **argv) {
+    const char *calibration = NULL;
+    const char *filename = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--sys-clk") && i + 1 < argc) {
+            options.sys_clk_mhz = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--single-row")) {
+            options.single_row = true;
+        } else if (!strcmp(argv[i], "--overhead") && i + 1 < argc) {
+            options.overhead = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--calibrate") && i + 1 < argc) {
+            calibration = argv[++i];
+        } else if (!strcmp(argv[i], "--model") && i + 1 < argc) {
+            parse_model(argv[++i]);
+        } else if (!strcmp(argv[i], "--verbose")) {
+            options.verbose = true;
+        } else if (argv[i][0] != '-' && !filename) {
+            filename = argv[i];
+        } else {
+            filename = NULL;
+            break;
+        }
+    }
+    if (!filename || options.sys_clk_mhz <= 0) {
+        fprintf(stderr, "usage: frame_sim [--sys-clk MHz] [--single-row] [--overhead cycles] [--calibrate log] "
+                        "[--model costs] [--verbose] movie.pl2\n"
+                        "  --sys-clk     clock to check against (default 48)\n"
+                        "  --single-row  model popcorn_320x240 (scanlines generated one at a time) rather than pairs\n"
+                        "  --overhead    cycles per scanline buffer other than decoding (default %d)\n"
+                        "  --calibrate   fit the costs to the output of popcorn built with POPCORN_DECODE_STATS=1\n"
+                        "  --model       costs as printed by --calibrate\n"
+                        "  --verbose     list every late frame, not just the first 20\n", DEFAULT_OVERHEAD_CYCLES);
+        return 1;
+    }
+    movie = fopen(filename, "rb");
+    if (!movie) fail("can't open movie");
+    index_frames();
+    if (calibration) calibrate(calibration);
+    if (!model_calibrated) {
+        fprintf(stderr, "WARNING: using the default decode costs, which are guesses rather than measurements; see "
+                        "--calibrate\n");
+    }
+    simulate();
+    fclose(movie);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Checks the audio_gain.h functions against a straightforward reference, and times them per sector (128 stereo
+// frames). Exits with a non zero status if any check fails.
+//
+// It also builds for the device (popcorn_gain_bench), which is the only way to check the __ARM_FEATURE_DSP version of
+// audio_gain_scale() (i.e. on RP2350).
+
+#include <stdio.h>
+#include <stdlib.h>
+#if PICO_ON_DEVICE
+#include "pico/stdlib.h"
+#else
+#include <time.h>
+#endif
+#include "audio_gain.h"
+
+#define SECTOR_FRAMES 128
+#define BUFFER_FRAMES (12 * SECTOR_FRAMES)
+
+static int failures;
+
+static uint32_t pack(int l, int r) {
+    return (uint16_t) l | ((uint32_t) (uint16_t) r << 16u);
+}
+
+static int left(uint32_t sample) { return (int16_t) sample; }
+
+static int right(uint32_t sample) { return (int16_t) (sample >> 16u); }
+
+static void fill(uint32_t *buffer, uint count, uint seed) {
+    srand(seed);
+    for (uint i = 0; i < count; i++) {
+        buffer[i] = pack((rand() & 0xffff) - 0x8000, (rand() & 0xffff) - 0x8000);
+    }
+    // make sure we hit the extremes
+    buffer[0] = pack(-32768, 32767);
+    buffer[1] = pack(32767, -32768);
+}
+
+// the gain functions may lose the bottom 8 bits of the gain, so allow for that
+static void check_sample(const char *what, uint i, uint32_t in, uint32_t out, int32_t gain) {
+    int vals_in[2] = {left(in), right(in)};
+    int vals_out[2] = {left(out), right(out)};
+    for (int c = 0; c < 2; c++) {
+        double expected = vals_in[c] * (double) gain / AUDIO_GAIN_UNITY;
+        double tolerance = abs(vals_in[c]) / 256.0 + 1;
+        if (vals_out[c] < expected - tolerance || vals_out[c] > expected + tolerance) {
+            if (failures++ < 10) {
+                printf("FAIL %s: frame %d channel %d in %d gain %08x out %d expected %f\n", what, i, c, vals_in[c],
+                       (int) gain, vals_out[c], expected);
+            }
+        }
+    }
+}
+
+// (static as they are too big for the stack on the device)
+static uint32_t in[BUFFER_FRAMES], out[BUFFER_FRAMES];
+
+static void check_apply(int32_t from, int32_t to) {
+    fill(in, BUFFER_FRAMES, from ^ to);
+    memcpy(out, in, sizeof(in));
+    int32_t step = audio_gain_step(from, to, BUFFER_FRAMES);
+    // as popcorn does it, a sector at a time
+    for (uint s = 0; s < BUFFER_FRAMES; s += SECTOR_FRAMES) {
+        audio_gain_apply(out + s, SECTOR_FRAMES, from + step * (int32_t) s, step);
+    }
+    for (uint i = 0; i < BUFFER_FRAMES; i++) {
+        check_sample("apply", i, in[i], out[i], from + step * (int32_t) i);
+    }
+}
+
+static void check_reverse(int32_t from, int32_t to) {
+    fill(in, BUFFER_FRAMES, from ^ to ^ 0x5555);
+    memcpy(out, in, sizeof(in));
+    int32_t step = audio_gain_step(from, to, BUFFER_FRAMES);
+    // outside in a pair of sectors at a time, as popcorn does it
+    for (int pair = BUFFER_FRAMES / SECTOR_FRAMES / 2 - 1; pair >= 0; pair--) {
+        uint frame1 = pair * SECTOR_FRAMES;
+        uint frame2 = BUFFER_FRAMES - SECTOR_FRAMES - frame1;
+        audio_gain_reverse(out + frame1, out + frame2, SECTOR_FRAMES, from + step * (int32_t) frame1,
+                           from + step * (int32_t) frame2, step);
+    }
+    for (uint i = 0; i < BUFFER_FRAMES; i++) {
+        check_sample("reverse", i, in[BUFFER_FRAMES - 1 - i], out[i], from + step * (int32_t) i);
+    }
+}
+
+// the buffer is played from the end backwards by the DMA, so the ramp is applied backwards from the last frame that
+// is played (which needn't be the end of the last sector)
+static void check_playback_reverse(int32_t from, int32_t to) {
+    const uint played = BUFFER_FRAMES - 37;
+    fill(in, BUFFER_FRAMES, from ^ to ^ 0xaaaa);
+    memcpy(out, in, sizeof(in));
+    int32_t step = audio_gain_step(from, to, BUFFER_FRAMES);
+    int32_t gain = from + step * (int32_t) (played - 1);
+    // as popcorn does it, outside in a pair of sectors at a time
+    for (int pair = BUFFER_FRAMES / SECTOR_FRAMES / 2 - 1; pair >= 0; pair--) {
+        uint frame1 = pair * SECTOR_FRAMES;
+        uint frame2 = BUFFER_FRAMES - SECTOR_FRAMES - frame1;
+        audio_gain_apply(out + frame1, SECTOR_FRAMES, gain - step * (int32_t) frame1, -step);
+        audio_gain_apply(out + frame2, SECTOR_FRAMES, gain - step * (int32_t) frame2, -step);
+    }
+    for (uint i = 0; i < played; i++) {
+        check_sample("playback reverse", i, in[i], out[i], from + step * (int32_t) (played - 1 - i));
+    }
+}
+
+static double now(void) {
+#if PICO_ON_DEVICE
+    return time_us_64() * 1e-6;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+static volatile uint32_t sink;
+
+static void time_apply(const char *what, int32_t from, int32_t to) {
+    static uint32_t buffer[BUFFER_FRAMES];
+    fill(buffer, BUFFER_FRAMES, 1);
+    int32_t step = audio_gain_step(from, to, BUFFER_FRAMES);
+    const int iterations = 20000;
+    double t0 = now();
+    for (int n = 0; n < iterations; n++) {
+        for (uint s = 0; s < BUFFER_FRAMES; s += SECTOR_FRAMES) {
+            audio_gain_apply(buffer + s, SECTOR_FRAMES, from + step * (int32_t) s, step);
+        }
+        sink += buffer[n % BUFFER_FRAMES];
+    }
+    double t = now() - t0;
+    printf("%-24s %8.1f ns/sector\n", what, t * 1e9 / (iterations * (BUFFER_FRAMES / SECTOR_FRAMES)));
+}
+
+static void time_reverse(const char *what, int32_t from, int32_t to) {
+    static uint32_t buffer[BUFFER_FRAMES];
+    fill(buffer, BUFFER_FRAMES, 2);
+    int32_t step = audio_gain_step(from, to, BUFFER_FRAMES);
+    const int iterations = 20000;
+    double t0 = now();
+    for (int n = 0; n < iterations; n++) {
+        for (int pair = BUFFER_FRAMES / SECTOR_FRAMES / 2 - 1; pair >= 0; pair--) {
+            uint frame1 = pair * SECTOR_FRAMES;
+            uint frame2 = BUFFER_FRAMES - SECTOR_FRAMES - frame1;
+            audio_gain_reverse(buffer + frame1, buffer + frame2, SECTOR_FRAMES, from + step * (int32_t) frame1,
+                               from + step * (int32_t) frame2, step);
+        }
+        sink += buffer[n % BUFFER_FRAMES];
+    }
+    double t = now() - t0;
+    printf("%-24s %8.1f ns/sector\n", what, t * 1e9 / (iterations * (BUFFER_FRAMES / SECTOR_FRAMES)));
+}
+
+int main(void) {
+#if PICO_ON_DEVICE
+    stdio_init_all();
+#endif
+#if __ARM_FEATURE_DSP
+    printf("audio_gain_scale: DSP\n");
+#else
+    printf("audio_gain_scale: C\n");
+#endif
+    static const int32_t gains[] = {0, 0x800, 0x8000, 0xf800, AUDIO_GAIN_UNITY};
+    const int gain_count = sizeof(gains) / sizeof(gains[0]);
+    for (int i = 0; i < gain_count; i++) {
+        for (int j = 0; j < gain_count; j++) {
+            check_apply(gains[i], gains[j]);
+            check_reverse(gains[i], gains[j]);
+            check_playback_reverse(gains[i], gains[j]);
+        }
+    }
+    printf("%s\n\n", failures ? "checks FAILED" : "checks passed");
+
+    time_apply("unity", AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY);
+    time_apply("mute", 0, 0);
+    time_apply("constant", 0x8000, 0x8000);
+    time_apply("ramp", 0x8000, 0x8800);
+    time_reverse("reverse unity", AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY);
+    time_reverse("reverse mute", 0, 0);
+    time_reverse("reverse constant", 0x8000, 0x8000);
+    time_reverse("reverse ramp", 0x8000, 0x8800);
+    return failures ? 1 : 0;
+}
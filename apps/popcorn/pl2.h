@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_PL2_H
+#define _POPCORN_PL2_H
+
+#include <stdint.h>
+
+// The .pl2 movie format (as written by the converter). Each frame is a header sector (struct frame_header followed
+// by the row offsets), then audio_words of 16 bit stereo audio padded to a whole sector, then image_words of
+// compressed image data padded to a whole sector.
+//
+// The image is coded a pair of rows at a time (row_offsets are per pair). For PL2_FORMAT_2X1 (see platypus_2x1.h)
+// each row is coded separately, and the row_offsets are followed by a byte per pair giving the offset in words of the
+// second row from the first.
+
+#define PLATYPUS_MAGIC (('T'<<24)|('A'<<16)|('L'<<8)|'P')
+// version written by the converter
+#define PLAT_MAJOR 0
+#define PLAT_MINOR 60
+
+#define PL2_FORMAT_2X2 0
+#define PL2_FORMAT_2X1 1
+
+struct frame_header {
+    uint32_t mark0;
+    uint32_t mark1;
+    uint32_t magic;
+    uint8_t major, minior, debug, format; // format was always 0 (PL2_FORMAT_2X2) before 2x1
+    uint32_t sector_number; // relative to start of stream
+    uint32_t frame_number;
+    uint8_t hh, mm, ss, ff; // good old CD days (bcd)
+    uint32_t header_words;
+    uint16_t width;
+    uint16_t height;
+    uint32_t image_words;
+    uint32_t audio_words; // just to confirm really
+    uint32_t audio_freq;
+    uint8_t audio_channels; // always assume 16 bit
+    uint8_t pad[3];
+    uint32_t unused[4]; // little space for expansion
+    uint32_t total_sectors;
+    uint32_t last_sector;
+    // 1, 2, 4, 8 frame increments
+    uint32_t forward_frame_sector[4];
+    uint32_t backward_frame_sectors[4];
+    // h/2 + 1 row_offsets, last one should == image_words
+    uint16_t row_offsets[];
+} __attribute__((packed));
+
+static inline int pl2_is_frame_header(const struct frame_header *head) {
+    return head->mark0 == 0xffffffff && head->mark1 == 0xffffffff && head->magic == PLATYPUS_MAGIC;
+}
+
+// total sectors taken by a frame, including its header
+static inline uint32_t pl2_frame_sectors(const struct frame_header *head) {
+    return 1 + (head->audio_words + 127) / 128 + (head->image_words + 127) / 128;
+}
+
+// for PL2_FORMAT_2X1, the word offset of the second row of each pair
+static inline const uint8_t *pl2_row_splits(const struct frame_header *head) {
+    return (const uint8_t *) (head->row_offsets + head->height / 2 + 1);
+}
+
+#endif
@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Checks .pl2 movies (or raw SD card images holding them) for the damage that otherwise only shows up on the device as
+// a panic or popcorn endlessly restarting: truncated or partially written frames, bad frame headers, row data that
+// doesn't decode to a whole row, and seek tables (forward/backward frame links, last_sector, total_sectors) that don't
+// match the frames which are actually there.
+//
+// The file is streamed through once in big reads, so it runs at disk speed and copes with files of any size; only
+// the seek table entries of each frame are kept (44 bytes a frame). With --repair the seek tables of each movie are
+// then rewritten in place to link just the good frames, so popcorn plays what is there and stops (or loops) cleanly.
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pl2.h"
+#include "platypus_2x1.h"
+
+// what popcorn expects
+#define MOVIE_WIDTH 320
+#define MOVIE_HEIGHT 240
+#define ROW_BLOCKS 160
+
+#define CHUNK_SECTORS 16384 // 8M
+
+static struct {
+    bool repair;
+    bool headers_only;
+    bool verbose;
+    uint max_messages;
+} options = {false, false, false, 20};
+
+static FILE *file;
+static uint64_t file_sectors;
+
+// ---------------------------------------------------------------- streaming
+
+static struct {
+    uint8_t *data;
+    uint64_t first; // sector
+    uint32_t count;
+} chunk;
+
+static uint64_t bytes_read;
+
+// returns the sectors [sector, sector + count), reading forward through the file; NULL past the end of the file
+static const uint8_t *get_sectors(uint64_t sector, uint32_t count) {
+    if (sector + count > file_sectors) return NULL;
+    if (sector < chunk.first || sector + count > chunk.first + chunk.count) {
+        if (fseeko(file, (off_t) (sector * 512), SEEK_SET)) return NULL;
+        uint64_t want = file_sectors - sector < CHUNK_SECTORS ? file_sectors - sector : CHUNK_SECTORS;
+        size_t got = fread(chunk.data, 512, want, file);
+        bytes_read += got * 512;
+        chunk.first = sector;
+        chunk.count = got;
+        if (got < count) return NULL;
+    }
+    return chunk.data + (sector - chunk.first) * 512;
+}
+
+// ---------------------------------------------------------------- checking
+
+// the seek table part of the header, from total_sectors on
+struct seek_entry {
+    uint32_t total_sectors;
+    uint32_t last_sector;
+    uint32_t forward_frame_sector[4];
+    uint32_t backward_frame_sectors[4];
+};
+
+struct frame {
+    uint32_t sector; // relative to the start of the movie
+    struct seek_entry seek;
+};
+
+struct movie {
+    uint64_t base; // sector
+    struct frame *frames;
+    uint32_t frame_count;
+    uint32_t capacity;
+    uint32_t end_sector; // relative, after the last good frame
+    uint32_t errors; // in the frames themselves (so they have been dropped)
+    uint32_t seek_errors; // fixable by --repair
+    uint32_t gaps;
+    uint32_t unlinked; // frames the seek tables already go round (e.g. after --repair)
+    uint32_t first_frame_number;
+    uint32_t last_frame_number;
+    bool truncated;
+    struct movie *next;
+};
+
+static struct movie *movies, **last_movie = &movies;
+static uint messages;
+static bool quiet;
+static uint32_t total_errors;
+
+static void report(const struct movie *m, uint32_t sector, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+static void report(const struct movie *m, uint32_t sector, const char *fmt, ...) {
+    if (quiet) return;
+    if (!options.verbose && messages >= options.max_messages) {
+        if (messages++ == options.max_messages) printf("  (more; use --verbose to see everything)\n");
+        return;
+    }
+    messages++;
+    printf("  movie@%llu sector %u: ", (unsigned long long) (m ? m->base : 0), sector);
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+}
+
+// check one row pair token by token (565 layout, as popcorn is built), returning false if it doesn't fill a whole
+// row exactly within its data
+static bool check_row_tokens(const struct frame_header *head, const uint8_t *image, uint row) {
+    const uint8_t *p = image + head->row_offsets[row] * 4u;
+    const uint8_t *end = image + head->row_offsets[row + 1] * 4u;
+    if (head->format == PL2_FORMAT_2X1) {
+        const uint8_t *split = p + pl2_row_splits(head)[row] * 4u;
+        if (split <= p || split >= end) return false;
+        uint16_t raw_flag = platypus_2x1_raw_flag(true);
+        for (uint part = 0; part < 2; part++) {
+            const uint8_t *q = part ? split : p;
+            const uint8_t *q_end = part ? end : split;
+            uint blocks = 0;
+            while (blocks < ROW_BLOCKS) {
+                if (q + 3 > q_end) return false;
+                if ((q[0] | (q[1] << 8u)) & raw_flag) {
+                    blocks++;
+                    q += 4;
+                } else {
+                    blocks += (q[2] & 1) ? (q[2] >> 1u) + 1 : 1;
+                    q += 3;
+                }
+            }
+            // runs must stop at the end of the row, and only word padding is allowed
+            if (blocks != ROW_BLOCKS || q > q_end || q_end - q >= 4) return false;
+        }
+        return true;
+    }
+    uint blocks;
+    // every token is at least 3 bytes, so this is enough to look at p[0] and p[2]; a longer token running off the
+    // end shows up as negative slack
+    for (blocks = 0; blocks < ROW_BLOCKS && p + 3 <= end; blocks++) {
+        p += (p[0] & 0x20) ? 7 : (p[2] & 1) ? 4 : 3;
+    }
+    int slack = (int) (end - p);
+    if (head->debug) slack -= 4; // end of row marker
+    return blocks == ROW_BLOCKS && slack >= 0 && slack < 4;
+}
+
+// checks everything about a frame other than its seek table; returns false if popcorn can't play it
+static bool check_frame(struct movie *m, uint32_t rel, const struct frame_header *head) {
+    if (head->major != PLAT_MAJOR) {
+        report(m, rel, "version %d.%d, expected %d.x", head->major, head->minior, PLAT_MAJOR);
+        return false;
+    }
+    if (head->sector_number != rel) {
+        report(m, rel, "sector_number is %u", head->sector_number);
+        return false;
+    }
+    if (head->header_words > 128) {
+        report(m, rel, "header_words %u is more than a sector", head->header_words);
+        return false;
+    }
+    if (head->width != MOVIE_WIDTH || head->height != MOVIE_HEIGHT) {
+        report(m, rel, "%dx%d, expected %dx%d", head->width, head->height, MOVIE_WIDTH, MOVIE_HEIGHT);
+        return false;
+    }
+    if (head->format != PL2_FORMAT_2X2 && head->format != PL2_FORMAT_2X1) {
+        report(m, rel, "unknown format %d", head->format);
+        return false;
+    }
+    uint rows = head->height / 2;
+    if (head->row_offsets[0]) {
+        report(m, rel, "first row offset is %d", head->row_offsets[0]);
+        return false;
+    }
+    for (uint r = 0; r < rows; r++) {
+        if (head->row_offsets[r + 1] <= head->row_offsets[r]) {
+            report(m, rel, "row offsets not increasing at row %d", r);
+            return false;
+        }
+    }
+    if (head->row_offsets[rows] != head->image_words) {
+        report(m, rel, "image_words %u doesn't match the row offsets (%u)", head->image_words, head->row_offsets[rows]);
+        return false;
+    }
+    if (head->audio_words) {
+        uint32_t audio_sectors = (head->audio_words + 127) / 128;
+        if (head->audio_channels != 2 || (audio_sectors & 1)) {
+            // popcorn handles audio a pair of sectors at a time
+            report(m, rel, "audio must be stereo in an even number of sectors (%d channels, %u sectors)",
+                   head->audio_channels, audio_sectors);
+            return false;
+        }
+    }
+    if (options.headers_only) return true;
+    uint32_t image_sectors = (head->image_words + 127) / 128;
+    const uint8_t *image = get_sectors(m->base + rel + 1 + (head->audio_words + 127) / 128, image_sectors);
+    if (!image) return false; // truncated; reported by the caller
+    for (uint r = 0; r < rows; r++) {
+        if (!check_row_tokens(head, image, r)) {
+            report(m, rel, "row %d data is corrupt", r);
+            return false;
+        }
+        if (head->debug) {
+            uint32_t o = head->row_offsets[r + 1] * 4u - 4;
+            const uint8_t *marker = image + o;
+            if (marker[0] != 0xaa || marker[1] != (uint8_t) (o + 1) || marker[2] != (uint8_t) head->frame_number ||
+                marker[3] != (uint8_t) r) {
+                report(m, rel, "row %d end marker is wrong", r);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static struct movie *new_movie(uint64_t base, const struct frame_header *head) {
+    struct movie *m = calloc(1, sizeof(struct movie));
+    m->base = base;
+    m->first_frame_number = head->frame_number;
+    *last_movie = m;
+    last_movie = &m->next;
+    if (head->sector_number) {
+        m->errors++;
+        report(m, head->sector_number, "movie start is missing; first frame found is %u", head->frame_number);
+    }
+    return m;
+}
+
+static void add_frame(struct movie *m, uint32_t rel, const struct frame_header *head) {
+    if (m->frame_count == m->capacity) {
+        m->capacity = m->capacity ? m->capacity * 2 : 4096;
+        m->frames = realloc(m->frames, m->capacity * sizeof(struct frame));
+        if (!m->frames) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    struct frame *f = &m->frames[m->frame_count++];
+    f->sector = rel;
+    memcpy(&f->seek, &head->total_sectors, sizeof(struct seek_entry));
+    m->end_sector = rel + pl2_frame_sectors(head);
+    m->last_frame_number = head->frame_number;
+}
+
+// what the seek table of frame i should be
+static void expected_seek(const struct movie *m, uint32_t i, struct seek_entry *e) {
+    e->total_sectors = m->end_sector;
+    e->last_sector = m->frames[m->frame_count - 1].sector;
+    for (uint k = 0; k < 4; k++) {
+        uint32_t step = 1u << k;
+        e->forward_frame_sector[k] = i + step < m->frame_count ? m->frames[i + step].sector : 0xffffffff;
+        e->backward_frame_sectors[k] = i >= step ? m->frames[i - step].sector : 0xffffffff;
+    }
+}
+
+static void check_seek_tables(struct movie *m) {
+    for (uint32_t i = 0; i < m->frame_count; i++) {
+        struct seek_entry e;
+        expected_seek(m, i, &e);
+        const struct seek_entry *s = &m->frames[i].seek;
+        if (memcmp(&e, s, sizeof(e))) {
+            if (!m->seek_errors) {
+                report(m, m->frames[i].sector, "seek table is wrong (forward %08x %08x %08x %08x, backward %08x %08x "
+                                               "%08x %08x, last %u, total %u)",
+                       s->forward_frame_sector[0], s->forward_frame_sector[1], s->forward_frame_sector[2],
+                       s->forward_frame_sector[3], s->backward_frame_sectors[0], s->backward_frame_sectors[1],
+                       s->backward_frame_sectors[2], s->backward_frame_sectors[3], s->last_sector, s->total_sectors);
+            }
+            m->seek_errors++;
+        }
+    }
+}
+
+// rewrite the seek tables which are wrong; returns the number rewritten
+static uint32_t repair_seek_tables(struct movie *m) {
+    uint32_t fixed = 0;
+    for (uint32_t i = 0; i < m->frame_count; i++) {
+        struct seek_entry e;
+        expected_seek(m, i, &e);
+        if (!memcmp(&e, &m->frames[i].seek, sizeof(e))) continue;
+        off_t offset = (off_t) ((m->base + m->frames[i].sector) * 512 + offsetof(struct frame_header, total_sectors));
+        if (fseeko(file, offset, SEEK_SET) || 1 != fwrite(&e, sizeof(e), 1, file)) {
+            fprintf(stderr, "write failed\n");
+            exit(2);
+        }
+        m->frames[i].seek = e;
+        fixed++;
+    }
+    return fixed;
+}
+
+static const struct frame_header *header_at(uint64_t sector) {
+    const struct frame_header *head = (const struct frame_header *) get_sectors(sector, 1);
+    return head && pl2_is_frame_header(head) ? head : NULL;
+}
+
+// true if there is a good frame of m at sector, without reporting anything
+static bool good_frame_at(struct movie *m, uint64_t sector) {
+    const struct frame_header *head = header_at(sector);
+    if (!head || head->sector_number > sector || sector - head->sector_number != m->base) return false;
+    static uint8_t header_copy[512];
+    memcpy(header_copy, head, 512);
+    head = (const struct frame_header *) header_copy;
+    if (sector + pl2_frame_sectors(head) > file_sectors) return false;
+    quiet = true;
+    bool ok = check_frame(m, head->sector_number, head);
+    quiet = false;
+    return ok;
+}
+
+// one pass through the file, finding movies and checking each frame
+static void scan(void) {
+    struct movie *m = NULL;
+    struct movie *finished = NULL;
+    uint64_t next_header = 0; // where the next frame of m should be
+    bool in_sync = false;
+    uint64_t sector = 0;
+    uint64_t progress = 0;
+    while (sector < file_sectors) {
+        if (sector >= progress && isatty(fileno(stderr))) {
+            fprintf(stderr, "\r%llu/%llu MB", (unsigned long long) (sector >> 11), (unsigned long long) (file_sectors >> 11));
+            progress = sector + (1u << 18);
+        }
+        if (m && in_sync && sector == next_header) {
+            uint32_t rel = (uint32_t) (sector - m->base);
+            uint32_t linked = m->frames[m->frame_count - 1].seek.forward_frame_sector[0];
+            if (linked != 0xffffffff && linked > rel && !good_frame_at(m, sector) && good_frame_at(m, m->base + linked)) {
+                // a bad frame which the seek table already skips
+                m->unlinked++;
+                sector = next_header = m->base + linked;
+                continue;
+            }
+        }
+        const struct frame_header *head = header_at(sector);
+        if (m && in_sync && sector == next_header) {
+            uint32_t rel = (uint32_t) (sector - m->base);
+            if (!head) {
+                report(m, rel, "no frame header after frame %u", m->last_frame_number);
+                m->errors++;
+                in_sync = false;
+                sector++;
+                continue;
+            }
+            if (head->sector_number != rel) {
+                // a frame of another movie (e.g. the next one starting straight after this one, without it finishing)
+                report(m, rel, "movie ends after %u frames, before its last frame", m->frame_count);
+                m->truncated = true;
+                m = NULL;
+                continue;
+            }
+        } else if (!head) {
+            sector++;
+            continue;
+        } else if (!m || head->sector_number > sector || sector - head->sector_number != m->base) {
+            // a frame from somewhere else; either a new movie, or (if head isn't the start) the rest of a damaged one
+            if (m && !m->truncated && m->frame_count && m->frames[m->frame_count - 1].sector != m->frames[0].seek.last_sector) {
+                m->truncated = true;
+            }
+            if (head->sector_number > sector) {
+                sector++;
+                continue;
+            }
+            if (!m && finished && sector - head->sector_number == finished->base) {
+                // left over after the end of a movie (e.g. the partial last frame of one repaired by --repair)
+                finished->unlinked++;
+                sector++;
+                continue;
+            }
+            m = new_movie(sector - head->sector_number, head);
+        } else {
+            // back in sync with the movie after some damage
+            m->gaps++;
+            report(m, (uint32_t) (sector - m->base), "picking up again at frame %u", head->frame_number);
+        }
+        uint32_t rel = (uint32_t) (sector - m->base);
+        // copy the header, as checking the image may move the chunk
+        static uint8_t header_copy[512];
+        memcpy(header_copy, head, 512);
+        head = (const struct frame_header *) header_copy;
+        uint32_t frame_sectors = pl2_frame_sectors(head);
+        if (sector + frame_sectors > file_sectors) {
+            report(m, rel, "frame %u is cut off by the end of the file", head->frame_number);
+            m->truncated = true;
+            m->errors++;
+            break;
+        }
+        if (!check_frame(m, rel, head)) {
+            m->errors++;
+            // skip over what looks like the frame; if it isn't, we'll resync from the next header we find
+            in_sync = false;
+            sector++;
+            continue;
+        }
+        add_frame(m, rel, head);
+        in_sync = true;
+        next_header = sector + frame_sectors;
+        sector = next_header;
+        if (rel == head->last_sector && head->forward_frame_sector[0] == 0xffffffff) {
+            // that's the whole movie
+            finished = m;
+            m = NULL;
+        }
+    }
+    if (m && m->frame_count && m->frames[m->frame_count - 1].sector != m->frames[0].seek.last_sector) {
+        m->truncated = true;
+    }
+    if (isatty(fileno(stderr))) fprintf(stderr, "\r%*s\r", 40, "");
+}
+
+int main(int argc, char **argv) {
+    const char *filename = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--repair")) {
+            options.repair = true;
+        } else if (!strcmp(argv[i], "--headers-only")) {
+            options.headers_only = true;
+        } else if (!strcmp(argv[i], "--verbose")) {
+            options.verbose = true;
+        } else if (argv[i][0] != '-' && !filename) {
+            filename = argv[i];
+        } else {
+            filename = NULL;
+            break;
+        }
+    }
+    if (!filename) {
+        fprintf(stderr, "usage: pl2check [--repair] [--headers-only] [--verbose] <movie.pl2 | sd_card.img | /dev/sdX>\n"
+                        "  --repair        rewrite the seek tables in place to link only the good frames\n"
+                        "  --headers-only  just check the frame headers, not the row data\n"
+                        "  --verbose       report every problem, not just the first %d\n", options.max_messages);
+        return 2;
+    }
+    file = fopen(filename, options.repair ? "r+b" : "rb");
+    if (!file) {
+        fprintf(stderr, "can't open %s\n", filename);
+        return 2;
+    }
+    fseeko(file, 0, SEEK_END);
+    file_sectors = (uint64_t) ftello(file) / 512;
+    chunk.data = malloc(CHUNK_SECTORS * 512);
+    chunk.first = UINT64_MAX;
+    if (!chunk.data) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    scan();
+
+    uint movie_count = 0;
+    uint32_t unfixed = 0;
+    for (struct movie *m = movies; m; m = m->next) {
+        movie_count++;
+        if (!m->frame_count) continue;
+        check_seek_tables(m);
+        const struct frame *last = &m->frames[m->frame_count - 1];
+        printf("movie at sector %llu: %u frames (%u sectors)", (unsigned long long) m->base, m->frame_count,
+               m->end_sector);
+        if (m->errors) printf(", %u bad frames", m->errors);
+        if (m->gaps) printf(", %u gaps", m->gaps);
+        if (m->unlinked) printf(", %u frames not linked in", m->unlinked);
+        if (m->truncated) printf(", truncated (ends at sector %u, expected %u)", last->sector, m->frames[0].seek.last_sector);
+        if (m->seek_errors) printf(", %u wrong seek tables", m->seek_errors);
+        if (!m->errors && !m->gaps && !m->truncated && !m->seek_errors) printf(", ok");
+        printf("\n");
+        total_errors += m->errors + m->seek_errors;
+        if (m->seek_errors) {
+            if (options.repair) {
+                printf("  rewrote %u seek tables\n", repair_seek_tables(m));
+            } else {
+                unfixed += m->seek_errors;
+            }
+        }
+    }
+    if (!movie_count) {
+        printf("no movies found\n");
+        fclose(file);
+        return 1;
+    }
+    if (fclose(file)) {
+        fprintf(stderr, "write failed\n");
+        return 2;
+    }
+    printf("%llu MB read\n", (unsigned long long) (bytes_read >> 20));
+    if (unfixed) printf("run with --repair to fix the seek tables\n");
+    return total_errors ? 1 : 0;
+}
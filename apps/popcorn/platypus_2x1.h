@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_PLATYPUS_2X1_H
+#define _POPCORN_PLATYPUS_2X1_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The 2x1 variant of the platypus codec (PL2_FORMAT_2X1), which codes each pixel row on its own in blocks of two
+// horizontally adjacent pixels, rather than 2x2 blocks spanning a pair of rows. This keeps full vertical resolution,
+// and lets a row be decoded without its neighbour (i.e. into a single scanline buffer).
+//
+// Each block starts with a little-endian 16 bit color c (which is also the first pixel); the flag bit (the otherwise
+// unused green LSB for 565, or bit 15 for 555) marks a raw block:
+//
+// c | FLAG, b      raw: the second pixel is b (4 bytes)
+// c, t (t & 1)     run: (t >> 1) + 1 blocks, all of color c (3 bytes)
+// c, t (!(t & 1))  delta: the second pixel is c + a delta per channel (3 bytes); t bits 2-3, 4-5 and 6-7 select
+//                  {0, 1, -1, 2} for R, G, B respectively, shifted left by bit 1 of t
+//
+// Rows are padded to a whole word. The encoder (converter --2x1) never produces a delta that overflows a channel, or
+// a run that goes past the end of the row.
+//
+// This is plain inline C with no SDK dependencies, so the converter uses it to check what it wrote.
+
+#define PLATYPUS_2X1_DELTA_COUNT 128
+
+static inline uint16_t platypus_2x1_raw_flag(bool rgb565) {
+    return rgb565 ? 0x0020 : 0x8000;
+}
+
+static inline int32_t platypus_2x1_channel_delta(uint32_t code, uint32_t scale) {
+    static const int8_t deltas[4] = {0, 1, -1, 2};
+    return deltas[code & 3] * (1 << scale);
+}
+
+// the delta to add to c for a delta token t, indexed by t >> 1
+static inline void platypus_2x1_build_deltas(int16_t deltas[PLATYPUS_2X1_DELTA_COUNT], bool rgb565) {
+    for (uint32_t i = 0; i < PLATYPUS_2X1_DELTA_COUNT; i++) {
+        uint32_t scale = i & 1;
+        deltas[i] = (int16_t) (platypus_2x1_channel_delta(i >> 1, scale) +
+                               platypus_2x1_channel_delta(i >> 3, scale) * (1 << (rgb565 ? 6 : 5)) +
+                               platypus_2x1_channel_delta(i >> 5, scale) * (1 << (rgb565 ? 11 : 10)));
+    }
+}
+
+// decode a row of words * 2 pixels into row, returning the start of the next row
+static inline const uint32_t *platypus_2x1_decompress_row(uint32_t *row, const uint32_t *compressed, uint32_t words,
+                                                          const int16_t *deltas, uint16_t raw_flag) {
+    const uint8_t *p = (const uint8_t *) compressed;
+    uint32_t *end = row + words;
+    while (row < end) {
+        uint32_t c = p[0] | (p[1] << 8u);
+        if (c & raw_flag) {
+            *row++ = (c ^ raw_flag) | ((uint32_t) (p[2] | (p[3] << 8u)) << 16u);
+            p += 4;
+        } else {
+            uint32_t t = p[2];
+            p += 3;
+            if (t & 1) {
+                uint32_t cc = c | (c << 16u);
+                for (uint32_t n = (t >> 1u) + 1; n; n--) {
+                    *row++ = cc;
+                }
+            } else {
+                *row++ = c | ((uint32_t) (uint16_t) (c + deltas[t >> 1u]) << 16u);
+            }
+        }
+    }
+    return (const uint32_t *) (((uintptr_t) p + 3) & ~(uintptr_t) 3);
+}
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <malloc.h>
 
 #include "pico/stdlib.h"
 #include "pico/scanvideo.h"
@@ -25,6 +26,99 @@
 #include "hardware/clocks.h"
 #include "platypus.h"
 #include "font.h"
+#include "fat.h"
+#include "pl2.h"
+#include "audio_gain.h"
+#include "platypus_2x1.h"
+
+// slowed down (or frame skipped) playback keeps its audio, time stretched to the playback speed without changing pitch
+#ifndef POPCORN_TIME_STRETCH
+#define POPCORN_TIME_STRETCH 1
+#endif
+// print the cost of the time stretching per audio buffer every so often
+#ifndef POPCORN_TIME_STRETCH_STATS
+#define POPCORN_TIME_STRETCH_STATS 0
+#endif
+
+// only blend the parts of the menu overlay which actually have something drawn in them; the rest is just darkened
+#ifndef POPCORN_OVERLAY_SPANS
+#define POPCORN_OVERLAY_SPANS 1
+#endif
+// print the average cost of an overlaid scanline (pair) every so often
+#ifndef POPCORN_OVERLAY_STATS
+#define POPCORN_OVERLAY_STATS 0
+#endif
+
+// print the cycles taken to decode a sample row every few frames, for calibrating frame_sim
+#ifndef POPCORN_DECODE_STATS
+#define POPCORN_DECODE_STATS 0
+#endif
+
+// use the menu fonts from font_prebuilt.c (in flash) rather than rendering them into RAM at startup
+#ifndef POPCORN_PREBUILT_FONTS
+#define POPCORN_PREBUILT_FONTS 1
+#endif
+// remember the current movie and position in flash when pausing, changing movie or reaching the end of one, and carry
+// on from there at boot
+#ifndef POPCORN_RESUME
+#define POPCORN_RESUME 1
+#endif
+// also save the position this often during playback (0 for only on pause/change of movie). these saves are only done
+// when they are just a page program, which happens at the start of vblank so as not to hold up the video
+#ifndef POPCORN_RESUME_INTERVAL_MS
+#define POPCORN_RESUME_INTERVAL_MS 5000
+#endif
+// how far back from a saved position to look for a frame header, if it isn't one (e.g. the movie was re-converted)
+#ifndef POPCORN_RESUME_SEEK_SECTORS
+#define POPCORN_RESUME_SEEK_SECTORS 64
+#endif
+
+// on RP2350 the DMA can read backwards, so the I2S DMA plays reversed audio straight out of the buffer it was read to
+#ifndef POPCORN_AUDIO_DMA_REVERSE
+#define POPCORN_AUDIO_DMA_REVERSE PICO_RP2350
+#endif
+#define AUDIO_DMA_CHANNEL 1
+
+// optional brightness/gamma, scanline and letterbox filters applied to the decoded rows (cycled with 'f')
+#ifndef POPCORN_SCANLINE_FILTERS
+#define POPCORN_SCANLINE_FILTERS 1
+#endif
+// the brightness/gamma (LUT) filter costs ~3 table loads per pixel, ~9-10k cycles per row pair, which doesn't fit
+// alongside the decode at the stock 48/50MHz; it is skipped below this system clock. This is an estimate from the
+// per pixel cost and has not been measured on device (POPCORN_DECODE_STATS prints the filter cycles too)
+#ifndef POPCORN_LUT_FILTER_MIN_MHZ
+#define POPCORN_LUT_FILTER_MIN_MHZ 100
+#endif
+
+// RP2350 only: a 320x240 video mode (at a higher system clock) where each scanline is generated on its own rather
+// than as a linked pair; movies coded 2x1 (converter --2x1) are then decoded a single row at a time
+#ifndef POPCORN_SINGLE_ROW
+#define POPCORN_SINGLE_ROW 0
+#endif
+#if POPCORN_SINGLE_ROW
+#if !PICO_RP2350
+#error POPCORN_SINGLE_ROW needs the extra performance of RP2350
+#endif
+#if PICO_SCANVIDEO_LINKED_SCANLINE_BUFFERS
+#error POPCORN_SINGLE_ROW does not use linked scanline buffers
+#endif
+#endif
+
+#if POPCORN_TIME_STRETCH
+#include "time_stretch.h"
+#endif
+#if POPCORN_SCANLINE_FILTERS
+#include "scanline_filter.h"
+#endif
+#if POPCORN_AUDIO_DMA_REVERSE
+#include "hardware/dma.h"
+#endif
+#if POPCORN_RESUME
+#include "resume.h"
+#endif
+#if POPCORN_TIME_STRETCH_STATS || POPCORN_OVERLAY_STATS || POPCORN_DECODE_STATS
+#include "hardware/structs/systick.h"
+#endif
 
 #ifdef VGABOARD_BUTTON_A_PIN
 #define USE_VGABOARD_BUTTONS 1
@@ -58,7 +152,15 @@ static const struct scanvideo_mode vga_mode_320x120_60 =
                 .yscale = 4, // * 4 = 480
         };
 
+#if POPCORN_SINGLE_ROW
+// (the standard mode from pico_scanvideo)
+#define vga_mode vga_mode_320x240_60
+// scanlines are numbered 0-239, but rows of the movie are still handled in pairs
+#define MOVIE_ROW_SHIFT 1
+#else
 #define vga_mode vga_mode_320x120_60
+#define MOVIE_ROW_SHIFT 0
+#endif
 
 struct text_element {
     const char *text;
@@ -92,6 +194,9 @@ struct text_element instructions[] = {
         { "'r' - reverse play direction!", INSTR_COLOR2 },
         { "'n' / 'p' - next / previous movie", INSTR_COLOR1 },
         { "'[' / ']' - down / up volume", INSTR_COLOR2 },
+        { "'l' - toggle playlist mode", INSTR_COLOR1 },
+        { "'f' - cycle picture filters", INSTR_COLOR2 },
+        { "'m' - print memory use", INSTR_COLOR1 },
 };
 #define DISPLAY_NAME_AFTER_FRAME_COUNT 1
 #elif defined(USE_VGABOARD_BUTTONS)
@@ -112,8 +217,8 @@ uint32_t display_base_frame;
 uint current_movie;
 uint registered_current_movie; // as seen by decode
 
-static struct font *font12;
-static struct font *font18;
+static const struct font *font12;
+static const struct font *font18;
 
 static semaphore_t video_setup_complete;
 static struct mutex frame_logic_mutex;
@@ -126,9 +231,23 @@ static int32_t next_frame_sector_override = -1;
 static int32_t audio_sector_pairs_to_post_process;
 static int32_t volume = 0x100;
 static uint32_t total_audio_sectors;
+// volume changes are ramped over the length of the next frame's audio
+static struct {
+    int32_t gain; // at the start of audio_read_buffer
+    int32_t step; // per stereo frame
+} audio_ramp;
+static int32_t audio_gain = AUDIO_GAIN_UNITY; // at the end of the last ramp
 static bool show_menu = false;
 static int text_roller = 0;
 
+// in playlist mode we move on to the next movie at the end of each one (rather than looping), and read the next
+// movie's first frame header ahead of time during the last few seconds, so the switch doesn't stall the decoder
+#ifndef POPCORN_PLAYLIST_MODE
+#define POPCORN_PLAYLIST_MODE 0
+#endif
+#define PLAYLIST_PREFETCH_FRAMES 90
+static bool playlist_mode = POPCORN_PLAYLIST_MODE;
+
 static void init_core(int core);
 static void handle_input();
 
@@ -170,79 +289,8 @@ void vga_board_init_buttons() {
 }
 #endif
 
-struct font {
-    uint width_words;
-    uint height;
-    uint glyph_words; // == width_words * height;
-    uint32_t *pixels;
-};
-
-struct font *build_font(const lv_font_t *font, uint width_words) {
-    struct font *f = (struct font *) calloc(1, sizeof(struct font));
-    f->width_words = width_words;
-    f->height = font->line_height;
-
-    uint16_t colors[16];
-    for (int i = 0; i < count_of(colors); i++) {
-#ifdef PLATYPUS_565
-        colors[i] = 0x41 * i + 0x800 * (i / 2);
-#else
-        colors[i] = 0x21 * i +  0x400 * (i/2);
-#endif
-    }
-    uint font_size_words = font->line_height * width_words;
-    f->pixels = (uint32_t *) calloc(4, font->dsc->cmaps->range_length * font_size_words);
-    f->glyph_words = f->width_words * f->height;
-    uint32_t *p = f->pixels;
-
-    for (int c = 0; c < font->dsc->cmaps->range_length; c++) {
-        // inefficient but simple
-        assert(p == f->pixels + c * f->glyph_words);
-        const lv_font_fmt_txt_glyph_dsc_t *g = &font->dsc->glyph_dsc[c + 1];
-        const uint8_t *b = font->dsc->glyph_bitmap + g->bitmap_index;
-        int bi = 0;
-        for (int y = 0; y < f->height; y++) {
-            int ey = y - f->height + font->base_line + g->ofs_y + g->box_h;
-            for (int x = 0; x < f->width_words * 2; x++) {
-                uint32_t pixel;
-                int ex = x - g->ofs_x;
-                if (ex >= 0 && ex < g->box_w && ey >= 0 && ey < g->box_h) {
-                    pixel = bi & 1 ? colors[b[bi >> 1] & 0xf] : colors[b[bi >> 1] >> 4];
-                    bi++;
-                } else {
-                    pixel = 0;
-                }
-                if (!(x & 1)) {
-                    *p = pixel;
-                } else {
-                    *p++ |= pixel << 16;
-                }
-            }
-            if (ey >= 0 && ey < g->box_h) {
-                for (int x = f->width_words * 2 - g->ofs_x; x < g->box_w; x++) {
-                    bi++;
-                }
-            }
-        }
-    }
-    return f;
-}
-
-static void __attribute__((noinline)) __time_critical_func(reverse_sector_pair)(uint32_t *s1, uint32_t *s2) {
-    for (int i = 0; i < 128; i++) {
-        uint32_t tmp = s1[i];
-        s1[i] = s2[127 - i];
-        s2[127 - i] = tmp;
-    }
-}
-
-#define IMAGE_DATA_K 126
 #define AUDIO_BUFFER_K 6
 
-#define IMAGE_DATA_WORDS (IMAGE_DATA_K * 256)
-// todo see where we write off the end of this (hence need for + 128)
-uint32_t image_data[
-        128 + IMAGE_DATA_K * 1024 / 4] = {1}; // force into data not BSS
 #define NUM_AUDIO_BUFFERS 2
 uint32_t audio_buffer[AUDIO_BUFFER_K * NUM_AUDIO_BUFFERS * 1024 / 4] = {1};
 uint32_t *const audio_buffer_start[NUM_AUDIO_BUFFERS] = {
@@ -271,14 +319,206 @@ extern const uint8_t atlantis_glyph_widths[];
 #define OVERLAY_END 110
 #define OVERLAY_START (OVERLAY_END - OVERLAY_HEIGHT)
 static uint32_t overlay[OVERLAY_WIDTH * OVERLAY_HEIGHT * 2];
+#if POPCORN_OVERLAY_SPANS
+// the range of words [from, to) in each overlay row which may be non zero; from > to for an empty row. note
+// the extra row, as each scanline pair uses overlay rows n and n + 1
+static struct {
+    uint8_t from, to;
+} overlay_row_span[OVERLAY_HEIGHT + 1];
+#endif
+#if POPCORN_OVERLAY_STATS
+static struct {
+    uint32_t cycles;
+    uint32_t scanlines;
+} overlay_stats[2];
+#endif
 
 struct audio_buffer *audio_buffers[NUM_AUDIO_BUFFERS];
 struct audio_buffer_pool *audio_buffer_pool;
 
+// where the current frame's audio sectors are being read to
+static uint32_t *audio_read_buffer;
+
+#if POPCORN_TIME_STRETCH
+// when time stretching, audio is read here (after some history), and the output is built in the regular audio buffers
+static uint32_t stretch_input[TIME_STRETCH_INPUT_BASE + AUDIO_BUFFER_K * 256];
+static struct time_stretch stretch;
+static struct {
+    uint32_t ratio; // 0 when we aren't stretching
+    bool filling; // we are building output in the current load_thread_buffer_index
+    bool pending; // we ran out of output space with input left over
+    uint out_count;
+    uint32_t last_frame_number;
+#if POPCORN_TIME_STRETCH_STATS
+    uint32_t cycles;
+    uint32_t samples;
+    uint buffers;
+#endif
+} stretch_state;
+#endif
+
+// ----------------------------------------------------------------
+// MEMORY PLAN
+//
+// image_data (compressed video, read ahead of display) gets whatever SRAM is left after the other big buffers.
+// POPCORN_OTHER_RAM_K covers everything not planned here (code and tables in RAM, SDK state, scanline buffers, stacks
+// and the rest of the heap). IMAGE_DATA_K can also be set directly, in which case it is just checked against the
+// budget.
+//
+// todo the POPCORN_OTHER_RAM_K defaults are NOT measured: they were worked back from the image_data size the player
+//  used to have, and still need taking from `arm-none-eabi-size` (or the .map) of the RP2040 and RP2350 builds. Until
+//  then, check_memory_plan() panics at boot if the RAM actually in use outside the plan is over the figure.
+
+#ifndef POPCORN_SRAM_K
+#if PICO_RP2350
+#define POPCORN_SRAM_K 520
+#else
+#define POPCORN_SRAM_K 264
+#endif
+#endif
+
+#ifndef POPCORN_OTHER_RAM_K
+#if PICO_RP2350
+// more than RP2040 as the platypus tables are in main RAM (PLATYPUS_TABLES_MAIN_RAM); unmeasured, see above
+#define POPCORN_OTHER_RAM_K 112
+#else
+// unmeasured, see above
+#define POPCORN_OTHER_RAM_K 98
+#endif
+#endif
+
+// todo see where we write off the end of image_data (hence need for slack)
+#define IMAGE_DATA_SLACK_WORDS 128
+#define AUDIO_BUFFER_BYTES (AUDIO_BUFFER_K * NUM_AUDIO_BUFFERS * 1024)
+#if POPCORN_TIME_STRETCH
+#define STRETCH_INPUT_BYTES (count_of(stretch_input) * 4)
+#else
+#define STRETCH_INPUT_BYTES 0
+#endif
+#define OVERLAY_BYTES (count_of(overlay) * 4)
+// scatter list, frame header sectors (current and prefetch), CRC waste and the image_data slack
+#define SD_BUFFER_BYTES (((PICO_SD_MAX_BLOCK_COUNT + 2) * 4 + 3 * 128 + IMAGE_DATA_SLACK_WORDS) * 4)
+#if POPCORN_PREBUILT_FONTS
+#define FONT_BYTES 0
+#else
+// the 13 menu glyphs of lcd12 (9 rows of 4 words) and lcd18 (13 rows of 5 words), rendered onto the heap by build_font
+#define FONT_BYTES ((13 * 9 * 4 + 13 * 13 * 5) * 4 + 2 * sizeof(struct font))
+#endif
+#define PLANNED_BYTES (AUDIO_BUFFER_BYTES + STRETCH_INPUT_BYTES + OVERLAY_BYTES + SD_BUFFER_BYTES + FONT_BYTES)
+#define PLANNED_K ((PLANNED_BYTES + 1023) / 1024)
+
+// row offsets are 16 bit word offsets into image_data
+#define IMAGE_DATA_MAX_K 255
+// room for a couple of big frames
+#define IMAGE_DATA_MIN_K 96
+
+#ifndef IMAGE_DATA_K
+#define IMAGE_DATA_K MIN(IMAGE_DATA_MAX_K, POPCORN_SRAM_K - POPCORN_OTHER_RAM_K - PLANNED_K)
+#endif
+static_assert(IMAGE_DATA_K >= IMAGE_DATA_MIN_K, "not enough SRAM left for image_data");
+static_assert(IMAGE_DATA_K <= IMAGE_DATA_MAX_K, "image_data is too big for 16 bit row offsets");
+static_assert(IMAGE_DATA_K + PLANNED_K <= POPCORN_SRAM_K - POPCORN_OTHER_RAM_K, "memory plan is over budget");
+
+#define IMAGE_DATA_WORDS (IMAGE_DATA_K * 256)
+uint32_t image_data[IMAGE_DATA_SLACK_WORDS + IMAGE_DATA_WORDS] = {1}; // force into data not BSS
+
+// what the buffers have actually needed, to see what could be given over to image_data read ahead
+static struct {
+    uint32_t image_words;
+    uint16_t rows;
+    uint16_t audio_words;
+    uint16_t stretch_words;
+} high_water;
+
 #define MOVIE_ROWS 120
-// +1 so we can tell full from empty
-#define ROW_OFFSET_CIRCLE_SIZE (MOVIE_ROWS * 2 + 1 + 10)
+// enough rows for the frames that fit in image_data (a big frame is about 60K); +1 so we can tell full from empty
+#define IMAGE_DATA_FRAMES MAX(2, IMAGE_DATA_K / 60)
+#define ROW_OFFSET_CIRCLE_SIZE (MOVIE_ROWS * IMAGE_DATA_FRAMES + 1 + 10)
+
+#ifdef PLATYPUS_565
+#define PIXELS_ARE_RGB565 true
+#else
+#define PIXELS_ARE_RGB565 false
+#endif
+
+#if POPCORN_SCANLINE_FILTERS
+
+// what to do for each movie row (pair of scanlines)
+static uint8_t scanline_filter_ops[MOVIE_ROWS];
+static struct scanline_filter_lut scanline_filter_lut;
+
+static const struct {
+    const char *name;
+    uint8_t ops;
+    uint8_t letterbox_rows; // visible rows, or 0 for all
+    float brightness, gamma; // for SCANLINE_FILTER_LUT
+} scanline_filter_presets[] = {
+        {"none"},
+        {"scanlines", SCANLINE_FILTER_SCANLINES},
+        {"letterbox 2.35:1", SCANLINE_FILTER_NONE, 68},
+        {"letterbox 2.35:1 + scanlines", SCANLINE_FILTER_SCANLINES, 68},
+        {"brighter", SCANLINE_FILTER_LUT, 0, 1.1f, 0.8f},
+        {"dim", SCANLINE_FILTER_DIM},
+};
+static uint scanline_filter_preset;
+
+static bool scanline_filter_preset_allowed(uint preset) {
+    return !(scanline_filter_presets[preset].ops & SCANLINE_FILTER_LUT) ||
+           clock_get_hz(clk_sys) >= POPCORN_LUT_FILTER_MIN_MHZ * 1000000u;
+}
+
+static void set_scanline_filter_preset(uint preset) {
+    while (!scanline_filter_preset_allowed(preset)) {
+        printf("filter: %s needs a system clock of at least %dMHz\n", scanline_filter_presets[preset].name,
+               POPCORN_LUT_FILTER_MIN_MHZ);
+        preset = (preset + 1) % count_of(scanline_filter_presets);
+    }
+    scanline_filter_preset = preset;
+    if (scanline_filter_presets[preset].ops & SCANLINE_FILTER_LUT) {
+        // note this is only done on change, as it isn't cheap
+        scanline_filter_build_lut(&scanline_filter_lut, PIXELS_ARE_RGB565, scanline_filter_presets[preset].brightness,
+                                  scanline_filter_presets[preset].gamma);
+    }
+    uint visible = scanline_filter_presets[preset].letterbox_rows;
+    uint from = visible ? (MOVIE_ROWS - visible) / 2 : 0;
+    uint to = visible ? from + visible : MOVIE_ROWS;
+    for (uint row = 0; row < MOVIE_ROWS; row++) {
+        scanline_filter_ops[row] = (row < from || row >= to) ? SCANLINE_FILTER_BLANK :
+                                   scanline_filter_presets[preset].ops;
+    }
+    printf("filter: %s\n", scanline_filter_presets[preset].name);
+}
+
+void __attribute__((optimize("O2"))) __no_inline_not_in_flash_func(filter_rows)(uint8_t ops, uint32_t *row0,
+                                                                               uint32_t *row1) {
+    scanline_filter_apply(ops, row0, row1, 160, &scanline_filter_lut, PIXELS_ARE_RGB565);
+}
+#endif
 static uint16_t row_buffer_offsets[ROW_OFFSET_CIRCLE_SIZE];
+// for 2x1 coded rows, the offset of the second row from the first (0 for 2x2)
+static uint8_t row_split_words[ROW_OFFSET_CIRCLE_SIZE];
+static int16_t row_2x1_deltas[PLATYPUS_2X1_DELTA_COUNT];
+#if POPCORN_DECODE_STATS
+static uint32_t row_frame_number[ROW_OFFSET_CIRCLE_SIZE];
+// one sampled row per core; part is 0 for a pair of rows decoded together, or 1/2 for the first/second row alone
+static volatile struct {
+    uint32_t frame_number;
+    uint16_t row;
+    uint8_t part;
+    bool valid;
+    uint32_t cycles;
+    uint32_t filter_cycles; // 0 if no filter was applied
+} decode_sample[2];
+#endif
+
+static inline void set_row_buffer_offset(const struct frame_header *head, uint row_index, uint frame_row,
+                                         uint16_t offset) {
+    row_buffer_offsets[row_index] = offset;
+    row_split_words[row_index] = head->format == PL2_FORMAT_2X1 ? pl2_row_splits(head)[frame_row] : 0;
+#if POPCORN_DECODE_STATS
+    row_frame_number[row_index] = head->frame_number;
+#endif
+}
 
 static uint row_wrap_add(uint a, uint b) {
     assert(a < ROW_OFFSET_CIRCLE_SIZE && b <= MOVIE_ROWS);
@@ -295,7 +535,7 @@ static uint row_wrap_sub(uint a, uint b) {
 }
 
 #ifdef ENABLE_STRICT_ASSERTIONS
-uint16_t ram_buffer_owning_row[RAM_BUFFER_K*1024 / 4] = {1};
+uint16_t ram_buffer_owning_row[IMAGE_DATA_WORDS] = {1};
 #endif
 
 static inline void set_owning_row(__unused uint from, __unused uint count, __unused uint16_t row) {
@@ -321,31 +561,65 @@ static uint32_t scatter[(PICO_SD_MAX_BLOCK_COUNT + 2) * 4];
 
 static uint32_t frame_header_sector[128];
 
-struct frame_header {
-    uint32_t mark0;
-    uint32_t mark1;
-    uint32_t magic;
-    uint8_t major, minior, debug, spare;
-    uint32_t sector_number; // relative to start of stream
-    uint32_t frame_number;
-    uint8_t hh, mm, ss, ff; // good old CD days (bcd)
-    uint32_t header_words;
-    uint16_t width;
-    uint16_t height;
-    uint32_t image_words;
-    uint32_t audio_words; // just to confirm really
-    uint32_t audio_freq;
-    uint8_t audio_channels; // always assume 16 bit
-    uint8_t pad[3];
-    uint32_t unused[4]; // little space for expansion
-    uint32_t total_sectors;
-    uint32_t last_sector;
-    // 1, 2, 4, 8 frame increments
-    uint32_t forward_frame_sector[4];
-    uint32_t backward_frame_sectors[4];
-    // h/2 + 1 row_offsets, last one should == image_words
-    uint16_t row_offsets[];
-} __attribute__((packed));
+extern char __end__; // end of .data/.bss in main SRAM, where the heap starts
+
+// the RAM actually in use other than what is in the plan: static data and the heap, plus the 8K of scratch X/Y
+// (the stacks) which POPCORN_SRAM_K includes
+static uint measured_other_ram_k() {
+    uint used = (uint) (&__end__ - (char *) SRAM_BASE) + (uint) mallinfo().arena + 8 * 1024;
+    uint planned = sizeof(image_data) + PLANNED_BYTES - IMAGE_DATA_SLACK_WORDS * 4; // the slack is in SD_BUFFER_BYTES
+    return (used - planned + 1023) / 1024;
+}
+
+static void print_memory_plan() {
+    printf("memory plan: %dK SRAM - %dK other: image_data %dK, audio %d, stretch %d, overlay %d, sd %d, fonts %d "
+           "bytes; %dK unplanned\n", POPCORN_SRAM_K, POPCORN_OTHER_RAM_K, (int) IMAGE_DATA_K, (int) AUDIO_BUFFER_BYTES,
+           (int) STRETCH_INPUT_BYTES, (int) OVERLAY_BYTES, (int) SD_BUFFER_BYTES, (int) FONT_BYTES,
+           (int) (POPCORN_SRAM_K - POPCORN_OTHER_RAM_K - PLANNED_K - IMAGE_DATA_K));
+    printf("memory plan: %dK other measured\n", measured_other_ram_k());
+}
+
+// called at boot once the heap allocations are done, so that a POPCORN_OTHER_RAM_K that is too small can't go unnoticed
+static void check_memory_plan() {
+    uint other_k = measured_other_ram_k();
+    if (other_k > POPCORN_OTHER_RAM_K) {
+        panic("POPCORN_OTHER_RAM_K is %dK but %dK is in use outside the memory plan", POPCORN_OTHER_RAM_K, other_k);
+    }
+}
+
+// how the image data reads are broken up, to see how much the wrap and waiting for space cost
+static struct {
+    uint32_t reads; // SD commands
+    uint32_t sectors;
+    uint32_t split_sectors; // sectors needing a second scatter entry at the wrap
+    uint32_t short_reads; // reads cut short waiting for image_data or row space
+} video_read_stats;
+
+static void print_video_read_stats() {
+    uint32_t reads = MAX(video_read_stats.reads, 1);
+    printf("video reads: %d of %d.%02d sectors on average, %d split sectors, %d cut short\n",
+           (int) video_read_stats.reads, (int) (video_read_stats.sectors / reads),
+           (int) ((video_read_stats.sectors % reads) * 100 / reads), (int) video_read_stats.split_sectors,
+           (int) video_read_stats.short_reads);
+}
+
+static void print_high_water() {
+    printf("high water: image_data %d/%d words, rows %d/%d, audio %d/%d words",
+           (int) high_water.image_words, (int) IMAGE_DATA_WORDS, high_water.rows, (int) ROW_OFFSET_CIRCLE_SIZE - 1,
+           high_water.audio_words, AUDIO_BUFFER_K * 256);
+#if POPCORN_TIME_STRETCH
+    printf(", stretch %d/%d words", high_water.stretch_words, (int) count_of(stretch_input));
+#endif
+    printf("\n");
+}
+
+static struct {
+    enum {
+        PF_NONE, PF_WANTED, PF_READING, PF_VALID
+    } state;
+    uint movie;
+    uint32_t header_sector[128];
+} prefetch;
 
 static struct decoder_state_state {
     enum {
@@ -359,6 +633,10 @@ static struct decoder_state_state {
         AWAIT_AUDIO_BUFFER,
         NEED_AUDIO_SECTORS,
         READING_AUDIO_SECTORS,
+        READING_PREFETCH_HEADER_SECTOR,
+#if POPCORN_TIME_STRETCH
+        STRETCHING_AUDIO,
+#endif
         AUDIO_BUFFER_READY,
         POST_PROCESSING_AUDIO_SECTORS,
         ERROR,
@@ -390,6 +668,9 @@ static struct decoder_state_state {
         volatile enum {
             BS_EMPTY, BS_FILLING, BS_QUEUED
         } buffer_state[2];
+#if POPCORN_AUDIO_DMA_REVERSE
+        volatile bool dma_reverse[2]; // the buffer should be played from the end backwards
+#endif
         uint load_thread_buffer_index;
         uint32_t sector_base;
     } audio;
@@ -423,15 +704,38 @@ void popcorn_consumer_pool_give_buffer(struct audio_connection *connection, stru
     __builtin_unreachable();
 }
 
+#if POPCORN_AUDIO_DMA_REVERSE
+// called (from the DMA IRQ) when the I2S DMA is idle and about to start on the next buffer, so is a safe time to
+// change its read direction
+struct audio_buffer *popcorn_consumer_pool_take_buffer(struct audio_connection *connection, bool block) {
+    struct audio_buffer *buffer = consumer_pool_take_buffer_default(connection, block);
+    if (buffer) {
+        for (int i = 0; i < NUM_AUDIO_BUFFERS; i++) {
+            if (buffer == audio_buffers[i]) {
+                // note the I2S code re-reads the channel config before each transfer, so this is preserved
+                if (ds.audio.dma_reverse[i]) {
+                    hw_set_bits(&dma_hw->ch[AUDIO_DMA_CHANNEL].al1_ctrl, DMA_CH0_CTRL_TRIG_INCR_READ_REV_BITS);
+                } else {
+                    hw_clear_bits(&dma_hw->ch[AUDIO_DMA_CHANNEL].al1_ctrl, DMA_CH0_CTRL_TRIG_INCR_READ_REV_BITS);
+                }
+            }
+        }
+    }
+    return buffer;
+}
+#endif
+
 static struct audio_connection popcorn_passthru_connection = {
+#if POPCORN_AUDIO_DMA_REVERSE
+        .consumer_pool_take = popcorn_consumer_pool_take_buffer,
+#else
         .consumer_pool_take = consumer_pool_take_buffer_default,
+#endif
         .consumer_pool_give = popcorn_consumer_pool_give_buffer,
         .producer_pool_take = producer_pool_take_buffer_default,
         .producer_pool_give = popcorn_producer_pool_give_buffer,
 };
 
-#define PLATYPUS_MAGIC (('T'<<24)|('A'<<16)|('L'<<8)|'P')
-
 static inline bool row_index_in_range(uint index, uint from, uint to) {
     if (from <= to) {
         return index >= from && index < to;
@@ -448,28 +752,26 @@ static uint peek_upcoming_row(struct frame_header *head, int ahead) {
            head->row_offsets[ds.video_read.frame_row_count + ahead];
 }
 
-struct gpt_entry {
-    uint64_t ptype1, ptype2;
-    uint64_t guid1, guid2;
-    uint64_t first_lba;
-    uint64_t last_lba;
-    uint64_t attributes;
-    uint16_t u_name[36];
-};
-
 #pragma GCC push_options
 #pragma GCC optimize("O3")
 
-static void __attribute__((noinline)) update_audio_sector_volume(uint32_t *_samples) {
-    int16_t *samples = (int16_t *) _samples;
-    for (int i = 0; i < 256; i++) {
-        samples[i] = (samples[i] * volume) >> 8;
-    }
+// frame is the offset of the sector within audio_read_buffer
+static void __attribute__((noinline)) __time_critical_func(update_audio_sector_volume)(uint frame) {
+    audio_gain_apply(audio_read_buffer + frame, 128, audio_ramp.gain + audio_ramp.step * (int32_t) frame,
+                     audio_ramp.step);
+}
+
+// reverse a pair of sectors (and change the volume) in one pass
+static void __attribute__((noinline)) __time_critical_func(reverse_sector_pair)(uint frame1, uint frame2) {
+    audio_gain_reverse(audio_read_buffer + frame1, audio_read_buffer + frame2, 128,
+                       audio_ramp.gain + audio_ramp.step * (int32_t) frame1,
+                       audio_ramp.gain + audio_ramp.step * (int32_t) frame2, audio_ramp.step);
 }
 
 #pragma GCC pop_options
 
-static void __time_critical_func(handle_prep_video_sectors)(struct frame_header *head) {
+static void __time_critical_func(prep_video_sectors)(struct frame_header *head, uint32_t **scatter_end, int *sectors,
+                                                     bool *frame_done) {
     bool done = false;
     // we are making a decision about how many sectors we can read (we read up to MAX_BLOCK_COUNT - 1) in case one is split
     uint32_t *p = scatter;
@@ -530,7 +832,7 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
                 words_until_wrap = linear_words = buffer_offset_limit;
                 may_wrap = false;
             }
-            row_buffer_offsets[row_index] = ds.video_read.write_buffer_offset;
+            set_row_buffer_offset(head, row_index, ds.video_read.frame_row_count, ds.video_read.write_buffer_offset);
             ds.video_read.frame_row_count++;
             ds.video_read.row_index = row_index;
         }
@@ -615,7 +917,8 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
                     if (!rollback) {
                         popcorn_debug("%d from new row ri = %d(of %d)", to_consume, row_index,
                                       (uint) ds.video_read.remaining_row_words);
-                        row_buffer_offsets[row_index] = ds.video_read.write_buffer_offset;
+                        set_row_buffer_offset(head, row_index, ds.video_read.frame_row_count + rows_ahead,
+                                              ds.video_read.write_buffer_offset);
                         ds.video_read.remaining_row_words -= to_consume;
                         ds.video_read.write_buffer_offset += to_consume;
                         consumed += to_consume;
@@ -642,6 +945,7 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
             popcorn_debug(" and %d at 0000", (uint) part2_size);
             *p++ = native_safe_hw_ptr(image_data); // part2 always at start of buffer
             *p++ = part2_size;
+            video_read_stats.split_sectors++;
         }
         popcorn_debug("\n");
         // CRC
@@ -649,12 +953,35 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
         *p++ = 2;
         sector_count++;
     }
+    *scatter_end = p;
+    *sectors = sector_count;
+    *frame_done = done;
+}
+
+static void __time_critical_func(handle_prep_video_sectors)(struct frame_header *head) {
+    uint32_t *p;
+    int sector_count;
+    bool done;
+    prep_video_sectors(head, &p, &sector_count, &done);
     if (sector_count) {
+        video_read_stats.reads++;
+        video_read_stats.sectors += sector_count;
+        if (!done && sector_count < PICO_SD_MAX_BLOCK_COUNT && p < scatter + count_of(scatter) - 6) {
+            video_read_stats.short_reads++;
+        }
         *p++ = 0;
         *p++ = 0;
         assert(p <= scatter + count_of(scatter));
         ds.current_sd_read.sector_base = ds.video_read.sector_base;
         ds.current_sd_read.sector_count = sector_count;
+        if (ds.rows.valid_from_row != ds.rows.valid_to_row) {
+            uint from = row_buffer_offsets[ds.rows.valid_from_row];
+            uint to = ds.video_read.write_buffer_offset;
+            high_water.image_words = MAX(high_water.image_words, to >= from ? to - from : to + IMAGE_DATA_WORDS - from);
+            uint rows = row_wrap_sub(row_wrap_add(ds.video_read.frame_base_row, ds.video_read.frame_row_count),
+                                     ds.rows.valid_from_row);
+            high_water.rows = MAX(high_water.rows, rows);
+        }
         popcorn_debug("starting read %d secs @ %04x?(%04x) -> %04x(%04x)\n", sector_count,
                       row_buffer_offsets[row_wrap_add(ds.video_read.frame_base_row,
                                                       ds.video_read_rollback.frame_row_count)],
@@ -678,14 +1005,33 @@ static void __time_critical_func(handle_prep_video_sectors)(struct frame_header
 static void __time_critical_func(handle_audio_buffer_ready)(const struct frame_header *head) {
     DEBUG_PINS_CLR(audio_buffering, 4);
     ds.loaded_audio_this_frame = true;
+#if POPCORN_TIME_STRETCH
+    if (stretch_state.ratio) {
+        bool continuous = head->frame_number == (playback_forwards ? stretch_state.last_frame_number + 1 :
+                                                 stretch_state.last_frame_number - 1);
+        stretch_state.last_frame_number = head->frame_number;
+        time_stretch_add_input(&stretch, head->audio_words, !continuous);
+        ds.state = STRETCHING_AUDIO;
+        return;
+    }
+#endif
     ds.audio.buffer_state[ds.audio.load_thread_buffer_index] = BS_QUEUED;
     if (!ds.paused && (playback_speed > -3 && playback_speed < 3)) {
+#if POPCORN_AUDIO_DMA_REVERSE
+        ds.audio.dma_reverse[ds.audio.load_thread_buffer_index] = !playback_forwards;
+#endif
         if (playback_forwards) {
             audio_buffers[ds.audio.load_thread_buffer_index]->buffer->bytes = (uint8_t *) audio_buffer_start[ds.audio.load_thread_buffer_index];
         } else {
+#if POPCORN_AUDIO_DMA_REVERSE
+            // the DMA starts at the last frame and reads backwards
+            audio_buffers[ds.audio.load_thread_buffer_index]->buffer->bytes = (uint8_t *) (
+                    audio_buffer_start[ds.audio.load_thread_buffer_index] + head->audio_words - 1);
+#else
             // need to offset the audio because it is now right aligned
             audio_buffers[ds.audio.load_thread_buffer_index]->buffer->bytes = (uint8_t *) (
                     audio_buffer_start[ds.audio.load_thread_buffer_index] + (127u & -head->audio_words));
+#endif
         }
         DEBUG_PINS_SET(audio_buffering, ds.audio.load_thread_buffer_index + 1);
         give_audio_buffer(audio_buffer_pool, audio_buffers[ds.audio.load_thread_buffer_index]);
@@ -717,6 +1063,37 @@ static void __time_critical_func(handle_need_frame_header_sector)(struct frame_h
     ds.state = READING_FRAME_HEADER_SECTOR;
 }
 
+static inline uint next_movie_index(uint movie) {
+    return movie + 1 == movie_count ? 0 : movie + 1;
+}
+
+static void __time_critical_func(check_playlist_prefetch)(const struct frame_header *head) {
+    if (prefetch.state == PF_VALID && prefetch.movie != next_movie_index(registered_current_movie)) {
+        // user has moved on to a different movie since
+        prefetch.state = PF_NONE;
+    }
+    if (!playlist_mode || movie_count < 2 || !playback_forwards || prefetch.state != PF_NONE) return;
+    uint frame_sectors = pl2_frame_sectors(head);
+    if (head->last_sector < head->sector_number + PLAYLIST_PREFETCH_FRAMES * frame_sectors) {
+        prefetch.movie = next_movie_index(registered_current_movie);
+        prefetch.state = PF_WANTED;
+    }
+}
+
+static void __time_critical_func(accept_frame_header)(const struct frame_header *head) {
+    movies[registered_current_movie].current_sector = ds.current_sd_read.sector_base;
+    ds.display_time_code = (head->hh << 24u) | (head->mm << 16u) | (head->ss << 8u) | (head->ff);
+    ds.current_sd_read.sector_base++;
+    // skip audio sectors
+    ds.audio.sector_base = ds.current_sd_read.sector_base;
+    ds.current_sd_read.sector_base += (head->audio_words + 127) / 128;
+    ds.video_read.sector_base = ds.current_sd_read.sector_base;
+    ds.video_read.frame_base_row = ds.rows.valid_to_row;
+    ds.video_read.frame_row_count = 0;
+    ds.state = NEED_VIDEO_SECTORS;
+    check_playlist_prefetch(head);
+}
+
 static void __time_critical_func(handle_reading_frame_header_sector)() {
     if (sd_scatter_read_complete(NULL)) {
         struct frame_header *head = (struct frame_header *) frame_header_sector;
@@ -731,93 +1108,177 @@ static void __time_critical_func(handle_reading_frame_header_sector)() {
                 ds.current_sd_read.sector_base++;
                 ds.state = NEED_FRAME_HEADER_SECTOR;
             } else {
-                movies[registered_current_movie].current_sector = ds.current_sd_read.sector_base;
-                ds.display_time_code = (head->hh << 24u) | (head->mm << 16u) | (head->ss << 8u) | (head->ff);
-                ds.current_sd_read.sector_base++;
-                // skip audio sectors
-                ds.audio.sector_base = ds.current_sd_read.sector_base;
-                ds.current_sd_read.sector_base += (head->audio_words + 127) / 128;
-                ds.video_read.sector_base = ds.current_sd_read.sector_base;
-                ds.video_read.frame_base_row = ds.rows.valid_to_row;
-                ds.video_read.frame_row_count = 0;
-                ds.state = NEED_VIDEO_SECTORS;
+                accept_frame_header(head);
             }
         }
     }
 }
 
-static void handle_init(const struct frame_header *head) {
-    movie_count = 1;
-    movies = static_movies;
-    if (sd_init_4pins() < 0) {
-        ds.state = ERROR;
+#define MOVIE_FILE_EXTENSION ".pl2"
+
+static bool is_movie_start(uint32_t sector) {
+    const struct frame_header *head = (const struct frame_header *) frame_header_sector;
+    if (sd_readblocks_sync(frame_header_sector, sector, 1) < 0) return false;
+    return pl2_is_frame_header(head);
+}
+
+static void add_movie(const char *name, uint name_length, uint32_t start_sector) {
+    if (movies == static_movies) movies = NULL;
+    movies = (struct movie *) realloc(movies, (movie_count + 1) * sizeof(struct movie));
+    if (!movies) {
+        panic("Out of memory");
+    }
+    struct movie *m = &movies[movie_count++];
+    memset(m, 0, sizeof(struct movie));
+    const uint MAX_TEXT = 20; // random ... must be less than 36
+    name_length = MIN(name_length, MAX_TEXT);
+    char *text = (char *) malloc(name_length + 1);
+    memcpy(text, name, name_length);
+    text[name_length] = 0;
+    m->text.text = text;
+    m->text.color = NAME_COLOR;
+    m->start_sector = start_sector;
+    printf("'%s' at %08x\n", m->text.text, (uint) m->start_sector);
+}
+
+static void add_fat_movie(const struct fat_file *file, __unused void *context) {
+    if (!fat_file_is_contiguous(file)) {
+        // we only want to do big linear reads at playback time, so no chasing clusters
+        if (file->extent_count > FAT_MAX_EXTENTS) {
+            printf("'%s' is too fragmented to play; copy it to a freshly formatted card\n", file->name);
+        } else if (file->extent_count) {
+            printf("'%s' is fragmented into %d extents; copy it to a freshly formatted card\n", file->name,
+                   file->extent_count);
+        }
+        return;
+    }
+    if (!is_movie_start(file->extents[0].sector)) {
+        printf("'%s' is not a movie\n", file->name);
+        return;
+    }
+    add_movie(file->name, strlen(file->name) - strlen(MOVIE_FILE_EXTENSION), file->extents[0].sector);
+}
+
+static void add_gpt_movies(const struct gpt_partition *partition, void *context) {
+    if (is_movie_start(partition->first_sector)) {
+        add_movie(partition->name, strlen(partition->name), partition->first_sector);
     } else {
-        sd_readblocks_sync(image_data, 1, 1);
-        const struct gpt_header {
-            uint64_t signature;
-            uint32_t revision;
-            uint32_t size;
-            uint32_t crc;
-            uint32_t _pad;
-            uint64_t lba;
-            uint64_t backup_lba;
-            uint64_t first_usable_lba;
-            uint64_t last_usabble_lba;
-            uint64_t guid1, guid2;
-            uint64_t table_lba;
-            uint32_t table_count;
-            uint32_t table_entry_size;
-            uint32_t table_crc;
-        } __packed gpt_header = *(const struct gpt_header *) image_data;
-        // todo crc
-        if (gpt_header.signature == 0x5452415020494645ULL && gpt_header.size == sizeof(struct gpt_header)) {
-            printf("Found GPT\n");
-
-            int sectors = (gpt_header.table_count * gpt_header.table_entry_size + 511) / 512;
-            int read_sectors = MAX(sectors, 32);
-            printf("  reading %d/%d sectors starting at %d\n", read_sectors, sectors,
-                   (int) gpt_header.table_lba);
-            sd_readblocks_sync(image_data, gpt_header.table_lba, read_sectors);
-            uint8_t *buffer = (uint8_t *) image_data;
-            movie_count = 0;
-            for (uint i = 0; i < gpt_header.table_count; i++) {
-                struct gpt_entry *gpt_entry = (struct gpt_entry *) (buffer + i * gpt_header.table_entry_size);
-                if (gpt_entry->ptype1 || gpt_entry->ptype2) {
-                    sd_readblocks_sync(frame_header_sector, gpt_entry->first_lba, 1);
-                    if (head->mark0 == 0xffffffff && head->mark1 == 0xffffffff ||
-                        head->magic == PLATYPUS_MAGIC) {
-                        movie_count++;
-                    } else {
-                        gpt_entry->ptype1 = gpt_entry->ptype2 = 0;
-                    }
-                }
-            }
-            if (!movie_count) {
-                panic("No movies found");
-            }
-            movies = (struct movie *) calloc(movie_count, sizeof(struct movie));
-            for (uint i = 0, j = 0; i < gpt_header.table_count; i++) {
-                struct gpt_entry *gpt_entry = (struct gpt_entry *) (buffer + i * gpt_header.table_entry_size);
-                if (gpt_entry->ptype1 || gpt_entry->ptype2) {
-                    movies[j].start_sector = gpt_entry->first_lba;
-                    movies[j].text.color = NAME_COLOR;
-                    const int MAX_TEXT = 20; // random ... must be less than 36
-                    char *ascii = (char *) gpt_entry->u_name;
-                    for (int k = 0; k < MAX_TEXT; k++) {
-                        char c = gpt_entry->u_name[k];
-                        ascii[k] = c; // overwrite the string at half speed
-                        if (!c) break;
-                    }
-                    ascii[MAX_TEXT] = 0;
-                    movies[j].text.text = strdup(ascii);
-                    printf("'%s' at %08x\n", movies[j].text.text, (uint) movies[j].start_sector);
-                    j++;
-                }
+        // maybe a regular partition with movie files on it
+        fat_find_files(partition->first_sector, MOVIE_FILE_EXTENSION, (uint32_t *) context, add_fat_movie, NULL);
+    }
+}
+
+static void find_movies() {
+    // use the back half of image_data for FAT scratch, so it doesn't collide with the GPT table
+    uint32_t *fat_scratch = image_data + IMAGE_DATA_WORDS / 2;
+    static_assert(IMAGE_DATA_WORDS / 2 >= FAT_SCRATCH_WORDS, "");
+    if (gpt_find_partitions(image_data, add_gpt_movies, fat_scratch) >= 0) {
+        if (!movie_count) {
+            panic("No movies found");
+        }
+    } else if (!is_movie_start(0) && fat_find_files(0, MOVIE_FILE_EXTENSION, fat_scratch, add_fat_movie, NULL)) {
+        if (!movie_count) {
+            panic("No " MOVIE_FILE_EXTENSION " movies found");
+        }
+    } else {
+        printf("No GPT found, so assuming single movie\n");
+        movie_count = 1;
+        movies = static_movies;
+    }
+}
+
+#if POPCORN_RESUME
+static bool resume_save_wanted;
+
+#if POPCORN_RESUME_INTERVAL_MS
+static bool resume_playback_save_wanted;
+static uint32_t last_resume_save_ms;
+#endif
+
+// the frame header at or before sector within the movie, or 0 if there isn't one close by
+static uint32_t resume_seek_point(uint32_t movie_start_sector, uint32_t sector) {
+    const struct frame_header *head = (const struct frame_header *) frame_header_sector;
+    if (sector < movie_start_sector) return 0;
+    uint32_t limit = MIN(sector - movie_start_sector + 1, POPCORN_RESUME_SEEK_SECTORS);
+    for (uint i = 0; i < limit; i++, sector--) {
+        // make sure it is still a frame of the same movie (the card may have changed)
+        if (is_movie_start(sector) && head->sector_number == sector - movie_start_sector &&
+            head->sector_number <= head->last_sector) {
+            return sector;
+        }
+    }
+    return 0;
+}
+
+static void resume_from_flash() {
+    struct resume_point point;
+    if (!resume_load(&point)) return;
+    for (uint i = 0; i < movie_count; i++) {
+        if (movies[i].start_sector == point.movie_start_sector) {
+            current_movie = i;
+            uint32_t sector = resume_seek_point(point.movie_start_sector, point.frame_sector);
+            if (sector) {
+                printf("Resuming '%s' at sector %d\n", movies[i].text.text, (int) (sector - point.movie_start_sector));
+                movies[i].current_sector = sector;
             }
-        } else {
-            printf("No GPT found, so assuming single movie\n");
+            return;
         }
     }
+}
+
+static void save_resume_point() {
+    const struct movie *m = &movies[registered_current_movie];
+    struct resume_point point = {
+            .movie_start_sector = m->start_sector,
+            .frame_sector = MAX(m->current_sector, m->start_sector),
+    };
+    if (!resume_save(&point)) {
+        printf("Failed to save resume point\n");
+    }
+    // the picture isn't moving (or the menu is over it), so this is a good time to get the next erase out of the way
+    if ((ds.paused || show_menu) && !resume_prepare()) {
+        printf("Failed to prepare resume log\n");
+    }
+#if POPCORN_RESUME_INTERVAL_MS
+    last_resume_save_ms = to_ms_since_boot(get_absolute_time());
+#endif
+}
+#endif
+
+// done on core 1 at startup while core 0 is setting up video
+static bool sd_booted;
+
+static void boot_sd() {
+    if (sd_init_4pins() >= 0) {
+        find_movies();
+#if POPCORN_RESUME
+        resume_from_flash();
+#endif
+        sd_booted = true;
+        printf("SD card ready after %dms\n", (int) (time_us_32() / 1000));
+    }
+}
+
+static void handle_init() {
+    if (sd_booted) {
+        // first time through, and the card is already initialized
+        sd_booted = false;
+    } else if (sd_init_4pins() < 0) {
+        ds.state = ERROR;
+    } else if (!movie_count) {
+        // only scan the card the first time; we come back here to recover if we fall behind
+        find_movies();
+        if (current_movie >= movie_count) current_movie = 0;
+    }
+    if (!movie_count) {
+        // no card, but we need something to point at
+        movies = static_movies;
+    }
+    prefetch.state = PF_NONE;
+#if POPCORN_TIME_STRETCH
+    stretch_state.ratio = 0;
+    stretch_state.filling = stretch_state.pending = false;
+#endif
     ds.audio.buffer_state[0] = ds.audio.buffer_state[1] = BS_EMPTY;
     ds.audio.load_thread_buffer_index = 0;
     ds.rows.valid_from_row = ds.rows.valid_to_row = 0;
@@ -825,13 +1286,20 @@ static void handle_init(const struct frame_header *head) {
     ds.awaiting_first_frame = 1;
     ds.hold_frame = true;
     registered_current_movie = current_movie;
-    ds.current_sd_read.sector_base = movies[current_movie].start_sector;
+    ds.current_sd_read.sector_base = MAX(movies[current_movie].current_sector, movies[current_movie].start_sector);
     ds.state = NEW_FRAME;
 }
 
 static void __time_critical_func(handle_new_frame)() {
     ds.state = NEED_FRAME_HEADER_SECTOR;
     ds.loaded_audio_this_frame = false;
+    if (prefetch.state == PF_VALID && prefetch.movie == registered_current_movie &&
+        ds.current_sd_read.sector_base == movies[prefetch.movie].start_sector) {
+        // we already have the header, so can go straight to reading the frame data
+        memcpy(frame_header_sector, prefetch.header_sector, sizeof(frame_header_sector));
+        prefetch.state = PF_NONE;
+        accept_frame_header((const struct frame_header *) frame_header_sector);
+    }
 }
 
 static void __time_critical_func(handle_reading_video_sectors)() {
@@ -856,15 +1324,34 @@ static void __time_critical_func(handle_reading_video_sectors)() {
     }
 }
 
+// true if reverse audio needs reversing in RAM rather than by the I2S DMA
+static inline bool reverse_audio_in_place() {
+    if (playback_forwards) return false;
+#if POPCORN_TIME_STRETCH
+    // the time stretching needs to see the audio in the right order
+    if (stretch_state.ratio) return true;
+#endif
+    return !POPCORN_AUDIO_DMA_REVERSE;
+}
+
 static void __time_critical_func(handle_reading_audio_sectors)(const struct frame_header *head) {
     if (sd_scatter_read_complete(NULL)) {
-        // todo we have DMA completely capable of reading backwards - seems like a strange thing to expose in any lower level API though
-        //  still we could use DMA to reverse the buffers for us (although it is a bit complicated to not step on our toes)
-        if (!playback_forwards || volume != 0x100) {
+        int32_t target_gain = volume << 8;
+        if (reverse_audio_in_place() || target_gain != AUDIO_GAIN_UNITY || audio_gain != AUDIO_GAIN_UNITY) {
             total_audio_sectors = (head->audio_words + 127) / 128;
             if (total_audio_sectors & 1) {
                 panic("expected even sector count");
             }
+            audio_ramp.step = audio_gain_step(audio_gain, target_gain, total_audio_sectors * 128);
+            if (!playback_forwards && !reverse_audio_in_place()) {
+                // the DMA plays the buffer from the end backwards, so the ramp must run that way too, starting from the
+                // old gain at the last frame
+                audio_ramp.gain = audio_gain + audio_ramp.step * (int32_t) (head->audio_words - 1);
+                audio_ramp.step = -audio_ramp.step;
+            } else {
+                audio_ramp.gain = audio_gain;
+            }
+            audio_gain = target_gain;
             audio_sector_pairs_to_post_process = total_audio_sectors / 2; // we do them in pairs
             ds.state = POST_PROCESSING_AUDIO_SECTORS;
         } else {
@@ -875,6 +1362,11 @@ static void __time_critical_func(handle_reading_audio_sectors)(const struct fram
 
 static void __time_critical_func(handle_frame_ready)(const struct frame_header *head) {
     // not much to do really now other than start reading data for next sector
+    static bool shown_first_frame;
+    if (!shown_first_frame) {
+        printf("First frame ready after %dms\n", (int) (time_us_32() / 1000));
+        shown_first_frame = true;
+    }
     ds.awaiting_first_frame = false;
     uint index = playback_speed >= 0 ? MIN(playback_speed, 3) : 0;
     if (next_frame_sector_override != -1) {
@@ -883,6 +1375,7 @@ static void __time_critical_func(handle_frame_ready)(const struct frame_header *
         registered_current_movie = current_movie;
     } else {
         uint32_t next_sector;
+        __unused bool hit_end = false;
         if (ds.paused) {
             next_sector = head->sector_number;
         } else {
@@ -895,48 +1388,195 @@ static void __time_critical_func(handle_frame_ready)(const struct frame_header *
         if (next_sector == 0xffffffff) {
             if (playback_forwards) {
                 next_sector = 0;
+                if (playlist_mode && movie_count > 1) {
+                    // switch on this frame boundary; the decoder just carries on into the next movie's first frame
+                    registered_current_movie = current_movie = next_movie_index(registered_current_movie);
+                    display_base_frame = scanvideo_frame_number(scanvideo_get_next_scanline_id());
+                }
+                hit_end = true;
             } else {
                 next_sector = head->last_sector;
             }
         }
         ds.current_sd_read.sector_base = movies[registered_current_movie].start_sector + next_sector;
+#if POPCORN_RESUME
+        if (hit_end) {
+            // the end of a movie, so save the start of whatever plays next
+            movies[registered_current_movie].current_sector = ds.current_sd_read.sector_base;
+            resume_save_wanted = true;
+        }
+#endif
     }
     if (playback_speed < 0) hold_frame_count = 1 - playback_speed;
     else hold_frame_count = 1;
     ds.state = NEW_FRAME;
 }
 
-static void __time_critical_func(handle_await_audio_buffer)() {
+#if POPCORN_TIME_STRETCH
+static uint32_t stretch_ratio_for_speed() {
+    if (ds.paused || playback_speed < -2 || playback_speed > 2) return 0;
+    // frames are being skipped, so we splice together what we do read
+    if (playback_speed > 0) return TIME_STRETCH_RATIO_ONE;
+    // each frame is held for 3 or 4 vsyncs rather than 2
+    if (playback_speed < 0) return TIME_STRETCH_RATIO_ONE * (2 - playback_speed) / 2;
+    return 0;
+}
+
+static void __time_critical_func(queue_stretch_output)() {
+    uint index = ds.audio.load_thread_buffer_index;
+    stretch_state.filling = false;
+    if (!stretch_state.out_count) {
+        ds.audio.buffer_state[index] = BS_EMPTY;
+        return;
+    }
+    audio_buffers[index]->sample_count = stretch_state.out_count;
+    audio_buffers[index]->buffer->bytes = (uint8_t *) audio_buffer_start[index];
+#if POPCORN_AUDIO_DMA_REVERSE
+    ds.audio.dma_reverse[index] = false;
+#endif
+    ds.audio.buffer_state[index] = BS_QUEUED;
+    DEBUG_PINS_SET(audio_buffering, index + 1);
+    give_audio_buffer(audio_buffer_pool, audio_buffers[index]);
+    if (++ds.audio.load_thread_buffer_index == NUM_AUDIO_BUFFERS) ds.audio.load_thread_buffer_index = 0;
+    // the output length per frame isn't exact (particularly when splicing), so we nudge the ratio up if the audio
+    // is about to run dry, i.e. nothing other than the buffer we just queued is waiting to play
+    bool running_low = true;
+    for (uint i = 0; i < NUM_AUDIO_BUFFERS; i++) {
+        if (i != index && ds.audio.buffer_state[i] == BS_QUEUED) running_low = false;
+    }
+    time_stretch_set_ratio(&stretch, running_low ? stretch_state.ratio + stretch_state.ratio / 8 : stretch_state.ratio);
+#if POPCORN_TIME_STRETCH_STATS
+    stretch_state.samples += stretch_state.out_count;
+    if (++stretch_state.buffers == 64) {
+        uint32_t sys_mhz = clock_get_hz(clk_sys) / 1000000;
+        // fraction of the time the output lasts that we spent making it
+        uint32_t per_mille = (uint32_t) ((stretch_state.cycles * 44100ull * 1000) /
+                                         ((uint64_t) sys_mhz * 1000000 * stretch_state.samples));
+        printf("stretch %d/256: %d cycles per %d sample buffer, %d.%d%% of a core at %dMHz\n",
+               (int) stretch_state.ratio, (int) (stretch_state.cycles / stretch_state.buffers),
+               (int) (stretch_state.samples / stretch_state.buffers), (int) per_mille / 10, (int) per_mille % 10,
+               (int) sys_mhz);
+        stretch_state.cycles = stretch_state.samples = stretch_state.buffers = 0;
+    }
+#endif
+}
+
+// returns true if we are stretching audio for this frame
+static bool __time_critical_func(update_stretch_mode)() {
+    uint32_t ratio = stretch_ratio_for_speed();
+    if (ratio != stretch_state.ratio) {
+        // hand over whatever output we have so far
+        if (stretch_state.filling) queue_stretch_output();
+        if (ratio) time_stretch_reset(&stretch, ratio);
+        stretch_state.ratio = ratio;
+        stretch_state.pending = false;
+    }
+    return ratio != 0;
+}
+
+static void __time_critical_func(handle_stretching_audio)() {
+    uint index = ds.audio.load_thread_buffer_index;
+    if (!stretch_state.filling) {
+        if (ds.audio.buffer_state[index] != BS_EMPTY) {
+            // no room for output right now, so get on with the video, and come back when idle
+            stretch_state.pending = true;
+            ds.state = NEED_VIDEO_SECTORS;
+            return;
+        }
+        ds.audio.buffer_state[index] = BS_FILLING;
+        stretch_state.filling = true;
+        stretch_state.out_count = 0;
+    }
+#if POPCORN_TIME_STRETCH_STATS
+    uint32_t t0 = systick_hw->cvr;
+#endif
+    int n = time_stretch_step(&stretch, audio_buffer_start[index] + stretch_state.out_count);
+#if POPCORN_TIME_STRETCH_STATS
+    stretch_state.cycles += (t0 - systick_hw->cvr) & 0xffffffu;
+#endif
+    if (n == TIME_STRETCH_NEED_INPUT) {
+        stretch_state.pending = false;
+        ds.state = NEED_VIDEO_SECTORS;
+    } else {
+        stretch_state.out_count += n;
+        if (stretch_state.out_count + TIME_STRETCH_HOP > AUDIO_BUFFER_K * 256) {
+            queue_stretch_output();
+        }
+    }
+}
+#endif
+
+// returns true if we can start reading this frame's audio (claiming an audio buffer to read it into if necessary)
+static bool __time_critical_func(claim_audio_buffer)() {
+#if POPCORN_TIME_STRETCH
+    if (update_stretch_mode()) {
+        // the input has its own buffer
+        return true;
+    }
+#endif
     if (ds.audio.buffer_state[ds.audio.load_thread_buffer_index] == BS_EMPTY) {
         ds.audio.buffer_state[ds.audio.load_thread_buffer_index] = BS_FILLING;
+        return true;
+    }
+    return false;
+}
+
+static void __time_critical_func(handle_await_audio_buffer)() {
+    if (claim_audio_buffer()) {
         ds.state = NEED_AUDIO_SECTORS;
     }
 }
 
 static void __time_critical_func(handle_hit_end)() {
-    if (ds.hold_frame && ds.audio.buffer_state[ds.audio.load_thread_buffer_index] == BS_EMPTY &&
-!ds.loaded_audio_this_frame) {
-        ds.audio.buffer_state[ds.audio.load_thread_buffer_index] = BS_FILLING;
+    if (ds.hold_frame && !ds.loaded_audio_this_frame && claim_audio_buffer()) {
         ds.state = NEED_AUDIO_SECTORS;
+#if POPCORN_TIME_STRETCH
+    } else if (stretch_state.pending && ds.audio.buffer_state[ds.audio.load_thread_buffer_index] == BS_EMPTY) {
+        ds.state = STRETCHING_AUDIO;
+#endif
+    } else if (prefetch.state == PF_WANTED) {
+        // nothing else to do, so grab the next movie's first header while the SD card is idle
+        uint32_t *p = scatter;
+        *p++ = native_safe_hw_ptr(prefetch.header_sector);
+        *p++ = 128;
+        *p++ = native_safe_hw_ptr(waste);
+        *p++ = 2;
+        *p++ = 0;
+        *p++ = 0;
+        prefetch.header_sector[0] = 0; // mark as invalid
+        sd_readblocks_scatter_async(scatter, movies[prefetch.movie].start_sector, 1);
+        prefetch.state = PF_READING;
+        ds.state = READING_PREFETCH_HEADER_SECTOR;
     } else {
         ds.state = NEED_VIDEO_SECTORS;
     }
 }
 
+static void __time_critical_func(handle_reading_prefetch_header_sector)() {
+    if (sd_scatter_read_complete(NULL)) {
+        const struct frame_header *head = (const struct frame_header *) prefetch.header_sector;
+        if (head->mark0 == 0xffffffff && head->mark1 == 0xffffffff && head->magic == PLATYPUS_MAGIC &&
+            head->header_words <= 128 && !head->sector_number) {
+            prefetch.state = PF_VALID;
+        } else {
+            // just fall back to reading it the normal way
+            printf("no header found @ start of movie %d\n", prefetch.movie);
+            prefetch.state = PF_NONE;
+        }
+        ds.state = NEED_VIDEO_SECTORS;
+    }
+}
+
 static void __time_critical_func(handle_post_processing_audio_sectors)() {
     assert(audio_sector_pairs_to_post_process > 0);
     audio_sector_pairs_to_post_process--;
-    if (!playback_forwards) {
-        reverse_sector_pair(audio_buffer_start[ds.audio.load_thread_buffer_index] +
-                            128 * audio_sector_pairs_to_post_process,
-                            audio_buffer_start[ds.audio.load_thread_buffer_index] +
-                            128 * (total_audio_sectors - 1 - audio_sector_pairs_to_post_process));
-    }
-    if (volume != 0x100) {
-        update_audio_sector_volume(audio_buffer_start[ds.audio.load_thread_buffer_index] +
-                                   128 * audio_sector_pairs_to_post_process);
-        update_audio_sector_volume(audio_buffer_start[ds.audio.load_thread_buffer_index] +
-                                   128 * (total_audio_sectors - 1 - audio_sector_pairs_to_post_process));
+    uint frame1 = 128 * audio_sector_pairs_to_post_process;
+    uint frame2 = 128 * (total_audio_sectors - 1 - audio_sector_pairs_to_post_process);
+    if (reverse_audio_in_place()) {
+        reverse_sector_pair(frame1, frame2);
+    } else {
+        update_audio_sector_volume(frame1);
+        update_audio_sector_volume(frame2);
     }
     if (!audio_sector_pairs_to_post_process) {
         ds.state = AUDIO_BUFFER_READY;
@@ -945,12 +1585,27 @@ static void __time_critical_func(handle_post_processing_audio_sectors)() {
 
 static void __time_critical_func(handle_need_audio_sectors)(const struct frame_header *head) {
     DEBUG_PINS_SET(audio_buffering, 4);
-    assert(ds.audio.buffer_state[ds.audio.load_thread_buffer_index] == BS_FILLING);
-    audio_buffers[ds.audio.load_thread_buffer_index]->sample_count = head->audio_words;
+#if POPCORN_TIME_STRETCH
+    if (stretch_state.ratio) {
+        audio_read_buffer = time_stretch_prepare_input(&stretch, playback_forwards ? 0 : 127u & -head->audio_words);
+    } else
+#endif
+    {
+        assert(ds.audio.buffer_state[ds.audio.load_thread_buffer_index] == BS_FILLING);
+        audio_buffers[ds.audio.load_thread_buffer_index]->sample_count = head->audio_words;
+        audio_read_buffer = audio_buffer_start[ds.audio.load_thread_buffer_index];
+    }
     // todo update sd.current_read_sector for consistency...
     //  can't do it until we pick the next frame sector explicitly rather than just happening into it.
-    sd_readblocks_async(audio_buffer_start[ds.audio.load_thread_buffer_index], ds.audio.sector_base,
-                        (head->audio_words + 127) / 128);
+    uint audio_sectors = (head->audio_words + 127) / 128;
+    assert(audio_sectors * 128 <= AUDIO_BUFFER_K * 256);
+    high_water.audio_words = MAX(high_water.audio_words, audio_sectors * 128);
+#if POPCORN_TIME_STRETCH
+    if (stretch_state.ratio) {
+        high_water.stretch_words = MAX(high_water.stretch_words, audio_read_buffer + audio_sectors * 128 - stretch_input);
+    }
+#endif
+    sd_readblocks_async(audio_read_buffer, ds.audio.sector_base, audio_sectors);
     ds.state = READING_AUDIO_SECTORS;
 }
 
@@ -975,7 +1630,7 @@ static void __attribute__((noinline)) __time_critical_func(sd_state_update)() {
             handle_reading_video_sectors();
             break;
         case INIT:
-            handle_init(head);
+            handle_init();
             break;
         case ERROR:
             panic("doh!");
@@ -985,6 +1640,14 @@ static void __attribute__((noinline)) __time_critical_func(sd_state_update)() {
         case HIT_END:
             handle_hit_end();
             break;
+        case READING_PREFETCH_HEADER_SECTOR:
+            handle_reading_prefetch_header_sector();
+            break;
+#if POPCORN_TIME_STRETCH
+        case STRETCHING_AUDIO:
+            handle_stretching_audio();
+            break;
+#endif
         case READING_AUDIO_SECTORS:
             handle_reading_audio_sectors(head);
             break;
@@ -1017,24 +1680,85 @@ static void __attribute__((noinline)) __time_critical_func(sd_state_update)() {
 #else
 #define DARKEN_MASK 0x3def3def
 #endif
+#if POPCORN_SINGLE_ROW
+// only the row being generated is darkened (and row_delta is ignored); the other row of the pair is scratch
+#define DARKEN_ROWS 1
+#else
+#define DARKEN_ROWS 2
+#endif
 
 static inline void darken(uint32_t *p, uint32_t row_delta, uint32_t *o, int32_t c) {
     int i = 0;
     do {
         p[i] = ((p[i] >> 1) & DARKEN_MASK) + o[i];
-        p[row_delta + i] = ((p[row_delta + i] >> 1) & DARKEN_MASK) + o[i + OVERLAY_WIDTH];
+        if (DARKEN_ROWS == 2) p[row_delta + i] = ((p[row_delta + i] >> 1) & DARKEN_MASK) + o[i + OVERLAY_WIDTH];
         i++;
     } while (i < c);
 }
 
+#if POPCORN_OVERLAY_SPANS
+static inline void darken_only(uint32_t *p, uint32_t row_delta, int32_t from, int32_t to) {
+    for (int i = from; i < to; i++) {
+        p[i] = (p[i] >> 1) & DARKEN_MASK;
+        if (DARKEN_ROWS == 2) p[row_delta + i] = (p[row_delta + i] >> 1) & DARKEN_MASK;
+    }
+}
+
+// darken the whole width, but only add in the overlay where there is something to add
+static inline void darken_spans(uint32_t *p, uint32_t row_delta, uint32_t *o, uint overlay_row) {
+    int from = overlay_row_span[overlay_row].from;
+    int to = overlay_row_span[overlay_row].to;
+    if (DARKEN_ROWS == 2) {
+        from = MIN(from, overlay_row_span[overlay_row + 1].from);
+        to = MAX(to, overlay_row_span[overlay_row + 1].to);
+    }
+    if (from >= to) {
+        darken_only(p, row_delta, 0, OVERLAY_WIDTH);
+    } else {
+        darken_only(p, row_delta, 0, from);
+        darken(p + from, row_delta, o + from, to - from);
+        darken_only(p, row_delta, to, OVERLAY_WIDTH);
+    }
+}
+
+void __attribute__((optimize("O2"))) __no_inline_not_in_flash_func(darken_a)(uint32_t *p, uint32_t row_delta,
+                                                                             uint32_t *o, uint overlay_row) {
+    darken_spans(p, row_delta, o, overlay_row);
+}
+
+void __attribute__((optimize("O2"))) __no_inline_not_in_flash_func(darken_b)(uint32_t *p, uint32_t row_delta,
+                                                                             uint32_t *o, uint overlay_row) {
+    darken_spans(p, row_delta, o, overlay_row);
+}
+
+static void overlay_widen_span(uint row, uint height, uint from, uint to) {
+    to = MIN(to, OVERLAY_WIDTH);
+    for (uint y = row; y < row + height && y < OVERLAY_HEIGHT; y++) {
+        if (from < overlay_row_span[y].from) overlay_row_span[y].from = from;
+        if (to > overlay_row_span[y].to) overlay_row_span[y].to = to;
+    }
+}
+#else
 void __attribute__((optimize("Os"))) __no_inline_not_in_flash_func(darken_a)(uint32_t *p, uint32_t row_delta,
-                                                                             uint32_t *o, int32_t c) {
-    darken(p, row_delta, o, c);
+                                                                             uint32_t *o, uint overlay_row) {
+    darken(p, row_delta, o, OVERLAY_WIDTH);
 }
 
 void __attribute__((optimize("Os"))) __no_inline_not_in_flash_func(darken_b)(uint32_t *p, uint32_t row_delta,
-                                                                             uint32_t *o, int32_t c) {
-    darken(p, row_delta, o, c);
+                                                                             uint32_t *o, uint overlay_row) {
+    darken(p, row_delta, o, OVERLAY_WIDTH);
+}
+#endif
+
+static void reset_overlay() {
+    __builtin_memset(overlay, 0, sizeof(overlay));
+#if POPCORN_OVERLAY_SPANS
+    for (uint i = 0; i < count_of(overlay_row_span); i++) {
+        overlay_row_span[i].from = OVERLAY_WIDTH;
+        overlay_row_span[i].to = 0;
+    }
+#endif
+    last_display_time_code = -1;
 }
 
 void check_debug(const uint32_t *end, struct frame_header *header, uint row) {
@@ -1062,8 +1786,13 @@ void set_unpause() {
     }
 }
 
-void draw_glyph(struct font *font, uint32_t *dest, uint32_t c) {
-    uint32_t *src = font->pixels + c * font->glyph_words;
+void draw_glyph(const struct font *font, uint32_t *dest, uint32_t c) {
+    const uint32_t *src = font->pixels + c * font->glyph_words;
+#if POPCORN_OVERLAY_SPANS
+    uint offset = dest - overlay;
+    uint x = offset % OVERLAY_WIDTH;
+    overlay_widen_span(offset / OVERLAY_WIDTH, font->height, x, x + font->width_words);
+#endif
     for (int y = 0; y < font->height; y++) {
         for (int x = 0; x < font->width_words; x++) {
             dest[x] = src[x];
@@ -1164,6 +1893,28 @@ void volume_down() { volume = MAX(volume - 8, 0); }
 
 void volume_up() { volume = MIN(volume + 8, 0x100); }
 
+static const uint32_t *__attribute__((optimize("O2"))) __no_inline_not_in_flash_func(decompress_row_2x1)(
+        uint32_t *row, const uint32_t *compressed) {
+    return platypus_2x1_decompress_row(row, compressed, 160, row_2x1_deltas,
+                                       platypus_2x1_raw_flag(PIXELS_ARE_RGB565));
+}
+
+// decode a pair of 2x1 rows, skipping the one we'd throw away
+static inline const uint32_t *decompress_rows_2x1(struct scanvideo_scanline_buffer *sb[2],
+                                                  const uint32_t *compressed, uint row_split,
+                                                  __unused uint scanline_num) {
+#if POPCORN_SINGLE_ROW
+    if (scanline_num & 1u) {
+        return decompress_row_2x1(sb[1]->data + 1, compressed + row_split);
+    }
+    decompress_row_2x1(sb[0]->data + 1, compressed);
+    return compressed + row_split;
+#else
+    decompress_row_2x1(sb[0]->data + 1, compressed);
+    return decompress_row_2x1(sb[1]->data + 1, compressed + row_split);
+#endif
+}
+
 void __attribute__((noreturn)) __time_critical_func(render_loop)() {
     static volatile int32_t last_scanline_id[2];
     static uint32_t last_frame_num[2] = {-1, -1};
@@ -1173,12 +1924,27 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
     assert(core_num >= 0 && core_num < 2);
 
     printf("Rendering on core %d\r\n", core_num);
+#if POPCORN_SINGLE_ROW
+    // we still work on a pair of rows; the one we aren't generating is decoded (for 2x2) to scratch, and discarded
+    static uint32_t scratch_row_data[2][PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS];
+    struct scanvideo_scanline_buffer scratch_row = {
+            .data = scratch_row_data[core_num],
+            .data_max = PICO_SCANVIDEO_MAX_SCANLINE_BUFFER_WORDS,
+    };
+#endif
     while (true) {
         struct scanvideo_scanline_buffer *sb[2];
+#if POPCORN_SINGLE_ROW
+        struct scanvideo_scanline_buffer *scanline_buffer = scanvideo_begin_scanline_generation(true);
+        uint row_half = scanvideo_scanline_number(scanline_buffer->scanline_id) & 1u;
+        sb[row_half] = scanline_buffer;
+        sb[row_half ^ 1u] = &scratch_row;
+#else
         sb[0] = scanvideo_begin_scanline_generation_linked(2, true);
         sb[0]->link_after = 2;
         sb[1] = sb[0]->link;
         struct scanvideo_scanline_buffer *scanline_buffer = sb[0];
+#endif
         uint this_display_start_row;
         // do any frame related logic
         mutex_enter_blocking(&frame_logic_mutex);
@@ -1193,24 +1959,30 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
             if (!core_num) {
                 if (show_menu) {
                     if (ds.display_time_code != last_display_time_code) {
+                        // only redraw the digits that changed (usually just the last one or two); the separators
+                        // only need drawing the first time
+                        bool all = last_display_time_code == (uint32_t) -1;
                         uint32_t c = ds.display_time_code;
+                        uint32_t changed = c ^ last_display_time_code;
                         uint32_t *o = overlay + OVERLAY_WIDTH * 2 + 18;
                         for (int n = 0; n < 6; n++) {
-                            draw_glyph(font18, o, (c >> 28) + 1);
+                            if (changed & 0xf0000000u) draw_glyph(font18, o, (c >> 28) + 1);
                             c = c << 4;
+                            changed = changed << 4;
                             o += font18->width_words;
                             if (n == 1 || n == 3) {
-                                draw_glyph(font18, o, 11); // :
+                                if (all) draw_glyph(font18, o, 11); // :
                                 o += 2;
                             } else if (n == 5) {
-                                draw_glyph(font18, o, 0); // .
+                                if (all) draw_glyph(font18, o, 0); // .
                                 o += 2;
                             }
                         }
                         o += (lcd18.line_height - lcd12.line_height) * OVERLAY_WIDTH;
                         for (int n = 0; n < 2; n++) {
-                            draw_glyph(font12, o, (c >> 28) + 1);
+                            if (changed & 0xf0000000u) draw_glyph(font12, o, (c >> 28) + 1);
                             c = c << 4;
+                            changed = changed << 4;
                             o += font12->width_words;
                         }
                         last_display_time_code = ds.display_time_code;
@@ -1228,6 +2000,31 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
             if (frame_num != core_1_last_frame_num) {
                 core_1_last_frame_num = frame_num;
                 handle_input();
+#if POPCORN_RESUME && POPCORN_RESUME_INTERVAL_MS
+                if (!ds.paused && !ds.awaiting_first_frame &&
+                    to_ms_since_boot(get_absolute_time()) - last_resume_save_ms >= POPCORN_RESUME_INTERVAL_MS) {
+                    // the save itself waits for vblank (and does nothing if we haven't moved)
+                    resume_playback_save_wanted = true;
+                }
+#endif
+#if POPCORN_DECODE_STATS
+                for (uint i = 0; i < 2; i++) {
+                    if (decode_sample[i].valid) {
+                        printf("decode frame=%d row=%d part=%d cycles=%d filter=%d\n",
+                               (int) decode_sample[i].frame_number, decode_sample[i].row, decode_sample[i].part,
+                               (int) decode_sample[i].cycles, (int) decode_sample[i].filter_cycles);
+                        decode_sample[i].valid = false;
+                    }
+                }
+#endif
+#if POPCORN_OVERLAY_STATS
+                if (overlay_stats[0].scanlines + overlay_stats[1].scanlines >= 64 * OVERLAY_HEIGHT) {
+                    printf("overlay: %d cycles per scanline pair\n",
+                           (int) ((overlay_stats[0].cycles + overlay_stats[1].cycles) /
+                                  (overlay_stats[0].scanlines + overlay_stats[1].scanlines)));
+                    __builtin_memset(overlay_stats, 0, sizeof(overlay_stats));
+                }
+#endif
 
                 if (ds.hold_frame) {
                     if ((!ds.paused && --remaining_hold_frames <= 0) || ds.unpause) {
@@ -1269,14 +2066,14 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
                 } else {
                     if (frame_num == other_core_frame_number) {
                         first_must_keep_row = MIN(scanvideo_scanline_number(other_core_scanline_id),
-                                                  scanvideo_scanline_number(last_scanline_id[1]));
+                                                  scanvideo_scanline_number(last_scanline_id[1])) >> MOVIE_ROW_SHIFT;
                     } else if (other_core_frame_number == (uint16_t) (frame_num + 1)) {
-                        first_must_keep_row = scanvideo_scanline_number(last_scanline_id[1]);
+                        first_must_keep_row = scanvideo_scanline_number(last_scanline_id[1]) >> MOVIE_ROW_SHIFT;
                     } else {
-                        first_must_keep_row = scanvideo_scanline_number(last_scanline_id[1]);
+                        first_must_keep_row = scanvideo_scanline_number(last_scanline_id[1]) >> MOVIE_ROW_SHIFT;
                         // if we are starving out core 0, then it may be stuck behind us... if we've made it SCANLINE_BUFFER/2 rows in
                         // then the old frame must be done now
-                        if (first_must_keep_row <= PICO_SCANVIDEO_SCANLINE_BUFFER_COUNT / 2) {
+                        if (first_must_keep_row <= (PICO_SCANVIDEO_SCANLINE_BUFFER_COUNT / 2) >> MOVIE_ROW_SHIFT) {
                             first_must_keep_row = -1;
                         }
                     }
@@ -1321,16 +2118,28 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
                     }
                 }
                 if (text_roller || element != last_element) {
-                    uint16_t *out = (uint16_t *) (overlay + (text_roller + 3 + lcd18.line_height) * OVERLAY_WIDTH);
+                    uint row = text_roller + 3 + lcd18.line_height;
+                    uint16_t *out = (uint16_t *) (overlay + row * OVERLAY_WIDTH);
                     if (!element->width) {
                         measure_text(element, OVERLAY_WIDTH * 2);
                     }
                     uint off = 3 + OVERLAY_WIDTH - element->width / 2;
+#if POPCORN_OVERLAY_SPANS
+                    // we only need to clear what was there before
+                    uint old_from = overlay_row_span[row].from * 2;
+                    uint old_to = overlay_row_span[row].to * 2;
+                    if (old_from < off) __builtin_memset(out + old_from, 0, (off - old_from) * 2);
+                    uint len = render_font_line(element, out + off, menu_glypth_bitmap + text_roller, element->color);
+                    if (off + len < old_to) __builtin_memset(out + off + len, 0, (old_to - off - len) * 2);
+                    overlay_row_span[row].from = off / 2;
+                    overlay_row_span[row].to = MIN((off + len + 1) / 2, OVERLAY_WIDTH);
+#else
                     __builtin_memset(out, 0, off * 2);
                     uint len = render_font_line(element, out + off, menu_glypth_bitmap + text_roller, element->color);
                     if (off + len < OVERLAY_WIDTH * 2) {
                         __builtin_memset(out + off + len, 0, (OVERLAY_WIDTH * 2 - off - len) * 2);
                     }
+#endif
                     text_roller++;
                 }
                 if (text_roller == MENU_GLYPH_HEIGHT) {
@@ -1342,7 +2151,7 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
         // we must latch this now under lock so we have the right value on core 0 (core 1 may change it afterwards)
         this_display_start_row = ds.rows.display_start_row;
         mutex_exit(&frame_logic_mutex);
-        uint16_t scanline_num = scanvideo_scanline_number(sb[0]->scanline_id);
+        uint16_t scanline_num = scanvideo_scanline_number(scanline_buffer->scanline_id);
         if (!core_num && core_0_beat_core_1_to_new_frame) {
             // we just do a simple hack to move to the new frame... core 0 does not maintain locks sufficient to interact with core 1 state.
             // this is reasonable as we are about to start drawing the frame anyway.
@@ -1352,11 +2161,19 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
         DEBUG_PINS_SET(frame_generation, (core_num) ? 2 : 4);
         uint16_t *buf16_0 = (uint16_t *) sb[0]->data;
         uint16_t *buf16_1 = (uint16_t *) sb[1]->data;
-        uint row_number = scanline_num;
+        uint row_number = scanline_num >> MOVIE_ROW_SHIFT;
         uint row_index = row_wrap_add(this_display_start_row, row_number);
         bool row_valid = row_index_in_range(row_index, ds.rows.valid_from_row, ds.rows.valid_to_row);
         uint pos;
-        if (row_valid) {
+#if POPCORN_SCANLINE_FILTERS
+        uint8_t filter_ops = row_number < MOVIE_ROWS ? scanline_filter_ops[row_number] : SCANLINE_FILTER_NONE;
+        // we don't letterbox under the menu, as it is drawn on top of the picture
+        bool row_letterboxed = (filter_ops & SCANLINE_FILTER_BLANK) &&
+                               !(show_menu && row_number >= OVERLAY_START && row_number < OVERLAY_END);
+#else
+        const bool row_letterboxed = false;
+#endif
+        if (row_valid && !row_letterboxed) {
             if (row_index >= ROW_OFFSET_CIRCLE_SIZE) {
                 printf("INVALID STATE rn %d+%d %d %d %d\n", this_display_start_row, row_number, ds.rows.valid_from_row, row_index,
                        ds.rows.valid_to_row);
@@ -1364,25 +2181,93 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
             assert(row_index < ROW_OFFSET_CIRCLE_SIZE);
             assert(row_buffer_offsets[row_index] < IMAGE_DATA_WORDS);
             const uint32_t *compressed_scanline = image_data + row_buffer_offsets[row_index];
+            uint row_split = row_split_words[row_index];
+#if POPCORN_DECODE_STATS
+            // a different row each time (37 is coprime with MOVIE_ROWS), every 8th frame
+            bool sample_decode = !(frame_num & 7u) && row_number == (frame_num * 37u) % MOVIE_ROWS &&
+                                 !decode_sample[core_num].valid;
+            uint32_t decode_t0 = systick_hw->cvr, decode_t1, filter_t1;
+#endif
             const int w = 320;
             const __unused uint32_t *end;
+#if POPCORN_SINGLE_ROW
+            // only the row being generated is filtered and darkened; the other row of the pair is scratch
+            uint32_t *filter_row0 = row_half ? NULL : sb[0]->data + 1;
+            uint32_t *filter_row1 = row_half ? sb[1]->data + 1 : NULL;
+            uint overlay_half = row_half;
+#else
+            uint32_t *filter_row0 = sb[0]->data + 1, *filter_row1 = sb[1]->data + 1;
+            const uint overlay_half = 0;
+#endif
             if (core_num) {
-                end = platypus_decompress_row_b(sb[0]->data + 1, sb[1]->data + 1, compressed_scanline, w);
+                if (row_split) {
+                    end = decompress_rows_2x1(sb, compressed_scanline, row_split, scanline_num);
+                } else {
+                    end = platypus_decompress_row_b(sb[0]->data + 1, sb[1]->data + 1, compressed_scanline, w);
+                }
                 __unused struct frame_header *header = (struct frame_header *) frame_header_sector;
                 check_debug(end, header, row_number);
+#if POPCORN_DECODE_STATS
+                decode_t1 = systick_hw->cvr;
+#endif
+#if POPCORN_SCANLINE_FILTERS
+                if (filter_ops) filter_rows(filter_ops, filter_row0, filter_row1);
+#endif
+#if POPCORN_DECODE_STATS
+                filter_t1 = systick_hw->cvr;
+#endif
                 if (show_menu && row_number >= OVERLAY_START && row_number < OVERLAY_END) {
-                    darken_a(sb[0]->data + OVERLAY_X, sb[1]->data - sb[0]->data,
-                             overlay + (row_number - OVERLAY_START) * OVERLAY_WIDTH, OVERLAY_WIDTH);
+#if POPCORN_OVERLAY_STATS
+                    uint32_t t0 = systick_hw->cvr;
+#endif
+                    uint overlay_row = row_number - OVERLAY_START + overlay_half;
+                    darken_a(sb[overlay_half]->data + OVERLAY_X, sb[1]->data - sb[0]->data,
+                             overlay + overlay_row * OVERLAY_WIDTH, overlay_row);
+#if POPCORN_OVERLAY_STATS
+                    overlay_stats[core_num].cycles += (t0 - systick_hw->cvr) & 0xffffffu;
+                    overlay_stats[core_num].scanlines++;
+#endif
                 }
             } else {
-                end = platypus_decompress_row_a(sb[0]->data + 1, sb[1]->data + 1, compressed_scanline, w);
+                if (row_split) {
+                    end = decompress_rows_2x1(sb, compressed_scanline, row_split, scanline_num);
+                } else {
+                    end = platypus_decompress_row_a(sb[0]->data + 1, sb[1]->data + 1, compressed_scanline, w);
+                }
                 __unused struct frame_header *header = (struct frame_header *) frame_header_sector;
                 check_debug(end, header, row_number);
+#if POPCORN_DECODE_STATS
+                decode_t1 = systick_hw->cvr;
+#endif
+#if POPCORN_SCANLINE_FILTERS
+                if (filter_ops) filter_rows(filter_ops, filter_row0, filter_row1);
+#endif
+#if POPCORN_DECODE_STATS
+                filter_t1 = systick_hw->cvr;
+#endif
                 if (show_menu && row_number >= OVERLAY_START && row_number < OVERLAY_END) {
-                    darken_b(sb[0]->data + OVERLAY_X, sb[1]->data - sb[0]->data,
-                             overlay + (row_number - OVERLAY_START) * OVERLAY_WIDTH, OVERLAY_WIDTH);
+#if POPCORN_OVERLAY_STATS
+                    uint32_t t0 = systick_hw->cvr;
+#endif
+                    uint overlay_row = row_number - OVERLAY_START + overlay_half;
+                    darken_b(sb[overlay_half]->data + OVERLAY_X, sb[1]->data - sb[0]->data,
+                             overlay + overlay_row * OVERLAY_WIDTH, overlay_row);
+#if POPCORN_OVERLAY_STATS
+                    overlay_stats[core_num].cycles += (t0 - systick_hw->cvr) & 0xffffffu;
+                    overlay_stats[core_num].scanlines++;
+#endif
                 }
             }
+#if POPCORN_DECODE_STATS
+            if (sample_decode) {
+                decode_sample[core_num].cycles = (decode_t0 - decode_t1) & 0xffffffu;
+                decode_sample[core_num].filter_cycles = (decode_t1 - filter_t1) & 0xffffffu;
+                decode_sample[core_num].frame_number = row_frame_number[row_index];
+                decode_sample[core_num].row = row_number;
+                decode_sample[core_num].part = (POPCORN_SINGLE_ROW && row_split) ? 1 + (scanline_num & 1u) : 0;
+                decode_sample[core_num].valid = true;
+            }
+#endif
 #ifdef ENABLE_STRICT_ASSERTIONS
             const uint16_t *compressed_scanline_owning_row = ram_buffer_owning_row + row_buffer_offsets[row_index];
             uint compressed_len = end - compressed_scanline;
@@ -1400,7 +2285,8 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
             pos = 0; // blank display
             buf16_0[pos] = buf16_1[pos] = COMPOSABLE_RAW_1P;
             pos++;
-            buf16_0[pos] = buf16_1[pos] = 0x7c1f;
+            // magenta if we have no data for the row
+            buf16_0[pos] = buf16_1[pos] = row_letterboxed ? 0 : 0x7c1f;
             pos++;
         }
         {
@@ -1417,13 +2303,34 @@ void __attribute__((noreturn)) __time_critical_func(render_loop)() {
         }
         sb[0]->status = sb[1]->status = SCANLINE_OK;
         DEBUG_PINS_CLR(frame_generation, (core_num) ? 2 : 4);
-        last_scanline_id[core_num] = sb[0]->scanline_id;
-        scanvideo_end_scanline_generation(sb[0]); // sb[1] is linked
+        last_scanline_id[core_num] = scanline_buffer->scanline_id;
+        scanvideo_end_scanline_generation(scanline_buffer); // sb[1] is linked (or scratch for POPCORN_SINGLE_ROW)
+#if POPCORN_RESUME
+        if (core_num && resume_save_wanted) {
+            // this stalls both cores while the flash is written (a page, plus an erase if paused or in the menu)
+            resume_save_wanted = false;
+            save_resume_point();
+        }
+#if POPCORN_RESUME_INTERVAL_MS
+        else if (core_num && resume_playback_save_wanted && scanvideo_in_vblank()) {
+            // nothing is being displayed, and the scanline buffers for the top of the next frame are already queued,
+            // so a page program here (with core 0 locked out) doesn't hold up the video. an erase would, so if the
+            // log needs one, we wait for resume_prepare while paused or in the menu
+            resume_playback_save_wanted = false;
+            if (resume_save_is_page_only()) {
+                save_resume_point();
+            } else {
+                last_resume_save_ms = to_ms_since_boot(get_absolute_time());
+            }
+        }
+#endif
+#endif
     }
 }
 
 void handle_input() {
     uint old_movie = current_movie;
+    __unused bool was_paused = ds.paused;
 #if USE_VGABOARD_BUTTONS
     for (uint b = 0; b < 3; b++) {
         uint m = 1u << b;
@@ -1542,6 +2449,18 @@ void handle_input() {
                 step_forward();
             } else if (c==',') {
                 step_backward();
+            } else if (c=='l') {
+                playlist_mode = !playlist_mode;
+                prefetch.state = PF_NONE;
+                printf("playlist mode %s\n", playlist_mode ? "on" : "off");
+            } else if (c == 'm') {
+                print_memory_plan();
+                print_high_water();
+                print_video_read_stats();
+#if POPCORN_SCANLINE_FILTERS
+            } else if (c == 'f') {
+                set_scanline_filter_preset((scanline_filter_preset + 1) % count_of(scanline_filter_presets));
+#endif
             }
         }
 #endif
@@ -1552,6 +2471,11 @@ void handle_input() {
         }
         set_unpause();
     }
+#if POPCORN_RESUME
+    if (old_movie != current_movie || (ds.paused && !was_paused)) {
+        resume_save_wanted = true;
+    }
+#endif
 }
 
 void setup_video() {
@@ -1562,6 +2486,7 @@ void setup_video() {
 
 void core1_func() {
     init_core(1);
+    boot_sd();
     sem_acquire_blocking(&video_setup_complete);
     render_loop();
 }
@@ -1573,6 +2498,11 @@ void init_core(int core) {
     if (core) {
         audio_i2s_set_enabled(true);
     }
+#if POPCORN_TIME_STRETCH_STATS || POPCORN_OVERLAY_STATS || POPCORN_DECODE_STATS
+    // free running (per core) cycle counter for instrumentation
+    systick_hw->rvr = 0xffffff;
+    systick_hw->csr = 0x5;
+#endif
 }
 
 void setup_audio() {
@@ -1590,7 +2520,7 @@ void setup_audio() {
     struct audio_i2s_config config = {
             .data_pin = PICO_AUDIO_I2S_DATA_PIN,
             .clock_pin_base = PICO_AUDIO_I2S_CLOCK_PIN_BASE,
-            .dma_channel = 1,
+            .dma_channel = AUDIO_DMA_CHANNEL,
 #if PICO_AUDIO_I2S_PIO == 0
             .pio_sm = 2,
 #else
@@ -1598,6 +2528,13 @@ void setup_audio() {
 #endif
     };
 
+#if POPCORN_TIME_STRETCH
+    time_stretch_init(&stretch, stretch_input, count_of(stretch_input));
+#endif
+    reset_overlay();
+#if POPCORN_SCANLINE_FILTERS
+    set_scanline_filter_preset(0);
+#endif
     audio_buffer_pool = audio_new_producer_pool(&producer_format, 0, 0);
     for (int i = 0; i < NUM_AUDIO_BUFFERS; i++) {
         audio_buffers[i] = audio_new_wrapping_buffer(&producer_format,
@@ -1618,7 +2555,10 @@ void setup_audio() {
 }
 
 int main(void) {
-#if PICO_SCANVIDEO_48MHZ
+#if POPCORN_SINGLE_ROW
+    // 6x the pixel clock; decoding every row pair for each of its two scanlines needs about 3x the 50MHz below
+    set_sys_clock_khz(150000, true);
+#elif PICO_SCANVIDEO_48MHZ
     set_sys_clock_48mhz();
 #else
     set_sys_clock_khz(50000, true);
@@ -1636,12 +2576,24 @@ int main(void) {
     vga_board_init_buttons();
 #endif
 
-    font12 = build_font(&lcd12, 4);
-    font18 = build_font(&lcd18, 5);
+#if POPCORN_PREBUILT_FONTS
+    font12 = &font12_prebuilt;
+    font18 = &font18_prebuilt;
+#else
+#ifdef PLATYPUS_565
+    const bool rgb565 = true;
+#else
+    const bool rgb565 = false;
+#endif
+    font12 = build_font(&lcd12, 4, rgb565);
+    font18 = build_font(&lcd18, 5, rgb565);
+#endif
 
 #ifdef ENABLE_STRICT_ASSERTIONS
     memset(ram_buffer_owning_row, 0xee, sizeof(ram_buffer_owning_row));
 #endif
+    platypus_2x1_build_deltas(row_2x1_deltas, PIXELS_ARE_RGB565);
+    print_memory_plan();
 
     mutex_init(&frame_logic_mutex);
     sem_init(&video_setup_complete, 0, 1);
@@ -1649,10 +2601,15 @@ int main(void) {
     ds.state = INIT;
     ds.awaiting_first_frame = true;
     init_core(0);
+#if POPCORN_RESUME
+    // core 1 saves the resume point
+    multicore_lockout_victim_init();
+#endif
 
     setup_audio();
     multicore_launch_core1(core1_func);
     setup_video();
+    check_memory_plan();
 
     // run render loop on core 0 (it is also running on core 1)
     render_loop();
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "resume.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+// Rather than erasing a sector for every save, each save appends a small record to a log kept in the last
+// RESUME_FLASH_SECTORS sectors of flash, and the one with the highest sequence number wins. A sector is only erased
+// before the log wraps round into it (by resume_prepare, ahead of time, so that a save is normally just a page
+// program), so each sector is erased once every RESUME_FLASH_SECTORS * RESUME_RECORDS_PER_SECTOR saves.
+//
+// Records are written by programming the page they are in with everything else 0xff, which leaves the bits of the
+// records already in that page alone.
+
+#ifndef RESUME_FLASH_SECTORS
+#define RESUME_FLASH_SECTORS 4
+#endif
+
+#define RESUME_MAGIC 0x706f7021 // "pop!"
+#define RESUME_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - RESUME_FLASH_SECTORS * FLASH_SECTOR_SIZE)
+
+struct resume_record {
+    uint32_t sequence; // 0xffffffff for an unused record
+    struct resume_point point;
+    uint32_t check;
+};
+
+#define RESUME_RECORDS_PER_SECTOR (FLASH_SECTOR_SIZE / sizeof(struct resume_record))
+#define RESUME_RECORDS_PER_PAGE (FLASH_PAGE_SIZE / sizeof(struct resume_record))
+#define RESUME_RECORD_COUNT (RESUME_FLASH_SECTORS * RESUME_RECORDS_PER_SECTOR)
+
+static_assert(!(FLASH_PAGE_SIZE % sizeof(struct resume_record)), "");
+static_assert(RESUME_FLASH_SECTORS >= 2, "resume_prepare erases the sector after the one in use");
+
+static struct {
+    bool scanned;
+    bool have_last;
+    uint32_t next_record;
+    uint32_t next_sequence;
+    struct resume_point last;
+    int32_t prepared_sector; // known to be blank, or -1
+} resume_log;
+
+static uint32_t resume_check(const struct resume_record *record) {
+    return ~(RESUME_MAGIC ^ (record->sequence * 5) ^ record->point.movie_start_sector ^
+             (record->point.frame_sector * 3));
+}
+
+static inline const struct resume_record *resume_records() {
+    return (const struct resume_record *) (XIP_BASE + RESUME_FLASH_OFFSET);
+}
+
+static bool resume_sector_blank(uint32_t sector_record) {
+    const uint32_t *p = (const uint32_t *) &resume_records()[sector_record];
+    for (uint i = 0; i < FLASH_SECTOR_SIZE / 4; i++) {
+        if (p[i] != 0xffffffff) return false;
+    }
+    return true;
+}
+
+// the next sector the log will start on: this one if we are at its start, otherwise the one after
+static uint32_t resume_next_sector() {
+    uint32_t n = resume_log.next_record;
+    return ((n + RESUME_RECORDS_PER_SECTOR - 1) / RESUME_RECORDS_PER_SECTOR) % RESUME_FLASH_SECTORS;
+}
+
+// find the latest record (a few K of flash reads, so quick enough at boot)
+static void resume_scan() {
+    const struct resume_record *records = resume_records();
+    resume_log.scanned = true;
+    resume_log.have_last = false;
+    resume_log.next_record = 0;
+    resume_log.next_sequence = 0;
+    resume_log.prepared_sector = -1;
+    for (uint i = 0; i < RESUME_RECORD_COUNT; i++) {
+        const struct resume_record *record = &records[i];
+        if (record->sequence == 0xffffffff || record->check != resume_check(record)) continue;
+        if (!resume_log.have_last || record->sequence >= resume_log.next_sequence) {
+            resume_log.have_last = true;
+            resume_log.last = record->point;
+            resume_log.next_record = (i + 1) % RESUME_RECORD_COUNT;
+            resume_log.next_sequence = record->sequence + 1;
+        }
+    }
+    // no need to erase it if it is already blank (e.g. the first time round)
+    uint32_t sector = resume_next_sector();
+    if (resume_sector_blank(sector * RESUME_RECORDS_PER_SECTOR)) resume_log.prepared_sector = (int32_t) sector;
+}
+
+bool resume_load(struct resume_point *point) {
+    if (!resume_log.scanned) resume_scan();
+    if (!resume_log.have_last) return false;
+    *point = resume_log.last;
+    return true;
+}
+
+struct resume_write {
+    uint32_t erase_offset; // or -1 for none
+    uint32_t page_offset; // or -1 for none
+    const uint8_t *page;
+};
+
+static void __no_inline_not_in_flash_func(resume_write)(void *param) {
+    const struct resume_write *w = (const struct resume_write *) param;
+    if (w->erase_offset != 0xffffffff) flash_range_erase(w->erase_offset, FLASH_SECTOR_SIZE);
+    if (w->page_offset != 0xffffffff) flash_range_program(w->page_offset, w->page, FLASH_PAGE_SIZE);
+}
+
+bool resume_save(const struct resume_point *point) {
+    if (!resume_log.scanned) resume_scan();
+    if (resume_log.have_last && !memcmp(&resume_log.last, point, sizeof(*point))) return true;
+    uint32_t n = resume_log.next_record;
+    static uint32_t page[FLASH_PAGE_SIZE / 4];
+    memset(page, 0xff, sizeof(page));
+    struct resume_record *record = (struct resume_record *) page + n % RESUME_RECORDS_PER_PAGE;
+    record->sequence = resume_log.next_sequence;
+    record->point = *point;
+    record->check = resume_check(record);
+    struct resume_write w = {
+            .erase_offset = 0xffffffff,
+            .page_offset = RESUME_FLASH_OFFSET + (n / RESUME_RECORDS_PER_PAGE) * FLASH_PAGE_SIZE,
+            .page = (const uint8_t *) page,
+    };
+    // starting a new sector which resume_prepare didn't get to (and still has old records in it, unless this is the
+    // first time round)
+    uint32_t sector = n / RESUME_RECORDS_PER_SECTOR;
+    if (!(n % RESUME_RECORDS_PER_SECTOR) && resume_log.prepared_sector != (int32_t) sector &&
+        !resume_sector_blank(n)) {
+        w.erase_offset = RESUME_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE;
+    }
+    if (PICO_OK != flash_safe_execute(resume_write, &w, 100)) return false;
+    if (resume_log.prepared_sector == (int32_t) sector) resume_log.prepared_sector = -1;
+    resume_log.have_last = true;
+    resume_log.last = *point;
+    resume_log.next_record = (n + 1) % RESUME_RECORD_COUNT;
+    resume_log.next_sequence++;
+    return true;
+}
+
+bool resume_save_is_page_only() {
+    if (!resume_log.scanned) resume_scan();
+    uint32_t n = resume_log.next_record;
+    // the rest of a sector the log has already started on is still blank
+    return (n % RESUME_RECORDS_PER_SECTOR) || resume_log.prepared_sector == (int32_t) (n / RESUME_RECORDS_PER_SECTOR);
+}
+
+bool resume_prepare() {
+    if (!resume_log.scanned) resume_scan();
+    uint32_t sector = resume_next_sector();
+    if (resume_log.prepared_sector == (int32_t) sector) return true;
+    if (!resume_sector_blank(sector * RESUME_RECORDS_PER_SECTOR)) {
+        struct resume_write w = {
+                .erase_offset = RESUME_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE,
+                .page_offset = 0xffffffff,
+        };
+        if (PICO_OK != flash_safe_execute(resume_write, &w, 100)) return false;
+    }
+    resume_log.prepared_sector = (int32_t) sector;
+    return true;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_RESUME_H
+#define _POPCORN_RESUME_H
+
+#include "pico.h"
+
+// The last played movie and position, kept in the last few sectors of flash (wear levelled, see resume.c), so we can
+// carry on from where we were after a power cycle. The movie is identified by its start sector on the card.
+
+struct resume_point {
+    uint32_t movie_start_sector;
+    uint32_t frame_sector; // absolute sector of a frame header within that movie
+};
+
+// returns false if nothing valid has been saved
+bool resume_load(struct resume_point *point);
+
+// note this programs flash, so must only be called when the other core is able to be locked out (see
+// flash_safe_execute). does nothing if point matches what is already saved. this only programs a page, unless the
+// sector the record goes in hasn't been erased by resume_prepare
+bool resume_save(const struct resume_point *point);
+
+// true if the next resume_save only needs to program a page, i.e. it doesn't start a sector that resume_prepare
+// hasn't erased. this doesn't touch flash, so is cheap enough to call while playing
+bool resume_save_is_page_only();
+
+// erase the sector the log moves into next, if that hasn't been done yet, so later saves only need to program a
+// page. an erase stalls both cores for tens of ms, so only call this when nothing is moving on screen. the same
+// locking rules as resume_save apply
+bool resume_prepare();
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_SCANLINE_FILTER_H
+#define _POPCORN_SCANLINE_FILTER_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Optional post-processing of decoded scanlines (16 bit RGB555 or RGB565 pixels, two per word). The filters are driven
+// by a table with an entry per movie row (i.e. per pair of scanlines), built whenever the settings change, so the
+// render loop only looks up what to do for the current row:
+//
+// SCANLINE_FILTER_BLANK     the row is black (letterboxing); this is cheaper than decoding it
+// SCANLINE_FILTER_LUT       remap each channel through a brightness/gamma table (~3 loads per pixel)
+// SCANLINE_FILTER_DIM       halve the brightness (1 shift and mask per pair of pixels)
+// SCANLINE_FILTER_SCANLINES darken the second scanline of the pair by 1/4 for a CRT look (per pair of pixels)
+//
+// Everything here is inline with no SDK dependencies, so that filter_bench can time it on the host.
+
+#define SCANLINE_FILTER_NONE      0x00
+#define SCANLINE_FILTER_BLANK     0x01
+#define SCANLINE_FILTER_LUT       0x02
+#define SCANLINE_FILTER_DIM       0x04
+#define SCANLINE_FILTER_SCANLINES 0x08
+
+struct scanline_filter_lut {
+    // contribution of each field to the output pixel, indexed by the input field value
+    uint16_t low[32];
+    uint16_t mid[64];
+    uint16_t high[32];
+    uint8_t mid_mask;
+    uint8_t high_shift;
+};
+
+// per channel masks for p >> 1 and p >> 2 such that bits don't bleed between channels
+static inline uint32_t scanline_filter_half_mask(bool rgb565) {
+    return rgb565 ? 0x7bef7befu : 0x3def3defu;
+}
+
+static inline uint32_t scanline_filter_quarter_mask(bool rgb565) {
+    return rgb565 ? 0x39e739e7u : 0x1ce71ce7u;
+}
+
+static inline uint16_t scanline_filter_curve(uint32_t value, uint32_t max, float brightness, float gamma) {
+    float v = powf((float) value / (float) max, gamma) * brightness * (float) max + 0.5f;
+    return (uint16_t) (v > (float) max ? max : v);
+}
+
+// gamma < 1 lifts dark areas; brightness is a straight multiplier (clamped)
+static inline void scanline_filter_build_lut(struct scanline_filter_lut *lut, bool rgb565, float brightness,
+                                             float gamma) {
+    uint32_t mid_bits = rgb565 ? 6 : 5;
+    lut->mid_mask = (uint8_t) ((1u << mid_bits) - 1);
+    lut->high_shift = (uint8_t) (5 + mid_bits);
+    for (uint32_t i = 0; i < 32; i++) {
+        lut->low[i] = scanline_filter_curve(i, 31, brightness, gamma);
+        lut->high[i] = (uint16_t) (scanline_filter_curve(i, 31, brightness, gamma) << lut->high_shift);
+    }
+    for (uint32_t i = 0; i <= lut->mid_mask; i++) {
+        lut->mid[i] = (uint16_t) (scanline_filter_curve(i, lut->mid_mask, brightness, gamma) << 5);
+    }
+}
+
+static inline uint32_t scanline_filter_lut_pixel(const struct scanline_filter_lut *lut, uint32_t p) {
+    return lut->low[p & 0x1f] | lut->mid[(p >> 5) & lut->mid_mask] | lut->high[(p >> lut->high_shift) & 0x1f];
+}
+
+static inline void scanline_filter_lut_row(uint32_t *row, uint32_t words, const struct scanline_filter_lut *lut) {
+    for (uint32_t i = 0; i < words; i++) {
+        uint32_t p = row[i];
+        row[i] = scanline_filter_lut_pixel(lut, p & 0xffff) | (scanline_filter_lut_pixel(lut, p >> 16) << 16);
+    }
+}
+
+static inline void scanline_filter_dim_row(uint32_t *row, uint32_t words, uint32_t half_mask) {
+    for (uint32_t i = 0; i < words; i++) {
+        row[i] = (row[i] >> 1) & half_mask;
+    }
+}
+
+static inline void scanline_filter_scanline_row(uint32_t *row, uint32_t words, uint32_t quarter_mask) {
+    // each channel loses a quarter of itself, which can't borrow from the next channel
+    for (uint32_t i = 0; i < words; i++) {
+        row[i] -= (row[i] >> 2) & quarter_mask;
+    }
+}
+
+// apply the filter ops (other than SCANLINE_FILTER_BLANK, which the caller handles) to a pair of decoded rows; either
+// row may be NULL to leave it out (when only one row of the pair is being shown)
+static inline void scanline_filter_apply(uint8_t ops, uint32_t *row0, uint32_t *row1, uint32_t words,
+                                         const struct scanline_filter_lut *lut, bool rgb565) {
+    if (ops & SCANLINE_FILTER_LUT) {
+        if (row0) scanline_filter_lut_row(row0, words, lut);
+        if (row1) scanline_filter_lut_row(row1, words, lut);
+    }
+    if (ops & SCANLINE_FILTER_DIM) {
+        if (row0) scanline_filter_dim_row(row0, words, scanline_filter_half_mask(rgb565));
+        if (row1) scanline_filter_dim_row(row1, words, scanline_filter_half_mask(rgb565));
+    }
+    if ((ops & SCANLINE_FILTER_SCANLINES) && row1) {
+        scanline_filter_scanline_row(row1, words, scanline_filter_quarter_mask(rgb565));
+    }
+}
+
+#endif
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+"""
+Summarizes the UART output of sd_bench for one or more cards side by side, and optionally checks .pl2 files (on the
+host) against each card's measured performance, using the same model as sd_bench itself.
+
+usage: analyse_sd_bench.py card1.log [card2.log ...] [--pl2 movie.pl2 ...]
+"""
+
+import argparse
+import shlex
+import struct
+
+FRAME_US = 33333
+MAX_BLOCK_COUNT = 32
+VIDEO_READ_BLOCKS = MAX_BLOCK_COUNT - 1
+AUDIO_READ_BLOCKS = 12
+WINDOW_FRAMES = 8
+
+LINE_KINDS = ("init", "found", "seq", "fit", "lat", "scatter", "movie", "verdict", "error", "skip")
+
+
+def parse_log(path):
+    report = {kind: [] for kind in LINE_KINDS}
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            kind = line.split(" ", 1)[0]
+            if kind not in report:
+                continue
+            values = {}
+            for token in shlex.split(line)[1:]:
+                if "=" in token:
+                    key, value = token.split("=", 1)
+                    values[key] = value
+            report[kind].append(values)
+    return report
+
+
+def number(value):
+    try:
+        return float(value)
+    except (TypeError, ValueError):
+        return None
+
+
+def frame_read_us(sectors, overhead_us, per_block_us):
+    video_sectors = max(0, sectors - 1 - AUDIO_READ_BLOCKS)
+    commands = 2 + (video_sectors + VIDEO_READ_BLOCKS - 1) // VIDEO_READ_BLOCKS
+    return commands * overhead_us + sectors * per_block_us
+
+
+def scan_pl2(path):
+    """returns (frames, peak frame sectors, peak WINDOW_FRAMES sectors) by walking the frame headers"""
+    frames = 0
+    peak = 0
+    window = [0] * WINDOW_FRAMES
+    peak_window = 0
+    with open(path, "rb") as f:
+        sector = 0
+        while True:
+            f.seek(sector * 512)
+            head = f.read(108)
+            if len(head) < 108:
+                break
+            mark0, mark1, magic = struct.unpack_from("<III", head, 0)
+            if mark0 != 0xffffffff or mark1 != 0xffffffff or magic != 0x54414c50:
+                raise ValueError("%s: bad frame header at sector %d" % (path, sector))
+            image_words, audio_words = struct.unpack_from("<II", head, 36)
+            forward = struct.unpack_from("<I", head, 76)[0]
+            sectors = 1 + (audio_words + 127) // 128 + (image_words + 127) // 128
+            peak = max(peak, sectors)
+            window[frames % WINDOW_FRAMES] = sectors
+            peak_window = max(peak_window, sum(window))
+            frames += 1
+            if forward == 0xffffffff:
+                break
+            sector = forward
+    return frames, peak, peak_window
+
+
+def verdict(peak, peak_window, fit):
+    overhead = fit["overhead_us"]
+    typical = frame_read_us(peak, overhead, fit["per_block_us"])
+    worst = frame_read_us(peak, fit["worst_overhead_us"], fit["per_block_us"])
+    window = frame_read_us(peak_window / WINDOW_FRAMES, overhead, fit["per_block_us"])
+    if worst <= FRAME_US:
+        result = "OK"
+    elif window <= FRAME_US and typical <= FRAME_US * 3 / 2:
+        result = "MARGINAL"
+    else:
+        result = "FAIL"
+    return typical, worst, window, result
+
+
+def card_fit(report):
+    if not report["fit"]:
+        return None
+    fit = {
+        "overhead_us": number(report["fit"][0]["overhead_us"]),
+        "per_block_us": number(report["fit"][0]["per_block_us"]),
+        "worst_overhead_us": None,
+    }
+    for lat in report["lat"]:
+        if lat.get("blocks") == "1":
+            fit["worst_overhead_us"] = number(lat["p99"])
+    if fit["worst_overhead_us"] is None:
+        fit["worst_overhead_us"] = fit["overhead_us"]
+    return fit
+
+
+def print_table(title, header, rows):
+    print(title)
+    widths = [max(len(str(r[i])) for r in [header] + rows) for i in range(len(header))]
+    for r in [header] + rows:
+        print("  " + "  ".join(str(v).rjust(w) for v, w in zip(r, widths)))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("logs", nargs="+", help="captured sd_bench output, one per card")
+    parser.add_argument("--pl2", nargs="*", default=[], help=".pl2 files to check against each card")
+    args = parser.parse_args()
+
+    reports = [(path, parse_log(path)) for path in args.logs]
+
+    block_counts = sorted({int(s["blocks"]) for _, r in reports for s in r["seq"]})
+    print_table("Sequential read throughput (kB/s)", ["card"] + ["%d blk" % b for b in block_counts],
+                [[path] + [next((s["kBps"] for s in r["seq"] if int(s["blocks"]) == b), "-") for b in block_counts]
+                 for path, r in reports])
+
+    rows = []
+    for path, r in reports:
+        for kind in ("lat", "scatter"):
+            for d in r[kind]:
+                rows.append([path, kind, d["blocks"], d["p50"], d["p90"], d["p99"], d["max"]])
+    print_table("Command latency (us)", ["card", "kind", "blocks", "p50", "p90", "p99", "max"], rows)
+
+    rows = []
+    for path, r in reports:
+        fit = card_fit(r)
+        if fit:
+            rows.append([path, "%.0f" % fit["overhead_us"], "%.2f" % fit["per_block_us"],
+                         "%.0f" % fit["worst_overhead_us"]])
+    print_table("Read model (us = overhead + blocks * per_block)", ["card", "overhead", "per_block", "p99 overhead"],
+                rows)
+
+    rows = []
+    for path, r in reports:
+        for v in r["verdict"]:
+            movie = next((m for m in r["movie"] if m["name"] == v["movie"]), {})
+            rows.append([path, v["movie"], movie.get("peak_sectors", "-"), v["peak_frame_us"],
+                         v["peak_frame_worst_us"], v["peak_window_us"], v["result"]])
+    if rows:
+        print_table("Movies on the card (frame budget %dus)" % FRAME_US,
+                    ["card", "movie", "peak sectors", "peak us", "worst us", "window us", "result"], rows)
+
+    rows = []
+    for pl2 in args.pl2:
+        frames, peak, peak_window = scan_pl2(pl2)
+        for path, r in reports:
+            fit = card_fit(r)
+            if not fit:
+                continue
+            typical, worst, window, result = verdict(peak, peak_window, fit)
+            rows.append([pl2, path, frames, peak, "%.0f" % typical, "%.0f" % worst, "%.0f" % window, result])
+    if rows:
+        print_table("Files checked against each card (frame budget %dus)" % FRAME_US,
+                    ["file", "card", "frames", "peak sectors", "peak us", "worst us", "window us", "result"], rows)
+
+    for path, r in reports:
+        for e in r["error"]:
+            print("%s: error %s" % (path, " ".join("%s=%s" % kv for kv in e.items())))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Companion to popcorn for qualifying SD cards: measures sequential multi-block read throughput, per command
+// latency and scatter read behaviour with the same SD setup as popcorn, then checks whether the card can keep up with
+// the movies on it (at 1x). Output is line based "key=value" so it can be fed to analyse_sd_bench.py
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/sd_card.h"
+#include "hardware/clocks.h"
+#include "fat.h"
+#include "pl2.h"
+
+#define FRAME_US 33333 // popcorn movies are 30fps
+// popcorn reads at most this many blocks of video at once (one less than the max in case a sector is split)
+#define VIDEO_READ_BLOCKS (PICO_SD_MAX_BLOCK_COUNT - 1)
+// the audio for a frame is read in one go
+#define AUDIO_READ_BLOCKS 12
+// peak load over this many frames (popcorn has enough buffering to ride out a single big frame, but not many)
+#define WINDOW_FRAMES 8
+
+#define SEQUENTIAL_BYTES (4 * 1024 * 1024)
+#define LATENCY_SAMPLES 256
+#define MAX_MOVIES 4
+
+static uint32_t buffer[PICO_SD_MAX_BLOCK_COUNT * 128];
+static uint32_t scatter[(PICO_SD_MAX_BLOCK_COUNT * 3 + 1) * 2];
+static uint32_t crc_waste[2];
+static uint32_t fat_scratch[FAT_SCRATCH_WORDS];
+static uint32_t gpt_scratch[128];
+static uint32_t samples[LATENCY_SAMPLES];
+
+static struct movie {
+    char name[FAT_MAX_NAME_LENGTH + 1];
+    uint32_t start_sector;
+    uint32_t sector_count; // 0 if unknown
+} movies[MAX_MOVIES];
+static uint movie_count;
+
+// where we do the throughput tests (somewhere we know is readable)
+static uint32_t test_sector_base;
+static uint32_t test_sector_count;
+
+// linear fit of read time against block count: us = overhead + per_block * blocks
+static struct {
+    float overhead_us;
+    float per_block_us;
+    uint32_t worst_overhead_us; // from the latency tail
+} fit;
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static bool is_frame_header(uint32_t sector) {
+    if (sd_readblocks_sync(buffer, sector, 1) < 0) return false;
+    return pl2_is_frame_header((const struct frame_header *) buffer);
+}
+
+static void add_movie(const char *name, uint32_t start_sector, uint32_t sector_count) {
+    if (movie_count == MAX_MOVIES) return;
+    struct movie *m = &movies[movie_count++];
+    strncpy(m->name, name, FAT_MAX_NAME_LENGTH);
+    m->start_sector = start_sector;
+    m->sector_count = sector_count;
+}
+
+static void add_fat_movie(const struct fat_file *file, __unused void *context) {
+    if (!fat_file_is_contiguous(file)) {
+        printf("skip name=\"%s\" reason=fragmented\n", file->name);
+        return;
+    }
+    if (is_frame_header(file->extents[0].sector)) {
+        add_movie(file->name, file->extents[0].sector, file->extents[0].sector_count);
+    }
+}
+
+static void add_gpt_movies(const struct gpt_partition *partition, __unused void *context) {
+    if (is_frame_header(partition->first_sector)) {
+        add_movie(partition->name, partition->first_sector, partition->sector_count);
+    } else {
+        fat_find_files(partition->first_sector, ".pl2", fat_scratch, add_fat_movie, NULL);
+    }
+}
+
+static void find_movies() {
+    if (is_frame_header(0)) {
+        add_movie("<raw>", 0, 0);
+        return;
+    }
+    if (gpt_find_partitions(gpt_scratch, add_gpt_movies, NULL) < 0) {
+        fat_find_files(0, ".pl2", fat_scratch, add_fat_movie, NULL);
+    }
+}
+
+static uint32_t timed_read(uint32_t sector, uint blocks) {
+    uint32_t t0 = time_us_32();
+    if (sd_readblocks_sync(buffer, sector, blocks) < 0) {
+        printf("error op=read sector=%d blocks=%d\n", (int) sector, blocks);
+    }
+    return time_us_32() - t0;
+}
+
+static void bench_sequential() {
+    static const uint block_counts[] = {1, 2, 4, 8, 12, 16, VIDEO_READ_BLOCKS};
+    float sum_n = 0, sum_t = 0, sum_nn = 0, sum_nt = 0;
+    for (uint i = 0; i < count_of(block_counts); i++) {
+        uint blocks = block_counts[i];
+        uint reads = SEQUENTIAL_BYTES / (blocks * 512);
+        uint32_t sector = test_sector_base;
+        uint32_t total = 0;
+        for (uint r = 0; r < reads; r++) {
+            total += timed_read(sector, blocks);
+            sector += blocks;
+            if (sector + blocks > test_sector_base + test_sector_count) sector = test_sector_base;
+        }
+        float us = (float) total / (float) reads;
+        printf("seq blocks=%d reads=%d us_per_read=%d kBps=%d\n", blocks, reads, (int) us,
+               (int) (blocks * 512 * 1000.0f / us));
+        sum_n += blocks;
+        sum_t += us;
+        sum_nn += (float) (blocks * blocks);
+        sum_nt += blocks * us;
+    }
+    float n = count_of(block_counts);
+    fit.per_block_us = (n * sum_nt - sum_n * sum_t) / (n * sum_nn - sum_n * sum_n);
+    fit.overhead_us = (sum_t - fit.per_block_us * sum_n) / n;
+    printf("fit overhead_us=%d per_block_us=%d.%02d\n", (int) fit.overhead_us, (int) fit.per_block_us,
+           (int) (fit.per_block_us * 100) % 100);
+}
+
+static void print_distribution(const char *what, uint blocks) {
+    qsort(samples, LATENCY_SAMPLES, sizeof(samples[0]), compare_u32);
+    // power of 2 histogram from <64us to >=32ms
+    uint hist[11] = {0};
+    for (uint i = 0; i < LATENCY_SAMPLES; i++) {
+        uint b = 0;
+        while (b < count_of(hist) - 1 && samples[i] >= (64u << b)) b++;
+        hist[b]++;
+    }
+    printf("%s blocks=%d p50=%d p90=%d p99=%d max=%d hist=", what, blocks, (int) samples[LATENCY_SAMPLES / 2],
+           (int) samples[LATENCY_SAMPLES * 9 / 10], (int) samples[LATENCY_SAMPLES * 99 / 100],
+           (int) samples[LATENCY_SAMPLES - 1]);
+    for (uint b = 0; b < count_of(hist); b++) printf(b ? ",%d" : "%d", hist[b]);
+    printf("\n");
+}
+
+static void bench_latency() {
+    static const uint block_counts[] = {1, AUDIO_READ_BLOCKS, VIDEO_READ_BLOCKS};
+    for (uint i = 0; i < count_of(block_counts); i++) {
+        uint blocks = block_counts[i];
+        // random positions, as seen when seeking or switching movies
+        for (uint s = 0; s < LATENCY_SAMPLES; s++) {
+            uint32_t sector = test_sector_base + (rand() % (test_sector_count - blocks));
+            samples[s] = timed_read(sector, blocks);
+        }
+        print_distribution("lat", blocks);
+        if (blocks == 1) {
+            // worst case per command cost, beyond the transfer itself
+            fit.worst_overhead_us = samples[LATENCY_SAMPLES * 99 / 100];
+        }
+    }
+}
+
+static void bench_scatter() {
+    static const uint block_counts[] = {1, 8, 16, VIDEO_READ_BLOCKS};
+    for (uint i = 0; i < count_of(block_counts); i++) {
+        uint blocks = block_counts[i];
+        // like popcorn video reads, each block is split between two rows (and the CRC is read too)
+        uint32_t *p = scatter;
+        for (uint b = 0; b < blocks; b++) {
+            uint split = 16 + (b * 37) % 96;
+            *p++ = native_safe_hw_ptr(buffer + b * 128);
+            *p++ = split;
+            *p++ = native_safe_hw_ptr(buffer + b * 128 + split);
+            *p++ = 128 - split;
+            *p++ = native_safe_hw_ptr(crc_waste);
+            *p++ = 2;
+        }
+        *p++ = 0;
+        *p++ = 0;
+        uint32_t sector = test_sector_base;
+        for (uint s = 0; s < LATENCY_SAMPLES; s++) {
+            uint32_t t0 = time_us_32();
+            sd_readblocks_scatter_async(scatter, sector, blocks);
+            int status = 0;
+            while (!sd_scatter_read_complete(&status));
+            samples[s] = time_us_32() - t0;
+            if (status < 0) printf("error op=scatter sector=%d blocks=%d\n", (int) sector, blocks);
+            sector += blocks;
+            if (sector + blocks > test_sector_base + test_sector_count) sector = test_sector_base;
+        }
+        print_distribution("scatter", blocks);
+    }
+}
+
+// how long it takes popcorn to read a frame of the given size, split into commands as popcorn does
+static uint32_t frame_read_us(uint32_t sectors, uint32_t overhead_us) {
+    uint32_t video_sectors = sectors > 1 + AUDIO_READ_BLOCKS ? sectors - 1 - AUDIO_READ_BLOCKS : 0;
+    uint commands = 2 + (video_sectors + VIDEO_READ_BLOCKS - 1) / VIDEO_READ_BLOCKS;
+    return (uint32_t) (commands * overhead_us + sectors * fit.per_block_us);
+}
+
+static void check_movie(const struct movie *m) {
+    uint32_t sector = m->start_sector;
+    uint32_t frames = 0;
+    uint32_t peak_sectors = 0, peak_frame = 0;
+    uint32_t window[WINDOW_FRAMES] = {0};
+    uint32_t window_sum = 0, peak_window = 0;
+    uint32_t total_sectors = 0;
+    uint32_t t0 = time_us_32();
+    while (sd_readblocks_sync(buffer, sector, 1) >= 0) {
+        const struct frame_header *head = (const struct frame_header *) buffer;
+        if (!pl2_is_frame_header(head)) {
+            printf("error op=header sector=%d movie=\"%s\"\n", (int) sector, m->name);
+            break;
+        }
+        uint32_t sectors = pl2_frame_sectors(head);
+        if (sectors > peak_sectors) {
+            peak_sectors = sectors;
+            peak_frame = head->frame_number;
+        }
+        window_sum += sectors - window[frames % WINDOW_FRAMES];
+        window[frames % WINDOW_FRAMES] = sectors;
+        peak_window = MAX(peak_window, window_sum);
+        total_sectors += sectors;
+        frames++;
+        if (!(frames % 3000)) printf("progress movie=\"%s\" frames=%d\n", m->name, (int) frames);
+        if (head->forward_frame_sector[0] == 0xffffffff) break;
+        sector = m->start_sector + head->forward_frame_sector[0];
+    }
+    if (!frames) return;
+    printf("movie name=\"%s\" start=%d frames=%d scan_ms=%d avg_sectors=%d peak_sectors=%d peak_frame=%d "
+           "window=%d peak_window_sectors=%d\n", m->name, (int) m->start_sector, (int) frames,
+           (int) ((time_us_32() - t0) / 1000), (int) (total_sectors / frames), (int) peak_sectors, (int) peak_frame,
+           WINDOW_FRAMES, (int) peak_window);
+    uint32_t typical_us = frame_read_us(peak_sectors, (uint32_t) fit.overhead_us);
+    uint32_t worst_us = frame_read_us(peak_sectors, fit.worst_overhead_us);
+    uint32_t window_us = frame_read_us(peak_window / WINDOW_FRAMES, (uint32_t) fit.overhead_us);
+    // OK if the worst frame fits even with slow commands, MARGINAL if the peak fits on average
+    const char *result = worst_us <= FRAME_US ? "OK" :
+                         (window_us <= FRAME_US && typical_us <= FRAME_US * 3 / 2) ? "MARGINAL" : "FAIL";
+    printf("verdict movie=\"%s\" frame_budget_us=%d peak_frame_us=%d peak_frame_worst_us=%d peak_window_us=%d "
+           "result=%s\n", m->name, FRAME_US, (int) typical_us, (int) worst_us, (int) window_us, result);
+}
+
+int main(void) {
+#if PICO_SCANVIDEO_48MHZ
+    set_sys_clock_48mhz();
+#else
+    set_sys_clock_khz(50000, true);
+#endif
+    stdio_init_all();
+    sleep_ms(2000); // give the host a chance to connect
+
+    printf("sd_bench start\n");
+    if (sd_init_4pins() < 0) {
+        printf("error op=init\n");
+        return 1;
+    }
+    printf("init ok bus=4bit sys_khz=%d\n", (int) (clock_get_hz(clk_sys) / 1000));
+
+    find_movies();
+    for (uint i = 0; i < movie_count; i++) {
+        printf("found name=\"%s\" start=%d sectors=%d\n", movies[i].name, (int) movies[i].start_sector,
+               (int) movies[i].sector_count);
+    }
+    if (movie_count && movies[0].sector_count > SEQUENTIAL_BYTES / 512) {
+        test_sector_base = movies[0].start_sector;
+        test_sector_count = movies[0].sector_count;
+    } else {
+        // no idea what is on the card, so stay near the start
+        test_sector_base = 0;
+        test_sector_count = SEQUENTIAL_BYTES / 512;
+    }
+
+    bench_sequential();
+    bench_latency();
+    bench_scatter();
+    for (uint i = 0; i < movie_count; i++) {
+        check_movie(&movies[i]);
+    }
+    printf("sd_bench done\n");
+    return 0;
+}
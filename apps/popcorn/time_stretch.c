@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include "time_stretch.h"
+
+#define HOP_SHIFT __builtin_ctz(TIME_STRETCH_HOP)
+static_assert(!(TIME_STRETCH_HOP & (TIME_STRETCH_HOP - 1)), "");
+
+// first pass looks at every 8th candidate position (comparing every 8th frame), then we refine around the best
+#define COARSE_STEP 8
+#define FINE_SAMPLE_STEP 4
+// each mono() product can reach 4096 * 4096 = 2^24, so correlate() can only sum 64 of them (127 to be exact) in an
+// int32; a full hop at step 1 would overflow
+static_assert(TIME_STRETCH_HOP / FINE_SAMPLE_STEP <= 64, "correlate() would overflow");
+static_assert(FINE_SAMPLE_STEP <= COARSE_STEP, "");
+
+void time_stretch_init(struct time_stretch *ts, uint32_t *buffer, uint buffer_words) {
+    assert(buffer_words > TIME_STRETCH_INPUT_BASE);
+    ts->buffer = buffer;
+    ts->buffer_words = buffer_words;
+    time_stretch_reset(ts, TIME_STRETCH_RATIO_ONE);
+}
+
+void time_stretch_set_ratio(struct time_stretch *ts, uint32_t ratio) {
+    // note we only go faster by splicing; grains are never taken further apart than a hop
+    assert(ratio >= TIME_STRETCH_RATIO_ONE);
+    ts->ratio = ratio;
+    ts->analysis_hop = (TIME_STRETCH_HOP << 16u) / ratio;
+}
+
+void time_stretch_reset(struct time_stretch *ts, uint32_t ratio) {
+    time_stretch_set_ratio(ts, ratio);
+    ts->start = ts->end = TIME_STRETCH_INPUT_BASE;
+    ts->analysis_pos = TIME_STRETCH_INPUT_BASE << 8u;
+    ts->prev_tail = TIME_STRETCH_INPUT_BASE;
+    ts->floor = ts->splice = 0;
+    ts->spliced = false;
+    ts->phase = TS_START;
+}
+
+uint32_t *time_stretch_prepare_input(struct time_stretch *ts, uint skip) {
+    assert(skip < 128);
+    uint nominal = ts->analysis_pos >> 8u;
+    uint keep_from = ts->phase == TS_START ? nominal : MIN(ts->prev_tail, nominal - TIME_STRETCH_SEEK);
+    keep_from = MAX(keep_from, ts->start);
+    uint retained = ts->end > keep_from ? ts->end - keep_from : 0;
+    if (retained > TIME_STRETCH_HISTORY) {
+        // shouldn't happen, but if it does the best we can do is start again
+        time_stretch_reset(ts, ts->ratio);
+        retained = 0;
+    } else {
+        uint new_start = TIME_STRETCH_INPUT_BASE - retained;
+        memmove(ts->buffer + new_start, ts->buffer + keep_from, retained * 4);
+        ts->prev_tail = ts->prev_tail + new_start - keep_from;
+        ts->analysis_pos += (new_start - keep_from) << 8u;
+        ts->floor = ts->floor > keep_from ? ts->floor + new_start - keep_from : 0;
+        if (ts->splice) ts->splice = ts->splice + new_start - keep_from;
+        ts->start = new_start;
+        ts->end = TIME_STRETCH_INPUT_BASE;
+    }
+    return ts->buffer + TIME_STRETCH_INPUT_BASE - skip;
+}
+
+void time_stretch_add_input(struct time_stretch *ts, uint frames, bool discontinuous) {
+    assert(ts->end + frames <= ts->buffer_words);
+    if (discontinuous && ts->phase != TS_START) {
+        // we'll play out what is left of the old input before fading into the new
+        ts->splice = ts->end;
+    }
+    ts->end += frames;
+}
+
+static inline int32_t mono(uint32_t frame) {
+    // scaled down to 13 bits so that a sum of products over every FINE_SAMPLE_STEP'th frame of a hop can't overflow
+    // (see the static_assert above; this is not enough for every frame)
+    return ((int16_t) frame + (int16_t) (frame >> 16u)) >> 4;
+}
+
+#pragma GCC push_options
+#pragma GCC optimize("O3")
+
+static int32_t __time_critical_func(correlate)(const uint32_t *a, const uint32_t *b, uint step) {
+    int32_t sum = 0;
+    for (uint i = 0; i < TIME_STRETCH_HOP; i += step) {
+        sum += mono(a[i]) * mono(b[i]);
+    }
+    return sum;
+}
+
+static int __time_critical_func(search)(const struct time_stretch *ts, uint nominal, int from, int to, int step,
+                                        uint sample_step, int best) {
+    const uint32_t *prev = ts->buffer + ts->prev_tail;
+    int32_t best_score = INT32_MIN;
+    uint lowest = MAX(ts->start, ts->floor);
+    for (int offset = from; offset <= to; offset += step) {
+        if (nominal + offset < lowest) continue;
+        int32_t score = correlate(ts->buffer + nominal + offset, prev, sample_step);
+        if (score > best_score) {
+            best_score = score;
+            best = offset;
+        }
+    }
+    return best;
+}
+
+static void __time_critical_func(cross_fade)(uint32_t *out, const uint32_t *from, const uint32_t *to) {
+    for (int i = 0; i < TIME_STRETCH_HOP; i++) {
+        uint32_t a = from[i];
+        uint32_t b = to[i];
+        int32_t l = ((int16_t) a * (TIME_STRETCH_HOP - i) + (int16_t) b * i) >> HOP_SHIFT;
+        int32_t r = ((int16_t) (a >> 16u) * (TIME_STRETCH_HOP - i) + (int16_t) (b >> 16u) * i) >> HOP_SHIFT;
+        out[i] = (uint16_t) l | (((uint32_t) r) << 16u);
+    }
+}
+
+#pragma GCC pop_options
+
+int __time_critical_func(time_stretch_step)(struct time_stretch *ts, uint32_t *out) {
+    uint nominal = ts->analysis_pos >> 8u;
+    switch (ts->phase) {
+        case TS_START:
+            // no previous grain to line up with
+            if (nominal + 2 * TIME_STRETCH_HOP > ts->end) return TIME_STRETCH_NEED_INPUT;
+            memcpy(out, ts->buffer + nominal, TIME_STRETCH_HOP * 4);
+            ts->prev_tail = nominal + TIME_STRETCH_HOP;
+            ts->analysis_pos += ts->analysis_hop;
+            ts->phase = TS_SEARCH_COARSE;
+            return TIME_STRETCH_HOP;
+        case TS_SEARCH_COARSE:
+            if (ts->splice) {
+                // the previous tail (and everything up to the splice) is contiguous, so just copy it out until we
+                // are left with one hop's worth to fade from
+                uint n = MIN(ts->splice - TIME_STRETCH_HOP - ts->prev_tail, TIME_STRETCH_HOP);
+                if (n) {
+                    memcpy(out, ts->buffer + ts->prev_tail, n * 4);
+                    ts->prev_tail += n;
+                    return n;
+                }
+                ts->analysis_pos = ts->splice << 8u;
+                ts->floor = ts->splice;
+                ts->splice = 0;
+                ts->spliced = true;
+                nominal = ts->analysis_pos >> 8u;
+            }
+            // we need the whole of any candidate grain, as its second half is the next tail
+            if (nominal + TIME_STRETCH_SEEK + 2 * TIME_STRETCH_HOP > ts->end) return TIME_STRETCH_NEED_INPUT;
+            ts->best_offset = search(ts, nominal, -TIME_STRETCH_SEEK, TIME_STRETCH_SEEK, COARSE_STEP, COARSE_STEP, 0);
+            ts->phase = TS_SEARCH_FINE;
+            return 0;
+        case TS_SEARCH_FINE:
+            ts->best_offset = search(ts, nominal,
+                                     MAX(ts->best_offset - COARSE_STEP / 2, -TIME_STRETCH_SEEK),
+                                     MIN(ts->best_offset + COARSE_STEP / 2, TIME_STRETCH_SEEK),
+                                     1, FINE_SAMPLE_STEP, ts->best_offset);
+            ts->phase = TS_MIX;
+            return 0;
+        case TS_MIX: {
+            uint grain = nominal + ts->best_offset;
+            cross_fade(out, ts->buffer + ts->prev_tail, ts->buffer + grain);
+            ts->prev_tail = grain + TIME_STRETCH_HOP;
+            if (ts->spliced) {
+                // the fade used up a hop of both the old and new input; don't advance, so the next grain is
+                // taken from around here again, and we don't lose time overall
+                ts->spliced = false;
+            } else {
+                ts->analysis_pos += ts->analysis_hop;
+            }
+            ts->phase = TS_SEARCH_COARSE;
+            return TIME_STRETCH_HOP;
+        }
+    }
+    return TIME_STRETCH_NEED_INPUT;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _POPCORN_TIME_STRETCH_H
+#define _POPCORN_TIME_STRETCH_H
+
+#include "pico.h"
+
+// Fixed point WSOLA (waveform similarity overlap-add) time stretching of interleaved 16 bit stereo, so that
+// audio can be slowed down (or spliced back together after frames were skipped) without changing its pitch.
+//
+// Output is built a hop at a time by cross-fading the tail of the previous grain into a new grain taken from
+// around the nominal input position; the new grain's exact position is chosen within +/- TIME_STRETCH_SEEK
+// frames to best line up with the previous one, which avoids the phasing you get from plain overlap-add.
+//
+// Work is split into small steps (time_stretch_step) so it can be interleaved with everything else the
+// decoder core is doing.
+
+// synthesis hop (and cross-fade length) in stereo frames; must be a power of 2
+#define TIME_STRETCH_HOP 256
+#define TIME_STRETCH_SEEK 64
+
+// we never need to keep more than this much previous input around
+#define TIME_STRETCH_HISTORY (2 * TIME_STRETCH_HOP + 2 * TIME_STRETCH_SEEK)
+
+// input is placed after the history, allowing for up to 127 words of padding before it (where
+// sector aligned reverse audio starts)
+#define TIME_STRETCH_INPUT_BASE (TIME_STRETCH_HISTORY + 128)
+
+#define TIME_STRETCH_RATIO_ONE 256
+
+struct time_stretch {
+    uint32_t *buffer;
+    uint buffer_words;
+    // valid input is buffer[start, end)
+    uint start;
+    uint end;
+    uint32_t ratio; // output frames per input frame (8.8 fixed point)
+    uint32_t analysis_hop; // input frames per hop (24.8 fixed point)
+    uint32_t analysis_pos; // nominal position of the next grain (24.8 fixed point)
+    uint prev_tail; // where the tail of the previous grain starts
+    uint floor; // no grain may start before here (the input has a discontinuity)
+    uint splice; // if non zero, the position of a discontinuity we haven't reached yet
+    bool spliced; // the next mix is the fade across a discontinuity
+    int best_offset;
+    enum {
+        TS_START, TS_SEARCH_COARSE, TS_SEARCH_FINE, TS_MIX
+    } phase;
+};
+
+void time_stretch_init(struct time_stretch *ts, uint32_t *buffer, uint buffer_words);
+
+// drop all input, and start afresh with the given ratio (e.g. 512 for half speed)
+void time_stretch_reset(struct time_stretch *ts, uint32_t ratio);
+
+// change the ratio without discarding any input (so without a glitch)
+void time_stretch_set_ratio(struct time_stretch *ts, uint32_t ratio);
+
+// returns where up to (buffer_words - TIME_STRETCH_INPUT_BASE) + skip words of new input should be written, such that
+// the first valid frame is at the returned pointer + skip
+uint32_t *time_stretch_prepare_input(struct time_stretch *ts, uint skip);
+
+// add frames of input (previously written to the address from time_stretch_prepare_input). discontinuous should be set
+// if the input does not follow on from the previous input (e.g. because frames were skipped), so that we splice at
+// that point rather than fading across it
+void time_stretch_add_input(struct time_stretch *ts, uint frames, bool discontinuous);
+
+#define TIME_STRETCH_NEED_INPUT (-1)
+
+/**
+ * Do the next bounded piece of work.
+ *
+ * \param out where to write output; must have space for TIME_STRETCH_HOP frames
+ * \return the number of frames written to out (0 to TIME_STRETCH_HOP), or TIME_STRETCH_NEED_INPUT if no
+ * further progress can be made until more input is added
+ */
+int time_stretch_step(struct time_stretch *ts, uint32_t *out);
+
+#endif
@@ -77,6 +77,21 @@ uint perf_base;
 static uint16_t bar_chart[2][128];
 static uint bar_chart_size[2];
 #endif
+
+// cache the tokens for each row of the image, which are the same every frame unless the screen edge clips it
+#define USE_SPAN_CACHE
+// print the span cache hit rate every 10 seconds (the printf may cost a scanline or two)
+//#define PRINT_SPAN_CACHE_STATS
+
+#ifdef USE_SPAN_CACHE
+// one slot per row of the pi400 image, and room for all of them (they average about 45 halfwords)
+#define PI_SPAN_CACHE_SLOTS 400
+#define PI_SPAN_CACHE_ARENA_HALFWORDS 20480
+static struct span_cache_slot pi_span_cache_slots[PI_SPAN_CACHE_SLOTS];
+static uint16_t pi_span_cache_arena[PI_SPAN_CACHE_ARENA_HALFWORDS];
+static struct span_cache pi_span_cache;
+#endif
+
 static const int input_pin0 = 22;
 // to make sure only one core updates the state when the frame number changes
 // todo note we should actually make sure here that the other core isn't still rendering (i.e. all must arrive before either can proceed - a la barrier)
@@ -245,6 +260,14 @@ void __time_critical_func(render_loop)() {
             // this could should be during vblank as we try to create the next line
             // todo should we ignore if we aren't attempting the next line
             last_frame_num = frame_num;
+#if defined(USE_SPAN_CACHE) && defined(PRINT_SPAN_CACHE_STATS)
+            if (!(frame_num % 600)) {
+                uint32_t lookups = pi_span_cache.stats.hits + pi_span_cache.stats.misses;
+                printf("span cache: %d%% hits, %d flushes\n",
+                       lookups ? (int) (pi_span_cache.stats.hits * 100 / lookups) : 0, (int) pi_span_cache.stats.flushes);
+                pi_span_cache.stats.hits = pi_span_cache.stats.misses = pi_span_cache.stats.flushes = 0;
+            }
+#endif
             if (hspeed > 0) {
                 left += hspeed;
                 if (left >= vga_mode.width - pi400_image_data.width / 2) {
@@ -471,6 +494,11 @@ void init_render_state(int core) {
         //left = vga_mode.width - pi400_image_data.width;
         top = -159;
         left = 148;
+#ifdef USE_SPAN_CACHE
+        assert(pi400_image_data.height <= PI_SPAN_CACHE_SLOTS);
+        span_cache_init(&pi_span_cache, pi_span_cache_slots, PI_SPAN_CACHE_SLOTS, pi_span_cache_arena,
+                        PI_SPAN_CACHE_ARENA_HALFWORDS);
+#endif
     }
 
     // todo we should of course have a wide solid color span that overlaps
@@ -503,6 +531,9 @@ bool __time_critical_func(render_scanline_pi)(struct scanvideo_scanline_buffer *
         int sl = l;//&63;
         set_vogon_4bit_span_encoding(&pi_span[core], pi400_image_data.blob.bytes + pi400_image_data.row_offsets[sl],
                                      pi400_image_data.row_offsets[sl + 1] - pi400_image_data.row_offsets[sl]);
+#ifdef USE_SPAN_CACHE
+        set_span_cache(&pi_span[core], &pi_span_cache, sl);
+#endif
         length = render_spans(buf, buf_length, &before_span[core], vga_mode.width);
     }
 
@@ -6,35 +6,123 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include "image.h"
 #include "pico/scanvideo.h"
 
+static uint16_t blend_color(uint32_t fore_color, uint32_t back_color) {
+    uint32_t bb = (back_color >> 16) & 0xff;
+    uint32_t bg = (back_color >> 8) & 0xff;
+    uint32_t br = (back_color >> 0) & 0xff;
+    uint32_t fa = (fore_color >> 24) & 0xff;
+    uint32_t fb = (fore_color >> 16) & 0xff;
+    uint32_t fg = (fore_color >> 8) & 0xff;
+    uint32_t fr = (fore_color >> 0) & 0xff;
+    if (fa == 255) fa = 256;
+    fb = (fa * fb + (256 - fa) * bb) >> 11;
+    fg = (fa * fg + (256 - fa) * bg) >> 11;
+    fr = (fa * fr + (256 - fa) * br) >> 11;
+    return PICO_SCANVIDEO_PIXEL_FROM_RGB5(fr, fg, fb);
+}
+
 struct palette16 *blend_palette(const struct palette32 *source, uint32_t back_color) {
     struct palette16 *dest = (struct palette16 *) malloc(sizeof(struct palette16) + source->size * sizeof(uint16_t));
+    dest->generation = 0;
+    reblend_palette(dest, source, back_color);
+    return dest;
+}
+
+void reblend_palette(struct palette16 *dest, const struct palette32 *source, uint32_t back_color) {
     dest->flags =
             CF_PALETTE_COMPOSITED | (source->flags & ~(CF_HAS_SEMI_TRANSPARENT | CF_HAS_TRANSPARENT)) | CF_HAS_OPAQUE;
     dest->composited_on_color = back_color;
     dest->size = source->size;
+    dest->generation++;
     uint32_t __unused ba = (back_color >> 24) & 0xff;
-    uint32_t bb = (back_color >> 16) & 0xff;
-    uint32_t bg = (back_color >> 8) & 0xff;
-    uint32_t br = (back_color >> 0) & 0xff;
     assert(ba == 255); // expect to be on an opaque color
+    if (source->size && !(source->entries[0] >> 24)) {
+        // even though we don't record alpha in the blended palette, we may care to use a color key (of 0)
+        dest->flags |= CF_PALETTE_INDEX_0_TRANSPARENT;
+    }
     for (int i = 0; i < source->size; i++) {
-        uint32_t fore_color = source->entries[i];
-        uint32_t fa = (fore_color >> 24) & 0xff;
-        uint32_t fb = (fore_color >> 16) & 0xff;
-        uint32_t fg = (fore_color >> 8) & 0xff;
-        uint32_t fr = (fore_color >> 0) & 0xff;
-        if (!i && !fa) {
-            // even though we don't record alpha in the blended palette, we may care to use a color key (of 0)
-            dest->flags |= CF_PALETTE_INDEX_0_TRANSPARENT;
+        dest->entries[i] = blend_color(source->entries[i], back_color);
+    }
+}
+
+void reblend_palette_entries(struct palette16 *dest, const struct palette32 *source, uint first, uint count) {
+    assert(dest->flags & CF_PALETTE_COMPOSITED);
+    assert(first + count <= source->size && source->size == dest->size);
+    dest->generation++;
+    if (!first && count) {
+        dest->flags &= ~CF_PALETTE_INDEX_0_TRANSPARENT;
+        if (!(source->entries[0] >> 24)) dest->flags |= CF_PALETTE_INDEX_0_TRANSPARENT;
+    }
+    for (uint i = first; i < first + count; i++) {
+        dest->entries[i] = blend_color(source->entries[i], dest->composited_on_color);
+    }
+}
+
+void blend_palette_cache_init(struct blend_palette_cache *cache, uint entry_count, uint max_palette_size) {
+    memset(cache, 0, sizeof(struct blend_palette_cache));
+    cache->entries = (struct blend_palette_cache_entry *) calloc(entry_count, sizeof(struct blend_palette_cache_entry));
+    if (!cache->entries) panic("out of memory for the blend palette cache");
+    cache->entry_count = entry_count;
+    cache->max_palette_size = max_palette_size;
+    // all the palettes are allocated up front, so there is no heap churn later
+    for (uint i = 0; i < entry_count; i++) {
+        cache->entries[i].palette = (struct palette16 *) malloc(
+                sizeof(struct palette16) + max_palette_size * sizeof(uint16_t));
+        if (!cache->entries[i].palette) panic("out of memory for the blend palette cache");
+        cache->entries[i].palette->generation = 0;
+    }
+}
+
+struct palette16 *blend_palette_cached(struct blend_palette_cache *cache, const struct palette32 *source,
+                                       uint32_t back_color) {
+    assert(source->size <= cache->max_palette_size);
+    struct blend_palette_cache_entry *lru = cache->entries;
+    cache->clock++;
+    for (uint i = 0; i < cache->entry_count; i++) {
+        struct blend_palette_cache_entry *entry = &cache->entries[i];
+        if (entry->source == source && entry->back_color == back_color) {
+            entry->last_used = cache->clock;
+            cache->stats.hits++;
+            return entry->palette;
+        }
+        if (entry->last_used < lru->last_used) lru = entry;
+    }
+    cache->stats.misses++;
+    lru->source = source;
+    lru->back_color = back_color;
+    lru->last_used = cache->clock;
+    reblend_palette(lru->palette, source, back_color);
+    return lru->palette;
+}
+
+void blend_palette_cache_invalidate(struct blend_palette_cache *cache, const struct palette32 *source) {
+    for (uint i = 0; i < cache->entry_count; i++) {
+        if (!source || cache->entries[i].source == source) {
+            cache->entries[i].source = NULL;
+            cache->entries[i].last_used = 0;
+        }
+    }
+}
+
+struct palette16 *blend_palette_pair(const struct palette32 *fore, const struct palette32 *back) {
+    assert(fore->size <= 16 && back->size <= 16);
+    struct palette16 *dest = (struct palette16 *) malloc(sizeof(struct palette16) + 256 * sizeof(uint16_t));
+    dest->flags = CF_PALETTE_COMPOSITED | CF_HAS_OPAQUE;
+    dest->composited_on_color = 0; // varies
+    dest->size = 256;
+    dest->generation = 0;
+    for (int f = 0; f < 16; f++) {
+        for (int b = 0; b < 16; b++) {
+            // unused entries are black
+            uint32_t fore_color = f < fore->size ? fore->entries[f] : 0xff000000;
+            uint32_t back_color = b < back->size ? back->entries[b] : 0xff000000;
+            assert((back_color >> 24) == 255); // expect the background to be opaque
+            dest->entries[(f << 4) | b] = blend_color(fore_color, back_color);
         }
-        if (fa == 255) fa = 256;
-        fb = (fa * fb + (256 - fa) * bb) >> 11;
-        fg = (fa * fg + (256 - fa) * bg) >> 11;
-        fr = (fa * fr + (256 - fa) * br) >> 11;
-        dest->entries[i] = PICO_SCANVIDEO_PIXEL_FROM_RGB5(fr, fg, fb);
     }
     return dest;
 }
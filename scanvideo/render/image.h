@@ -30,6 +30,7 @@ struct palette16 {
     uint16_t size;
     short_flags flags;
     uint32_t composited_on_color; // if flags & CF_PALETTE_COMPOSITED
+    uint16_t generation; // bumped whenever the entries are changed in place, so span caches notice
     uint16_t entries[];
 };
 
@@ -70,5 +71,39 @@ struct tile_data16 {
 };
 
 extern struct palette16 *blend_palette(const struct palette32 *source, uint32_t back_color);
+// blends into an existing palette (of the same size), e.g. for a new background color each frame
+extern void reblend_palette(struct palette16 *dest, const struct palette32 *source, uint32_t back_color);
+// re-blends just some source entries that have changed (e.g. a fade) onto dest's existing composited_on_color
+extern void reblend_palette_entries(struct palette16 *dest, const struct palette32 *source, uint first, uint count);
+// 256 entries, indexed by (fore index << 4) | back index, for drawing one 16 color image over another
+extern struct palette16 *blend_palette_pair(const struct palette32 *fore, const struct palette32 *back);
+
+// least recently used cache of blended palettes, keyed by source palette and back color. The returned palettes belong
+// to the cache, and stay valid until entry_count other (source, back_color) pairs have been asked for since. After that
+// the palette is re-blended in place for another pair, so a span still using it changes colour (span caches do notice,
+// as its generation is bumped)
+struct blend_palette_cache_entry {
+    const struct palette32 *source; // NULL if unused
+    uint32_t back_color;
+    uint32_t last_used;
+    struct palette16 *palette;
+};
+
+struct blend_palette_cache {
+    struct blend_palette_cache_entry *entries;
+    uint entry_count;
+    uint max_palette_size;
+    uint32_t clock;
+    struct {
+        uint32_t hits;
+        uint32_t misses;
+    } stats;
+};
+
+extern void blend_palette_cache_init(struct blend_palette_cache *cache, uint entry_count, uint max_palette_size);
+extern struct palette16 *blend_palette_cached(struct blend_palette_cache *cache, const struct palette32 *source,
+                                              uint32_t back_color);
+// needed if a source palette's entries change (NULL for all)
+extern void blend_palette_cache_invalidate(struct blend_palette_cache *cache, const struct palette32 *source);
 
 #endif //SOFTWARE_IMAGE_H
@@ -48,6 +48,47 @@ void init_vogon_4bit_span(struct span *span, uint16_t content_width, const uint8
     assert(CF_HAS_OPAQUE == (palette->flags & CF_OPACITY_MASK));
 }
 
+void init_raw_4bit_span(struct span *span, uint16_t content_width, const uint8_t *data, uint16_t data_length,
+                        struct palette16 *palette, struct span *prev) {
+    init_span(span, SPAN_4BIT_RAW, palette->flags & CF_OPACITY_MASK, content_width, prev);
+    set_raw_span_data(span, data, data_length);
+    span->raw_4bit.content_width = content_width;
+    span->raw_4bit.palette = palette;
+    // palette should be opaque
+    assert(CF_HAS_OPAQUE == (palette->flags & CF_OPACITY_MASK));
+}
+
+void init_raw_8bit_span(struct span *span, uint16_t content_width, const uint8_t *data, uint16_t data_length,
+                        struct palette16 *palette, struct span *prev) {
+    init_span(span, SPAN_8BIT_RAW, palette->flags & CF_OPACITY_MASK, content_width, prev);
+    set_raw_span_data(span, data, data_length);
+    span->raw_8bit.content_width = content_width;
+    span->raw_8bit.palette = palette;
+    // palette should be opaque
+    assert(CF_HAS_OPAQUE == (palette->flags & CF_OPACITY_MASK));
+}
+
+void init_vogon_over_raw_4bit_span(struct span *span, uint16_t content_width, const uint8_t *encoding,
+                                   uint16_t encoded_size, const uint8_t *back_data, struct palette16 *pair_palette,
+                                   struct span *prev) {
+    init_span(span, SPAN_4BIT_VOGON_OVER_RAW, pair_palette->flags & CF_OPACITY_MASK, content_width, prev);
+    set_vogon_over_raw_4bit_span_data(span, encoding, encoded_size, back_data);
+    span->vogon_over_raw.content_width = content_width;
+    span->vogon_over_raw.palette = pair_palette;
+    assert(pair_palette->size == 256);
+    // palette should be opaque
+    assert(CF_HAS_OPAQUE == (pair_palette->flags & CF_OPACITY_MASK));
+    // opaque fore colors can be output as color runs
+    for (int f = 0; f < 16; f++) {
+        const uint16_t *row = pair_palette->entries + (f << 4);
+        bool opaque = true;
+        for (int b = 1; b < 16 && opaque; b++) {
+            opaque = row[b] == row[0];
+        }
+        if (opaque) span->vogon_over_raw.opaque_fore |= 1u << f;
+    }
+}
+
 void __time_critical_func(set_solid_color_span_color)(struct span *span, uint16_t color16) {
     assert(span->type == SPAN_SOLID);
     span->solid.color16 = color16;
@@ -59,8 +100,23 @@ void __time_critical_func(set_vogon_4bit_span_encoding)(struct span *span, const
     span->vogon.data_length = data_length;
 }
 
+void __time_critical_func(set_raw_span_data)(struct span *span, const uint8_t *data, uint16_t data_length) {
+    assert(span->type == SPAN_4BIT_RAW || span->type == SPAN_8BIT_RAW);
+    span->raw_4bit.data = data;
+    span->raw_4bit.data_length = data_length;
+}
+
+void __time_critical_func(set_vogon_over_raw_4bit_span_data)(struct span *span, const uint8_t *encoding,
+                                                             uint16_t encoded_size, const uint8_t *back_data) {
+    assert(span->type == SPAN_4BIT_VOGON_OVER_RAW);
+    span->vogon_over_raw.data = encoding;
+    span->vogon_over_raw.data_length = encoded_size;
+    span->vogon_over_raw.back_data = back_data;
+}
+
+// note composited vogon spans (unlike plain ones) may be clipped on both sides at once
 void __time_critical_func(set_vogon_4bit_clipping)(struct span *span, int clip_left, int display_width) {
-    assert(span->type == SPAN_4BIT_VOGON_OPAQUE);
+    assert(span->type == SPAN_4BIT_VOGON_OPAQUE || span->type == SPAN_4BIT_VOGON_OVER_RAW);
     assert(clip_left >= 0);
     assert(display_width >= 0); // todo should we allow this? probably
     assert(clip_left + display_width <= span->vogon.content_width);
@@ -68,6 +124,139 @@ void __time_critical_func(set_vogon_4bit_clipping)(struct span *span, int clip_l
     span->width = display_width;
 }
 
+// unlike vogon spans, raw spans may be clipped on both sides at once
+void __time_critical_func(set_raw_span_clipping)(struct span *span, int clip_left, int display_width) {
+    assert(span->type == SPAN_4BIT_RAW || span->type == SPAN_8BIT_RAW);
+    assert(clip_left >= 0);
+    assert(display_width >= 0);
+    assert(clip_left + display_width <= span->raw_4bit.content_width);
+    span->raw_4bit.clip_left = clip_left;
+    span->width = display_width;
+}
+
+void span_cache_init(struct span_cache *cache, struct span_cache_slot *slots, uint slot_count, uint16_t *arena,
+                     uint arena_halfwords) {
+    memset(cache, 0, sizeof(struct span_cache));
+    cache->slots = slots;
+    cache->slot_count = slot_count;
+    cache->arena = arena;
+    cache->arena_size = arena_halfwords;
+    critical_section_init(&cache->lock);
+    span_cache_flush(cache);
+}
+
+static void span_cache_flush_locked(struct span_cache *cache) {
+    // sequences are left alone, so a fetch in progress can still tell its slot has changed
+    for (uint i = 0; i < cache->slot_count; i++) {
+        cache->slots[i].data = NULL;
+        cache->slots[i].capacity = 0;
+    }
+    cache->generation++;
+    // space being copied into by a store in progress mustn't be handed out again, so it is just lost until next time
+    if (!cache->storing) cache->arena_used = 0;
+}
+
+void span_cache_flush(struct span_cache *cache) {
+    critical_section_enter_blocking(&cache->lock);
+    span_cache_flush_locked(cache);
+    critical_section_exit(&cache->lock);
+}
+
+void __time_critical_func(set_span_cache)(struct span *span, struct span_cache *cache, uint slot) {
+    assert(span->type != SPAN_SOLID); // solid spans are cheaper to render than copy
+    assert(span->type != SPAN_4BIT_VOGON_OVER_RAW); // the key doesn't include the background
+    assert(!cache || slot < cache->slot_count);
+    span->cache = cache;
+    span->cache_slot = slot;
+}
+
+static inline bool span_cache_slot_matches(const struct span_cache_slot *slot, const struct span *span, int width) {
+    // all the non solid span types share the vogon layout
+    return slot->data == span->vogon.data && slot->palette == span->vogon.palette &&
+           slot->palette_generation == span->vogon.palette->generation && slot->clip_left == span->vogon.clip_left &&
+           slot->width == width && slot->type == span->type;
+}
+
+// copies the cached tokens for the span to *output if they are there. the copy is done without the lock; if the slot
+// was written, or the arena reused, while we were copying, it is a miss (and the caller renders over what we copied)
+static bool __time_critical_func(span_cache_fetch)(const struct span *span, int width, uint16_t **output) {
+    struct span_cache *cache = span->cache;
+    struct span_cache_slot *slot = &cache->slots[span->cache_slot];
+    critical_section_enter_blocking(&cache->lock);
+    uint32_t sequence = slot->sequence;
+    uint32_t generation = cache->generation;
+    bool hit = !(sequence & 1u) && span->vogon.data && span_cache_slot_matches(slot, span, width);
+    uint32_t offset = slot->offset;
+    uint halfwords = slot->halfwords;
+    critical_section_exit(&cache->lock);
+    if (hit) {
+        // the destination is only halfword aligned, but memcpy copies words when the alignment matches
+        memcpy(*output, cache->arena + offset, halfwords * 2);
+        __dmb();
+        hit = slot->sequence == sequence && cache->generation == generation;
+    }
+    // stats are approximate, as they are updated without the lock
+    if (hit) {
+        *output += halfwords;
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+    }
+    return hit;
+}
+
+// the space for the tokens is reserved under the lock, then they are copied in without it
+static void __time_critical_func(span_cache_store)(const struct span *span, int width, const uint16_t *tokens,
+                                                   uint halfwords) {
+    struct span_cache *cache = span->cache;
+    struct span_cache_slot *slot = &cache->slots[span->cache_slot];
+    critical_section_enter_blocking(&cache->lock);
+    if (slot->sequence & 1u) {
+        // the other core is storing to this slot
+        cache->stats.collisions++;
+        critical_section_exit(&cache->lock);
+        return;
+    }
+    if (halfwords > slot->capacity) {
+        if (cache->arena_used + halfwords > cache->arena_size) {
+            // entries whose clipping has since changed are never reclaimed otherwise
+            span_cache_flush_locked(cache);
+            cache->stats.flushes++;
+        }
+        if (cache->arena_used + halfwords > cache->arena_size) {
+            // too big, or the arena couldn't be reused as the other core is storing
+            cache->stats.uncached++;
+            critical_section_exit(&cache->lock);
+            return;
+        }
+        slot->offset = cache->arena_used;
+        slot->capacity = halfwords;
+        cache->arena_used += halfwords;
+    }
+    slot->sequence++;
+    slot->data = NULL;
+    cache->storing++;
+    uint32_t generation = cache->generation;
+    critical_section_exit(&cache->lock);
+
+    memcpy(cache->arena + slot->offset, tokens, halfwords * 2);
+
+    critical_section_enter_blocking(&cache->lock);
+    cache->storing--;
+    // if the cache was flushed meanwhile the slot has already been emptied (and its space may be handed out again)
+    if (cache->generation == generation) {
+        slot->data = span->vogon.data;
+        slot->palette = span->vogon.palette;
+        slot->palette_generation = span->vogon.palette->generation;
+        slot->clip_left = span->vogon.clip_left;
+        slot->width = width;
+        slot->type = span->type;
+        slot->halfwords = halfwords;
+    }
+    slot->sequence++;
+    critical_section_exit(&cache->lock);
+}
+
 // todo needs to be shared - currently the same as GAP_SKIPPED_PIXELS as it happens
 #define MIN_COLOR_RUN 3
 
@@ -170,6 +359,55 @@ int32_t __time_critical_func(single_color_scanline)(uint32_t *buf, size_t buf_le
     } \
 } else __builtin_unreachable()
 
+// for a run starting on the high nibble of a byte and ending on the low nibble of another (so count is even)
+#define output_4bit_paletted_pixels_xx(output, palette_entries, encoding, count) if (true) { \
+    span_assert((count)>0); \
+    span_assert(!((count)&1)); \
+    uint32_t p = *encoding++; \
+    if ((count)>2) { \
+        *output++ = COMPOSABLE_RAW_RUN; \
+        *output++ = palette_entries[p>>4]; \
+        *output++ = (count) - 3; \
+        int c = ((count)-2)>>1; \
+        while (c--) { \
+            p = *encoding++; \
+            *output++ = palette_entries[p&0xf]; \
+            *output++ = palette_entries[p>>4]; \
+        } \
+    } else { \
+        *output++ = COMPOSABLE_RAW_2P; \
+        *output++ = palette_entries[p>>4]; \
+    } \
+    p = *encoding++; \
+    *output++ = palette_entries[p&0xf]; \
+} else __builtin_unreachable()
+
+#define output_8bit_paletted_pixels(output, palette_entries, data, count) if (true) { \
+    span_assert((count)>0); \
+    if ((count)>2) { \
+        *output++ = COMPOSABLE_RAW_RUN; \
+        *output++ = palette_entries[*data++]; \
+        *output++ = (count) - 3; \
+        int c = (count) - 1; \
+        for (; c >= 2; c -= 2) { \
+            *output++ = palette_entries[data[0]]; \
+            *output++ = palette_entries[data[1]]; \
+            data += 2; \
+        } \
+        if (c) { \
+            *output++ = palette_entries[*data++]; \
+        } \
+    } else { \
+        if ((count) == 1) { \
+            *output++ = COMPOSABLE_RAW_1P; \
+        } else { \
+            *output++ = COMPOSABLE_RAW_2P; \
+            *output++ = palette_entries[*data++]; \
+        } \
+        *output++ = palette_entries[*data++]; \
+    } \
+} else __builtin_unreachable()
+
 #define output_color_one_pixel(output, color) if (true) { \
         *output++ = COMPOSABLE_RAW_1P; \
         *output++ = color; \
@@ -205,6 +443,84 @@ int32_t __time_critical_func(single_color_scanline)(uint32_t *buf, size_t buf_le
     } \
 } else __builtin_unreachable()
 
+static inline uint16_t composite_pixel(const uint16_t *pair_entries, uint fore_index, const uint8_t *back_data, int x) {
+    return pair_entries[(fore_index << 4) | ((back_data[x >> 1] >> ((x & 1) << 2)) & 0xf)];
+}
+
+// each vogon command's pixels are composited over the matching background pixels; this is simpler (and slower) than
+// the plain vogon path, as every non opaque pixel needs a lookup anyway
+static bool __time_critical_func(render_vogon_over_raw)(uint16_t **output_ptr, const struct span *span, int width) {
+    uint16_t *output = *output_ptr;
+    const uint16_t *pair_entries = span->vogon_over_raw.palette->entries;
+    const uint8_t *encoding = span->vogon_over_raw.data;
+    const uint8_t *back_data = span->vogon_over_raw.back_data;
+    uint opaque_fore = span->vogon_over_raw.opaque_fore;
+    int start = span->vogon_over_raw.clip_left;
+    int end = start + width;
+    // content position of the current command
+    int x = 0;
+    while (x < end) {
+        uint8_t c = *encoding++;
+        int run_length;
+        const uint8_t *fore_pixels = NULL;
+        uint fore_index = 0;
+        if (RAW_PIXELS_SHORT == (c & 0xc0)) {
+            run_length = ((c & 0x3f) + 1) * 2;
+            fore_pixels = encoding;
+        } else if (COLOR_PIXELS_SHORT == (c & 0xc0)) {
+            run_length = ((c & 0x3f) + MIN_COLOR_SPAN_4BIT);
+            fore_index = *encoding++ & 0xf;
+        } else if (SINGLE_PIXEL == (c & 0xf0)) {
+            run_length = 1;
+            fore_index = c & 0xf;
+        } else if (c == COLOR_PIXELS_LONG || c == RAW_PIXELS_LONG) {
+            run_length = 1 + *encoding++;
+            run_length += (*encoding++) << 8;
+            if (c == RAW_PIXELS_LONG) {
+                fore_pixels = encoding;
+            } else {
+                fore_index = *encoding++ & 0xf;
+            }
+        } else {
+            // including END_OF_LINE before the end of the content
+            return false;
+        }
+        if (fore_pixels) encoding += run_length >> 1;
+        int from = MAX(x, start);
+        int count = MIN(x + run_length, end) - from;
+        if (count > 0) {
+            if (!fore_pixels && (opaque_fore & (1u << fore_index))) {
+                uint16_t color = pair_entries[fore_index << 4];
+                output_color_run_of_any_size(output, color, count);
+            } else {
+                for (int i = from; i < from + count; i++) {
+                    if (fore_pixels) {
+                        int n = i - x;
+                        fore_index = (fore_pixels[n >> 1] >> ((n & 1) << 2)) & 0xf;
+                    }
+                    uint16_t pixel = composite_pixel(pair_entries, fore_index, back_data, i);
+                    if (i == from) {
+                        if (count == 1) {
+                            *output++ = COMPOSABLE_RAW_1P;
+                        } else if (count == 2) {
+                            *output++ = COMPOSABLE_RAW_2P;
+                        } else {
+                            *output++ = COMPOSABLE_RAW_RUN;
+                            *output++ = pixel;
+                            *output++ = count - 3;
+                            continue;
+                        }
+                    }
+                    *output++ = pixel;
+                }
+            }
+        }
+        x += run_length;
+    }
+    *output_ptr = output;
+    return true;
+}
+
 /**
  * This method is kinda ugly, but really needs to be fast - C++ and particular templates and references could probably make it better
  * but still, this will probably want to be assembly anyway. For now cut and paste code rather than sub-method fragments to string together...
@@ -238,6 +554,10 @@ int32_t __time_critical_func(render_spans)(uint32_t *render_spans_buffer, size_t
         }
         // todo i think this is reasonable, since for it to be 0 we'd have to have pixels_remaining == 0
         span_assert(local_pixels_remaining > 0);
+        uint16_t *span_output = output;
+        if (cur->cache && span_cache_fetch(cur, local_pixels_remaining, &output)) {
+            continue;
+        }
         if (cur->type == SPAN_SOLID) {
             // no hard clipping work; we just output what we're told
             uint16_t color = cur->solid.color16;
@@ -306,14 +626,16 @@ int32_t __time_critical_func(render_spans)(uint32_t *render_spans_buffer, size_t
                     int run_length = 1 + *encoding++;
                     run_length += (*encoding++ << 8);
                     span_assert(!(run_length & 1)); // we always have even numbers of pixels
+                    const uint8_t *end = encoding + (run_length >> 1);
                     if (skip_pixels_remaining < run_length) {
                         encoding += skip_pixels_remaining >> 1;
                         run_length -= skip_pixels_remaining;
                         output_4bit_paletted_pixels_xf(output, palette_entries, encoding, run_length);
                         skip_pixels_remaining = 0;
                     } else {
-                        encoding += run_length >> 1;
+                        // wholly clipped
                         skip_pixels_remaining -= run_length;
+                        encoding = end;
                     }
                     span_assert(encoding == end);
                 } else if (c == END_OF_LINE) {
@@ -429,6 +751,39 @@ int32_t __time_critical_func(render_spans)(uint32_t *render_spans_buffer, size_t
                     }
                 }
             }
+        } else if (cur->type == SPAN_4BIT_RAW) {
+            // local_pixels_remaining already accounts for any right clipping
+            int first = cur->raw_4bit.clip_left;
+            const uint16_t *palette_entries = cur->raw_4bit.palette->entries;
+            const uint8_t *encoding = cur->raw_4bit.data + (first >> 1);
+            span_assert(cur->raw_4bit.data_length >= (first + local_pixels_remaining + 1) >> 1);
+            if (!(first & 1)) {
+                if (!(local_pixels_remaining & 1)) {
+                    output_4bit_paletted_pixels_ff(output, palette_entries, encoding, local_pixels_remaining);
+                } else {
+                    output_4bit_paletted_pixels_fx(output, palette_entries, encoding, local_pixels_remaining);
+                }
+            } else {
+                if (local_pixels_remaining & 1) {
+                    output_4bit_paletted_pixels_xf(output, palette_entries, encoding, local_pixels_remaining);
+                } else {
+                    output_4bit_paletted_pixels_xx(output, palette_entries, encoding, local_pixels_remaining);
+                }
+            }
+        } else if (cur->type == SPAN_8BIT_RAW) {
+            const uint16_t *palette_entries = cur->raw_8bit.palette->entries;
+            const uint8_t *data = cur->raw_8bit.data + cur->raw_8bit.clip_left;
+            span_assert(cur->raw_8bit.data_length >= cur->raw_8bit.clip_left + local_pixels_remaining);
+            output_8bit_paletted_pixels(output, palette_entries, data, local_pixels_remaining);
+        } else if (cur->type == SPAN_4BIT_VOGON_OVER_RAW) {
+            if (!render_vogon_over_raw(&output, cur, local_pixels_remaining)) {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+        if (cur->cache) {
+            span_cache_store(cur, local_pixels_remaining, span_output, output - span_output);
         }
     }
 
@@ -8,29 +8,19 @@
 #define _RENDER_SPANS_H
 
 #include "image.h"
-
-// ----------------------------------------------------------------------------
-// 4bit1 encoding (vogon) - data is paletted and as such may contain alpha
-//
-// note changing this affects decoder since it is subtracted from length
-#define MIN_COLOR_SPAN_4BIT 5
-#define MIN_RAW_SPAN_4BIT 4
-enum vogon_commands {
-    END_OF_LINE = 0,
-    RAW_PIXELS_SHORT = 0x40,
-    COLOR_PIXELS_SHORT = 0x80,
-    SINGLE_PIXEL = 0xc0,
-    RAW_PIXELS_LONG = 0xd0,
-    COLOR_PIXELS_LONG = 0xd1
-};
+#include "pico/sync.h"
+#include "vogon_commands.h"
 
 enum {
     SPAN_SOLID,
     SPAN_4BIT_VOGON_OPAQUE, // vogon data but using a solid color palette
     SPAN_4BIT_RAW,
-    SPAN_8BIT_RAW
+    SPAN_8BIT_RAW,
+    SPAN_4BIT_VOGON_OVER_RAW // vogon data composited over raw 4 bit data of the same size
 };
 
+struct span_cache;
+
 struct span {
     struct span *next;
     short_flags flags;
@@ -47,7 +37,62 @@ struct span {
             const uint8_t *data;
             uint16_t data_length;
         } vogon, raw_4bit, raw_8bit;
+        struct {
+            // same layout as vogon, with palette being the 256 entries from blend_palette_pair
+            uint16_t clip_left;
+            uint16_t content_width;
+            struct palette16 *palette;
+            const uint8_t *data;
+            uint16_t data_length;
+            uint16_t opaque_fore; // bit n set if fore color n hides the background
+            const uint8_t *back_data;
+        } vogon_over_raw;
     };
+    struct span_cache *cache; // optional; see set_span_cache
+    uint16_t cache_slot;
+};
+
+// ----------------------------------------------------------------------------
+// span cache - keeps the tokens a vogon or raw span rendered to, so static content shown again with the same clipping
+// (e.g. the same image row in the next frame) is just copied. A slot is chosen by the caller (typically the image
+// row), and only hits if the span's data, palette, clipping and displayed width all match what is there, so pointing a
+// span at different data or a different palette, or changing its clipping, needs no explicit invalidation. Changing
+// the entries of a palette in place is noticed through its generation, which reblend_palette and
+// reblend_palette_entries bump (as does the blend palette cache when it reuses a palette); code which writes palette
+// entries directly must bump it too (or call span_cache_flush).
+//
+// The cache may be shared by spans rendered on both cores. Tokens are copied in and out without holding the lock:
+// a slot's sequence is odd while it is being written, and the cache's generation changes whenever the arena is
+// reused, so a fetch which overlapped either just counts as a miss.
+struct span_cache_slot {
+    volatile uint32_t sequence;
+    const uint8_t *data; // NULL if empty
+    const struct palette16 *palette;
+    uint16_t palette_generation;
+    uint16_t clip_left;
+    uint16_t width;
+    uint8_t type;
+    uint16_t halfwords;
+    uint16_t capacity;
+    uint32_t offset; // into the arena
+};
+
+struct span_cache {
+    struct span_cache_slot *slots;
+    uint slot_count;
+    uint16_t *arena;
+    uint arena_size; // in halfwords
+    uint arena_used;
+    volatile uint32_t generation; // bumped by each flush
+    uint storing; // stores copying into the arena outside the lock; the arena isn't reused while there are any
+    critical_section_t lock;
+    struct {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t uncached; // too big for the arena
+        uint32_t flushes; // arena ran out, so everything was dropped
+        uint32_t collisions; // fetches or stores that gave up as the slot was being written at the same time
+    } stats;
 };
 
 extern int32_t render_spans(uint32_t *render_spans_buffer, size_t max_words, struct span *head, int width);
@@ -55,8 +100,29 @@ extern int32_t single_color_scanline(uint32_t *buf, size_t buf_length, int width
 extern void init_solid_color_span(struct span *span, uint16_t width, uint16_t color16, struct span *prev);
 extern void init_vogon_4bit_span(struct span *span, uint16_t width, const uint8_t *encoding, uint16_t encoded_size,
                                  struct palette16 *palette, struct span *prev);
+// data is packed two pixels per byte, low nibble first
+extern void init_raw_4bit_span(struct span *span, uint16_t content_width, const uint8_t *data, uint16_t data_length,
+                               struct palette16 *palette, struct span *prev);
+// data is one palette index per pixel (the palette may have up to 256 entries)
+extern void init_raw_8bit_span(struct span *span, uint16_t content_width, const uint8_t *data, uint16_t data_length,
+                               struct palette16 *palette, struct span *prev);
+// for a vogon image over a solid color, just use init_vogon_4bit_span with a palette from blend_palette
+extern void init_vogon_over_raw_4bit_span(struct span *span, uint16_t content_width, const uint8_t *encoding,
+                                          uint16_t encoded_size, const uint8_t *back_data,
+                                          struct palette16 *pair_palette, struct span *prev);
 extern void set_solid_color_span_color(struct span *span, uint16_t color16);
 extern void set_vogon_4bit_span_encoding(struct span *span, const uint8_t *data, uint16_t data_length);
 extern void set_vogon_4bit_clipping(struct span *span, int clip_left, int display_width);
+extern void set_vogon_over_raw_4bit_span_data(struct span *span, const uint8_t *encoding, uint16_t encoded_size,
+                                              const uint8_t *back_data);
+extern void set_raw_span_data(struct span *span, const uint8_t *data, uint16_t data_length);
+extern void set_raw_span_clipping(struct span *span, int clip_left, int display_width);
+
+extern void span_cache_init(struct span_cache *cache, struct span_cache_slot *slots, uint slot_count, uint16_t *arena,
+                            uint arena_halfwords);
+// needed if palette entries or image data are changed in place
+extern void span_cache_flush(struct span_cache *cache);
+// cache is NULL for none
+extern void set_span_cache(struct span *span, struct span_cache *cache, uint slot);
 
 #endif //CONVERT_SPANS_H
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _RENDER_VOGON_COMMANDS_H
+#define _RENDER_VOGON_COMMANDS_H
+
+// ----------------------------------------------------------------------------
+// 4bit1 encoding (vogon) - data is paletted and as such may contain alpha
+//
+// This header has no dependencies, so host tools (e.g. vogon_encoder) can share it with the renderer
+//
+// note changing this affects decoder since it is subtracted from length
+#define MIN_COLOR_SPAN_4BIT 5
+#define MIN_RAW_SPAN_4BIT 4
+enum vogon_commands {
+    END_OF_LINE = 0,
+    RAW_PIXELS_SHORT = 0x40,
+    COLOR_PIXELS_SHORT = 0x80,
+    SINGLE_PIXEL = 0xc0,
+    RAW_PIXELS_LONG = 0xd0,
+    COLOR_PIXELS_LONG = 0xd1
+};
+
+#endif
@@ -0,0 +1,576 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico.h"
+#include "pico/stdlib.h"
+#include "pico/scanvideo/composable_scanline.h"
+#include "spans.h"
+#include "data.h"
+
+// Checks render_spans() against a straightforward vogon decoder (and raw 4/8 bit and composited spans against their
+// data), then times it. Also checks and times the palette blending.
+//
+// Each case is a solid span, a (possibly clipped) vogon or raw span and another solid span, rendered into a buffer which is
+// then decoded back to pixels from the composable tokens and compared with what the reference decoder says should be
+// there. The vogon rows are the pi400 image from demo1 plus randomly encoded synthetic rows.
+//
+// Note render_spans can't clip a vogon span on both the left and the right at once, so cases which clip on the left
+// always show the rest of the row.
+
+// run every clip_left (and width) for the pi400 rows, or every Nth
+#ifndef RENDER_BENCH_CLIP_STEP
+#define RENDER_BENCH_CLIP_STEP 1
+#endif
+
+#ifndef RENDER_BENCH_SYNTHETIC_ROWS
+#define RENDER_BENCH_SYNTHETIC_ROWS 200
+#endif
+
+// raw and composited rows are checked with every clip_left and width, so are kept narrower
+#ifndef RENDER_BENCH_RAW_ROWS
+#define RENDER_BENCH_RAW_ROWS 40
+#endif
+
+#ifndef RENDER_BENCH_RAW_MAX_WIDTH
+#define RENDER_BENCH_RAW_MAX_WIDTH 100
+#endif
+
+// number of times to render the whole pi400 image for each timing
+#ifndef RENDER_BENCH_TIMING_PASSES
+#define RENDER_BENCH_TIMING_PASSES 50
+#endif
+
+#define MAX_CONTENT_WIDTH 640
+#define MAX_SOLID_WIDTH 5
+#define MAX_ENCODED_SIZE (MAX_CONTENT_WIDTH * 3)
+// worst case is a RAW_1P token per pixel
+#define MAX_WORDS (MAX_CONTENT_WIDTH + 2 * MAX_SOLID_WIDTH + 4)
+#define CANARY 0xdeadbeef
+
+static uint32_t render_buffer[MAX_WORDS + 16];
+
+static struct palette16 *test_palette;
+
+// small, so the checks also run it out of room
+static struct span_cache_slot check_cache_slots[2];
+static uint16_t check_cache_arena[512];
+static struct span_cache check_cache;
+
+static struct {
+    uint32_t cases;
+    uint32_t failures;
+} results;
+
+static uint32_t rand_state = 0x12345678;
+
+static uint32_t next_rand() {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+static int rand_range(int lo, int hi) {
+    return lo + (int) (next_rand() % (uint32_t) (hi - lo + 1));
+}
+
+// reference decoder; returns the number of pixel indices, or -1 if the encoding is bad
+static int decode_vogon_row(const uint8_t *encoding, uint length, uint8_t *indices, int max_pixels) {
+    const uint8_t *end = encoding + length;
+    int n = 0;
+    while (encoding < end) {
+        uint8_t c = *encoding++;
+        int run_length;
+        if (c == END_OF_LINE) {
+            return n;
+        } else if ((c & 0xc0) == RAW_PIXELS_SHORT || c == RAW_PIXELS_LONG) {
+            if (c == RAW_PIXELS_LONG) {
+                run_length = 1 + encoding[0] + (encoding[1] << 8);
+                encoding += 2;
+            } else {
+                run_length = ((c & 0x3f) + 1) * 2;
+            }
+            if ((run_length & 1) || n + run_length > max_pixels || encoding + run_length / 2 > end) return -1;
+            for (int i = 0; i < run_length / 2; i++) {
+                indices[n++] = *encoding & 0xf;
+                indices[n++] = *encoding++ >> 4;
+            }
+        } else if ((c & 0xc0) == COLOR_PIXELS_SHORT || c == COLOR_PIXELS_LONG) {
+            if (c == COLOR_PIXELS_LONG) {
+                run_length = 1 + encoding[0] + (encoding[1] << 8);
+                encoding += 2;
+            } else {
+                run_length = (c & 0x3f) + MIN_COLOR_SPAN_4BIT;
+            }
+            if (n + run_length > max_pixels || encoding >= end) return -1;
+            memset(indices + n, *encoding++ & 0xf, run_length);
+            n += run_length;
+        } else if ((c & 0xf0) == SINGLE_PIXEL) {
+            if (n == max_pixels) return -1;
+            indices[n++] = c & 0xf;
+        } else {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// turns the composable tokens back into pixels; returns the pixel count, or -1 if the stream is bad
+static int decode_tokens(const uint32_t *buf, int32_t words, uint16_t *pixels, int max_pixels, uint *token_count) {
+    const uint16_t *p = (const uint16_t *) buf;
+    const uint16_t *end = p + 2 * words;
+    int n = 0;
+    uint tokens = 0;
+    while (p < end) {
+        uint16_t token = *p++;
+        tokens++;
+        int count;
+        if (token == COMPOSABLE_COLOR_RUN) {
+            if (p + 2 > end) return -1;
+            count = p[1] + 3;
+            if (n + count > max_pixels) return -1;
+            for (int i = 0; i < count; i++) pixels[n++] = p[0];
+            p += 2;
+        } else if (token == COMPOSABLE_RAW_RUN) {
+            if (p + 2 > end) return -1;
+            count = p[1] + 3;
+            if (n + count > max_pixels || p + count + 1 > end) return -1;
+            pixels[n++] = p[0];
+            p += 2;
+            for (int i = 1; i < count; i++) pixels[n++] = *p++;
+        } else if (token == COMPOSABLE_RAW_1P || token == COMPOSABLE_RAW_2P) {
+            count = token == COMPOSABLE_RAW_1P ? 1 : 2;
+            if (n + count > max_pixels || p + count > end) return -1;
+            for (int i = 0; i < count; i++) pixels[n++] = *p++;
+        } else if (token == COMPOSABLE_EOL_ALIGN || token == COMPOSABLE_EOL_SKIP_ALIGN) {
+            if (token == COMPOSABLE_EOL_SKIP_ALIGN) p++;
+            // the line must end exactly at the end of what render_spans said it used
+            if (p != end) return -1;
+            if (token_count) *token_count = tokens;
+            return n;
+        } else {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+static void report_failure(const char *what, const char *source, int row, int clip_left, int width, int total_width) {
+    results.failures++;
+    if (results.failures <= 20) {
+        printf("FAIL %s: %s row %d clip_left %d width %d total width %d\n", what, source, row, clip_left, width,
+               total_width);
+    }
+}
+
+// renders before + middle (showing content pixels clip_left to clip_left + width) + after, truncated to total_width,
+// and checks the result
+static void check_case(const char *source, int row, struct span *middle, const uint16_t *content, int clip_left,
+                       int width, int before_width, int after_width, int total_width) {
+    static struct span before, after;
+    static uint16_t expected[MAX_WORDS * 2];
+    static uint16_t actual[MAX_WORDS * 2];
+    const uint16_t before_color = 0x1234, after_color = 0x4321;
+
+    init_solid_color_span(&before, before_width, before_color, NULL);
+    before.next = middle;
+    init_solid_color_span(&after, after_width, after_color, middle);
+
+    int n = 0;
+    for (int i = 0; i < before_width; i++) expected[n++] = before_color;
+    for (int i = 0; i < width; i++) expected[n++] = content[clip_left + i];
+    for (int i = 0; i < after_width; i++) expected[n++] = after_color;
+    n = total_width;
+    // the line always ends with a black pixel
+    expected[n++] = 0;
+
+    // with a cache, the second render should come from it
+    for (int pass = 0; pass < (middle->cache ? 2 : 1); pass++) {
+        results.cases++;
+        for (uint i = 0; i < count_of(render_buffer); i++) render_buffer[i] = CANARY;
+        int32_t words = render_spans(render_buffer, MAX_WORDS, &before, total_width);
+        if (words <= 0 || words > MAX_WORDS) {
+            report_failure("render_spans failed", source, row, clip_left, width, total_width);
+            return;
+        }
+        for (uint i = words; i < count_of(render_buffer); i++) {
+            if (render_buffer[i] != CANARY) {
+                report_failure("wrote past its return value", source, row, clip_left, width, total_width);
+                return;
+            }
+        }
+        int got = decode_tokens(render_buffer, words, actual, count_of(actual), NULL);
+        if (got < 0) {
+            report_failure("bad token stream", source, row, clip_left, width, total_width);
+        } else if (got != n) {
+            report_failure("wrong pixel count", source, row, clip_left, width, total_width);
+        } else if (memcmp(actual, expected, n * sizeof(uint16_t))) {
+            report_failure("wrong pixels", source, row, clip_left, width, total_width);
+        }
+    }
+}
+
+static void random_solid_widths(int *before_width, int *after_width) {
+    *before_width = rand_range(0, MAX_SOLID_WIDTH);
+    *after_width = rand_range(0, MAX_SOLID_WIDTH);
+}
+
+// every left clip (showing the rest of the row) and every right clip, with random solid spans either side,
+// sometimes cut short by the line width
+static void check_vogon_row(const char *source, int row, const uint8_t *encoding, uint length,
+                            struct palette16 *palette, int content_width, int step) {
+    static uint8_t indices[MAX_CONTENT_WIDTH];
+    static uint16_t content[MAX_CONTENT_WIDTH];
+    static struct span vogon;
+    if (decode_vogon_row(encoding, length, indices, MAX_CONTENT_WIDTH) != content_width) {
+        report_failure("bad reference row", source, row, 0, content_width, 0);
+        return;
+    }
+    for (int i = 0; i < content_width; i++) content[i] = palette->entries[indices[i]];
+    for (int clip = 0; clip < content_width; clip += step) {
+        for (int right = 0; right < 2; right++) {
+            // clip_left is applied either on its own, or (with no clip_left) as a right clip
+            int clip_left = right ? 0 : clip;
+            int width = content_width - clip;
+            if (right && !clip) continue;
+            int before_width, after_width;
+            random_solid_widths(&before_width, &after_width);
+            int total_width = before_width + width + after_width;
+            // cut the line short, but only into the vogon span if it isn't already clipped on the left
+            if (!(next_rand() & 3)) {
+                total_width -= rand_range(0, clip_left ? after_width : after_width + width - 1);
+            }
+            if (total_width <= 0) continue;
+            init_vogon_4bit_span(&vogon, content_width, encoding, length, palette, NULL);
+            set_vogon_4bit_clipping(&vogon, clip_left, width);
+            set_span_cache(&vogon, (next_rand() & 1) ? &check_cache : NULL, row & 1);
+            check_case(source, row, &vogon, content, clip_left, width, before_width, after_width, total_width);
+        }
+    }
+}
+
+// every clip_left with every width for random raw data
+static void check_raw_row(int bits, int row, int content_width) {
+    static uint8_t data[MAX_CONTENT_WIDTH];
+    static uint16_t content[MAX_CONTENT_WIDTH];
+    static struct span raw;
+    const char *source = bits == 4 ? "raw 4 bit" : "raw 8 bit";
+    uint data_length = bits == 4 ? (content_width + 1) / 2 : content_width;
+    for (uint i = 0; i < data_length; i++) data[i] = next_rand();
+    // the data changed in place
+    span_cache_flush(&check_cache);
+    for (int i = 0; i < content_width; i++) {
+        uint index = bits == 4 ? (data[i >> 1] >> ((i & 1) * 4)) & 0xf : data[i];
+        content[i] = test_palette->entries[index];
+    }
+    for (int clip_left = 0; clip_left < content_width; clip_left++) {
+        for (int width = 1; width <= content_width - clip_left; width++) {
+            int before_width, after_width;
+            random_solid_widths(&before_width, &after_width);
+            int total_width = before_width + width + after_width;
+            if (!(next_rand() & 3)) total_width -= rand_range(0, after_width + width - 1);
+            if (bits == 4) {
+                init_raw_4bit_span(&raw, content_width, data, data_length, test_palette, NULL);
+            } else {
+                init_raw_8bit_span(&raw, content_width, data, data_length, test_palette, NULL);
+            }
+            set_raw_span_clipping(&raw, clip_left, width);
+            set_span_cache(&raw, (next_rand() & 1) ? &check_cache : NULL, row & 1);
+            check_case(source, row, &raw, content, clip_left, width, before_width, after_width, total_width);
+        }
+    }
+}
+
+// encodes random pixels using a random mix of the vogon commands
+static uint encode_synthetic_row(uint8_t *encoding, int content_width) {
+    uint8_t *p = encoding;
+    int remaining = content_width;
+    while (remaining) {
+        int kind = rand_range(0, 4);
+        if (kind == 0 || remaining == 1) {
+            *p++ = SINGLE_PIXEL | rand_range(0, 15);
+            remaining--;
+        } else if ((kind == 1 || kind == 2) && remaining >= MIN_COLOR_SPAN_4BIT) {
+            int max = kind == 1 ? MIN(remaining, 0x3f + MIN_COLOR_SPAN_4BIT) : remaining;
+            int run_length = rand_range(MIN_COLOR_SPAN_4BIT, max);
+            if (kind == 1) {
+                *p++ = COLOR_PIXELS_SHORT | (run_length - MIN_COLOR_SPAN_4BIT);
+            } else {
+                *p++ = COLOR_PIXELS_LONG;
+                *p++ = (run_length - 1) & 0xff;
+                *p++ = (run_length - 1) >> 8;
+            }
+            *p++ = rand_range(0, 15);
+            remaining -= run_length;
+        } else {
+            int pairs = rand_range(1, MIN(remaining / 2, kind == 4 ? remaining / 2 : 64));
+            if (kind == 4) {
+                *p++ = RAW_PIXELS_LONG;
+                *p++ = (pairs * 2 - 1) & 0xff;
+                *p++ = (pairs * 2 - 1) >> 8;
+            } else {
+                *p++ = RAW_PIXELS_SHORT | (pairs - 1);
+            }
+            for (int i = 0; i < pairs; i++) *p++ = next_rand();
+            remaining -= pairs * 2;
+        }
+    }
+    *p++ = END_OF_LINE;
+    return p - encoding;
+}
+
+static uint32_t random_color(uint32_t alpha) {
+    return (alpha << 24) | (next_rand() & 0xffffff);
+}
+
+// random foreground (with a mix of opaque, transparent and translucent colors) over random raw data, with every
+// clip_left and width
+static void check_vogon_over_raw_row(int row, int content_width) {
+    static uint8_t encoding[MAX_ENCODED_SIZE];
+    static uint8_t fore[MAX_CONTENT_WIDTH];
+    static uint8_t back_data[MAX_CONTENT_WIDTH / 2];
+    static uint16_t content[MAX_CONTENT_WIDTH];
+    static struct palette32 *fore_palette, *back_palette;
+    static struct span over;
+    if (!fore_palette) {
+        fore_palette = malloc(sizeof(struct palette32) + 16 * sizeof(uint32_t));
+        back_palette = malloc(sizeof(struct palette32) + 16 * sizeof(uint32_t));
+    }
+    fore_palette->size = back_palette->size = 16;
+    for (int i = 0; i < 16; i++) {
+        static const uint32_t alphas[] = {0, 255, 128, 255};
+        fore_palette->entries[i] = random_color(i < 12 ? alphas[i & 3] : next_rand() & 0xff);
+        back_palette->entries[i] = random_color(255);
+    }
+    struct palette16 *pair_palette = blend_palette_pair(fore_palette, back_palette);
+    uint length = encode_synthetic_row(encoding, content_width);
+    for (uint i = 0; i < (content_width + 1) / 2; i++) back_data[i] = next_rand();
+    decode_vogon_row(encoding, length, fore, MAX_CONTENT_WIDTH);
+    for (int i = 0; i < content_width; i++) {
+        uint back_index = (back_data[i >> 1] >> ((i & 1) * 4)) & 0xf;
+        content[i] = pair_palette->entries[(fore[i] << 4) | back_index];
+    }
+    for (int clip_left = 0; clip_left < content_width; clip_left++) {
+        for (int width = 1; width <= content_width - clip_left; width++) {
+            int before_width, after_width;
+            random_solid_widths(&before_width, &after_width);
+            int total_width = before_width + width + after_width;
+            if (!(next_rand() & 3)) total_width -= rand_range(0, after_width + width - 1);
+            init_vogon_over_raw_4bit_span(&over, content_width, encoding, length, back_data, pair_palette, NULL);
+            set_vogon_4bit_clipping(&over, clip_left, width);
+            check_case("vogon over raw", row, &over, content, clip_left, width, before_width, after_width,
+                       total_width);
+        }
+    }
+    free(pair_palette);
+}
+
+static void check_all() {
+    const struct image_data *image = &pi400_image_data;
+    struct palette16 *palette = blend_palette(&pi_palette, 0xffff8000);
+    for (int row = 0; row < image->height; row++) {
+        uint offset = image->row_offsets[row];
+        check_vogon_row("pi400", row, image->blob.bytes + offset, image->row_offsets[row + 1] - offset, palette,
+                  image->width, RENDER_BENCH_CLIP_STEP);
+    }
+    printf("pi400: %d rows, %lu cases, %lu failures\n", image->height, (unsigned long) results.cases,
+           (unsigned long) results.failures);
+
+    static uint8_t encoding[MAX_ENCODED_SIZE];
+    uint32_t cases = results.cases, failures = results.failures;
+    for (int row = 0; row < RENDER_BENCH_SYNTHETIC_ROWS; row++) {
+        int content_width = rand_range(1, MAX_CONTENT_WIDTH);
+        uint length = encode_synthetic_row(encoding, content_width);
+        span_cache_flush(&check_cache);
+        check_vogon_row("synthetic", row, encoding, length, test_palette, content_width, 1);
+    }
+    printf("synthetic: %d rows, %lu cases, %lu failures\n", RENDER_BENCH_SYNTHETIC_ROWS,
+           (unsigned long) (results.cases - cases), (unsigned long) (results.failures - failures));
+
+    for (int bits = 4; bits <= 8; bits += 4) {
+        cases = results.cases;
+        failures = results.failures;
+        for (int row = 0; row < RENDER_BENCH_RAW_ROWS; row++) {
+            check_raw_row(bits, row, rand_range(1, RENDER_BENCH_RAW_MAX_WIDTH));
+        }
+        printf("raw %d bit: %d rows, %lu cases, %lu failures\n", bits, RENDER_BENCH_RAW_ROWS,
+               (unsigned long) (results.cases - cases), (unsigned long) (results.failures - failures));
+    }
+
+    cases = results.cases;
+    failures = results.failures;
+    for (int row = 0; row < RENDER_BENCH_RAW_ROWS; row++) {
+        check_vogon_over_raw_row(row, rand_range(1, RENDER_BENCH_RAW_MAX_WIDTH));
+    }
+    printf("vogon over raw: %d rows, %lu cases, %lu failures\n", RENDER_BENCH_RAW_ROWS,
+           (unsigned long) (results.cases - cases), (unsigned long) (results.failures - failures));
+}
+
+// for timing with the whole pi400 image cached
+#define TIMING_CACHE_SLOTS 400
+#define TIMING_CACHE_ARENA_HALFWORDS 24576
+static struct span_cache_slot timing_cache_slots[TIMING_CACHE_SLOTS];
+static uint16_t timing_cache_arena[TIMING_CACHE_ARENA_HALFWORDS];
+static struct span_cache timing_cache;
+
+static void time_pi400(const char *name, int clip_left, int width, struct span_cache *cache) {
+    const struct image_data *image = &pi400_image_data;
+    static struct palette16 *palette;
+    static struct span vogon;
+    if (!palette) palette = blend_palette(&pi_palette, 0xffff8000);
+    init_vogon_4bit_span(&vogon, image->width, NULL, 0, palette, NULL);
+    set_vogon_4bit_clipping(&vogon, clip_left, width);
+    assert(image->height <= TIMING_CACHE_SLOTS);
+
+    // count the tokens for one pass first (which also fills the cache)
+    uint64_t tokens = 0, words = 0;
+    for (int row = 0; row < image->height; row++) {
+        uint offset = image->row_offsets[row];
+        set_vogon_4bit_span_encoding(&vogon, image->blob.bytes + offset, image->row_offsets[row + 1] - offset);
+        set_span_cache(&vogon, cache, row);
+        int32_t n = render_spans(render_buffer, MAX_WORDS, &vogon, width);
+        uint token_count = 0;
+        static uint16_t pixels[MAX_WORDS * 2];
+        decode_tokens(render_buffer, n, pixels, count_of(pixels), &token_count);
+        tokens += token_count;
+        words += n;
+    }
+
+    absolute_time_t start = get_absolute_time();
+    for (int pass = 0; pass < RENDER_BENCH_TIMING_PASSES; pass++) {
+        for (int row = 0; row < image->height; row++) {
+            uint offset = image->row_offsets[row];
+            set_vogon_4bit_span_encoding(&vogon, image->blob.bytes + offset, image->row_offsets[row + 1] - offset);
+            set_span_cache(&vogon, cache, row);
+            render_spans(render_buffer, MAX_WORDS, &vogon, width);
+        }
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    if (us <= 0) us = 1;
+    uint64_t lines = (uint64_t) RENDER_BENCH_TIMING_PASSES * image->height;
+    printf("%-12s %5.2f us/line, %6.1f Mpixels/s, %6.1f Mtokens/s (%.1f tokens, %.1f words per line)\n", name,
+           us / (double) lines, lines * width / (double) us, tokens * RENDER_BENCH_TIMING_PASSES / (double) us,
+           tokens / (double) image->height, words / (double) image->height);
+}
+
+// the generations are expected to differ
+static bool palettes_equal(const struct palette16 *a, const struct palette16 *b) {
+    return a->size == b->size && a->flags == b->flags && a->composited_on_color == b->composited_on_color &&
+           !memcmp(a->entries, b->entries, a->size * sizeof(uint16_t));
+}
+
+// a row cached with a palette which is then re-blended in place must render with the new colors
+static void check_cached_reblend(struct palette16 *palette, uint32_t back_color, int row) {
+    static uint32_t cached[MAX_WORDS];
+    const struct image_data *image = &pi400_image_data;
+    row %= image->height;
+    uint offset = image->row_offsets[row];
+    static struct span vogon;
+    init_vogon_4bit_span(&vogon, image->width, image->blob.bytes + offset, image->row_offsets[row + 1] - offset,
+                         palette, NULL);
+    span_cache_flush(&check_cache);
+    set_span_cache(&vogon, &check_cache, 0);
+    render_spans(render_buffer, MAX_WORDS, &vogon, image->width);
+    reblend_palette(palette, &pi_palette, back_color ^ 0x00ffffff);
+    int32_t n = render_spans(cached, MAX_WORDS, &vogon, image->width);
+    set_span_cache(&vogon, NULL, 0);
+    results.cases++;
+    if (n != render_spans(render_buffer, MAX_WORDS, &vogon, image->width) || memcmp(cached, render_buffer, n * 4)) {
+        report_failure("cached row not re-blended", "pi400", row, 0, image->width, 0);
+    }
+    // put back what check_blends expects
+    reblend_palette(palette, &pi_palette, back_color);
+}
+
+// the cached and incremental blends must give the same palettes as blend_palette
+static void check_blends() {
+    static struct blend_palette_cache cache;
+    blend_palette_cache_init(&cache, 4, 16);
+    struct palette16 *incremental = blend_palette(&pi_palette, 0xff000000);
+    uint32_t cases = results.cases, failures = results.failures;
+    for (int i = 0; i < 1000; i++) {
+        // a few back colors, so some are hits
+        uint32_t back_color = random_color(255) & 0xff0000ff;
+        if (i & 1) back_color = 0xff000000 | (i & 0x70);
+        struct palette16 *expected = blend_palette(&pi_palette, back_color);
+        struct palette16 *cached = blend_palette_cached(&cache, &pi_palette, back_color);
+        reblend_palette(incremental, &pi_palette, back_color);
+        uint first = rand_range(0, 15), count = rand_range(0, 16 - first);
+        reblend_palette_entries(incremental, &pi_palette, first, count);
+        if (!(i % 10)) check_cached_reblend(incremental, back_color, i);
+        results.cases += 2;
+        if (!palettes_equal(cached, expected)) report_failure("cached blend differs", "pi_palette", i, 0, 0, 0);
+        if (!palettes_equal(incremental, expected)) report_failure("re-blend differs", "pi_palette", i, 0, 0, 0);
+        free(expected);
+    }
+    free(incremental);
+    printf("blends: %lu cases, %lu failures (cache %lu hits, %lu misses)\n", (unsigned long) (results.cases - cases),
+           (unsigned long) (results.failures - failures), (unsigned long) cache.stats.hits,
+           (unsigned long) cache.stats.misses);
+}
+
+static void time_blends() {
+    const int count = RENDER_BENCH_TIMING_PASSES * 100;
+    static struct blend_palette_cache cache;
+    blend_palette_cache_init(&cache, 8, 16);
+    struct palette16 *palette = blend_palette(&pi_palette, 0xff000000);
+    for (int kind = 0; kind < 4; kind++) {
+        static const char *names[] = {"blend_palette", "reblend", "cache hit", "cache miss"};
+        absolute_time_t start = get_absolute_time();
+        for (int i = 0; i < count; i++) {
+            uint32_t back_color = 0xff000000 | i;
+            if (kind == 0) {
+                free(blend_palette(&pi_palette, back_color));
+            } else if (kind == 1) {
+                reblend_palette(palette, &pi_palette, back_color);
+            } else {
+                // cycling through 8 colors always hits, through 9 always misses
+                blend_palette_cached(&cache, &pi_palette, 0xff000000 | (i % (kind == 2 ? 8 : 9)));
+            }
+        }
+        int64_t us = absolute_time_diff_us(start, get_absolute_time());
+        if (us <= 0) us = 1;
+        printf("%-14s %8.0f blends/s (16 colors)\n", names[kind], count * 1e6 / (double) us);
+    }
+    free(palette);
+}
+
+int main() {
+    stdio_init_all();
+
+    test_palette = malloc(sizeof(struct palette16) + 256 * sizeof(uint16_t));
+    test_palette->size = 256;
+    test_palette->flags = CF_HAS_OPAQUE;
+    // distinct, non black colors so any mix up shows
+    for (int i = 0; i < 256; i++) test_palette->entries[i] = 0x0100 + i * 0x0107;
+
+    span_cache_init(&check_cache, check_cache_slots, count_of(check_cache_slots), check_cache_arena,
+                    count_of(check_cache_arena));
+    check_all();
+    printf("span cache: %lu hits, %lu misses, %lu uncached, %lu flushes\n",
+           (unsigned long) check_cache.stats.hits, (unsigned long) check_cache.stats.misses,
+           (unsigned long) check_cache.stats.uncached, (unsigned long) check_cache.stats.flushes);
+    check_blends();
+    if (results.failures) {
+        printf("%lu of %lu cases FAILED\n", (unsigned long) results.failures, (unsigned long) results.cases);
+    } else {
+        printf("all %lu cases passed\n", (unsigned long) results.cases);
+    }
+
+    int w = pi400_image_data.width;
+    time_pi400("unclipped", 0, w, NULL);
+    time_pi400("clip left", w / 3, w - w / 3, NULL);
+    time_pi400("clip right", 0, w - w / 3, NULL);
+    span_cache_init(&timing_cache, timing_cache_slots, count_of(timing_cache_slots), timing_cache_arena,
+                    count_of(timing_cache_arena));
+    time_pi400("cached", 0, w, &timing_cache);
+    time_blends();
+    return results.failures ? 1 : 0;
+}
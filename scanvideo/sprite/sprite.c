@@ -4,11 +4,16 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "sprite.h"
 #include "affine_transform.h"
 
 #include "pico/platform.h" // for __not_in_flash
+#if SPRITE_AFFINE
 #include "hardware/interp.h"
+#endif
 
 // Note some of the sprite routines are quite large (unrolled), so trying to
 // keep everything in separate sections so the linker can garbage collect
@@ -25,16 +30,30 @@ typedef struct {
 static inline intersect_t _get_sprite_intersect(const sprite_t *sp, uint raster_y, uint raster_w) {
     intersect_t isct = {0};
     isct.tex_offs_y = (int) raster_y - sp->y;
-    int size = 1u << sp->log_size;
-    uint upper_mask = -size;
-    if ((uint) isct.tex_offs_y & upper_mask)
-        return isct;
+    int size;
+    if (!sp->width) {
+        // Square power-of-2 sprite, so one mask checks both ends of the row range
+        size = 1u << sp->log_size;
+        uint upper_mask = -size;
+        if ((uint) isct.tex_offs_y & upper_mask)
+            return isct;
+    } else {
+        size = sp->width;
+        if ((uint) isct.tex_offs_y >= sp->height)
+            return isct;
+    }
     int x_start_clipped = MAX(0, sp->x);
     isct.tex_offs_x = x_start_clipped - sp->x;
     isct.size_x = MIN(sp->x + size, (int) raster_w) - x_start_clipped;
     return isct;
 }
 
+// Metadata starts at the first word boundary after the pixel data
+static inline const uint32_t *_get_sprite_metadata(const sprite_t *sp, uint stride, uint bytes_per_pixel) {
+    uint pixel_bytes = sp->width ? stride * sp->height * bytes_per_pixel : stride * stride * bytes_per_pixel;
+    return (const uint32_t *) (sp->img + ((pixel_bytes + 3) & ~3u));
+}
+
 // Sprites may have an array of metadata on the end. One word per line, encodes first opaque pixel, last opaque pixel, and whether the span in between is solid. This allows fewer 
 static inline intersect_t _intersect_with_metadata(intersect_t isct, uint32_t meta) {
     int span_end = meta & 0xffff;
@@ -47,14 +66,14 @@ static inline intersect_t _intersect_with_metadata(intersect_t isct, uint32_t me
 }
 
 void __ram_func(sprite_sprite8)(uint8_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w) {
-    int size = 1u << sp->log_size;
+    int size = sprite_width(sp);
     intersect_t isct = _get_sprite_intersect(sp, raster_y, raster_w);
     if (isct.size_x <= 0)
         return;
     const uint8_t *img = sp->img;
     if (sp->has_opacity_metadata) {
         // Metadata is one word per row, concatenated to end of pixel data
-        uint32_t meta = ((uint32_t *) (sp->img + size * size * sizeof(uint8_t)))[isct.tex_offs_y];
+        uint32_t meta = _get_sprite_metadata(sp, size, sizeof(uint8_t))[isct.tex_offs_y];
         isct = _intersect_with_metadata(isct, meta);
         if (isct.size_x <= 0)
             return;
@@ -74,13 +93,13 @@ void __ram_func(sprite_sprite8)(uint8_t *scanbuf, const sprite_t *sp, uint raste
 }
 
 void __ram_func(sprite_sprite16)(uint16_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w) {
-    int size = 1u << sp->log_size;
+    int size = sprite_width(sp);
     intersect_t isct = _get_sprite_intersect(sp, raster_y, raster_w);
     if (isct.size_x <= 0)
         return;
     const uint16_t *img = sp->img;
     if (sp->has_opacity_metadata) {
-        uint32_t meta = ((uint32_t *) (sp->img + size * size * sizeof(uint16_t)))[isct.tex_offs_y];
+        uint32_t meta = _get_sprite_metadata(sp, size, sizeof(uint16_t))[isct.tex_offs_y];
         isct = _intersect_with_metadata(isct, meta);
         if (isct.size_x <= 0)
             return;
@@ -96,6 +115,7 @@ void __ram_func(sprite_sprite16)(uint16_t *scanbuf, const sprite_t *sp, uint ras
     }
 }
 
+#if SPRITE_AFFINE
 // We're defining the affine transform as:
 //
 // [u]   [ a00 a01 b0 ]   [x]   [a00 * x + a01 * y + b0]
@@ -134,18 +154,25 @@ static inline __attribute__((always_inline)) void _setup_interp_pix_coordgen(int
     // yields these bits, added to sp->img, and this will also trigger BASE0 and
     // BASE1 to be directly added (thanks to CTRL_ADD_RAW) to the accumulators,
     // which generates the u,v coordinate for the *next* read.
-    assert(sp->log_size + pixel_shift <= 16);
+    uint log_w = sp->log_size;
+    uint log_h = sp->log_size;
+    if (sp->width) {
+        assert(!(sp->width & (sp->width - 1)) && !(sp->height & (sp->height - 1)));
+        log_w = __builtin_ctz(sp->width);
+        log_h = __builtin_ctz(sp->height);
+    }
+    assert(log_w + pixel_shift <= 16 && log_h + pixel_shift <= 16);
 
     interp_config c0 = interp_default_config();
     interp_config_set_add_raw(&c0, true);
     interp_config_set_shift(&c0, 16 - pixel_shift);
-    interp_config_set_mask(&c0, pixel_shift, pixel_shift + sp->log_size - 1);
+    interp_config_set_mask(&c0, pixel_shift, pixel_shift + log_w - 1);
     interp_set_config(interp, 0, &c0);
 
     interp_config c1 = interp_default_config();
     interp_config_set_add_raw(&c1, true);
-    interp_config_set_shift(&c1, 16 - sp->log_size - pixel_shift);
-    interp_config_set_mask(&c1, pixel_shift + sp->log_size, pixel_shift + 2 * sp->log_size - 1);
+    interp_config_set_shift(&c1, 16 - log_w - pixel_shift);
+    interp_config_set_mask(&c1, pixel_shift + log_w, pixel_shift + log_w + log_h - 1);
     interp_set_config(interp, 1, &c1);
 
     interp->base[2] = (uint32_t) sp->img;
@@ -174,3 +201,261 @@ void __ram_func(sprite_asprite16)(uint16_t *scanbuf, const sprite_t *sp, const a
     _setup_interp_pix_coordgen(interp, sp, 1);
     sprite_ablit16_alpha_loop(scanbuf + MAX(0, sp->x), isct.size_x);
 }
+#endif
+
+// ----------------------------------------------------------------------------
+// Sprite lists
+
+static inline bool _sprite_on_raster(const sprite_t *sp, uint raster_w, uint raster_h) {
+    return sp->y < (int) raster_h && sp->y + (int) sprite_height(sp) > 0 &&
+           sp->x < (int) raster_w && sp->x + (int) sprite_width(sp) > 0;
+}
+
+void sprite_list_init(sprite_list_t *list, const sprite_t *sprites, uint count, uint raster_h) {
+    assert(count <= 0xffff && raster_h > 0 && raster_h <= 0xffff);
+    list->sprites = sprites;
+    list->count = count;
+    list->raster_h = raster_h;
+    list->visible = 0;
+    list->order = (uint16_t *) malloc(count * sizeof(uint16_t));
+    list->row_end = (uint16_t *) calloc(raster_h, sizeof(uint16_t));
+    if (!list->order || !list->row_end)
+        panic("out of memory for sprite list");
+    list->generation = 0;
+}
+
+void __ram_func(sprite_list_update)(sprite_list_t *list, uint raster_w) {
+    uint16_t *row_end = list->row_end;
+    memset(row_end, 0, list->raster_h * sizeof(uint16_t));
+    // Counting sort on first visible row; sprites wholly off the raster are dropped
+    for (uint i = 0; i < list->count; i++) {
+        const sprite_t *sp = &list->sprites[i];
+        if (!_sprite_on_raster(sp, raster_w, list->raster_h))
+            continue;
+        row_end[MAX(0, sp->y)]++;
+    }
+    uint total = 0;
+    for (uint y = 0; y < list->raster_h; y++) {
+        uint n = row_end[y];
+        row_end[y] = total;
+        total += n;
+    }
+    // Placing in index order leaves row_end[y] pointing just past the entries for row y
+    for (uint i = 0; i < list->count; i++) {
+        const sprite_t *sp = &list->sprites[i];
+        if (!_sprite_on_raster(sp, raster_w, list->raster_h))
+            continue;
+        list->order[row_end[MAX(0, sp->y)]++] = i;
+    }
+    list->visible = total;
+    list->generation++;
+}
+
+void sprite_list_cursor_init(sprite_list_cursor_t *cursor, const sprite_list_t *list) {
+    cursor->active = (uint16_t *) malloc(MAX(1, list->count) * sizeof(uint16_t));
+    if (!cursor->active)
+        panic("out of memory for sprite list cursor");
+    cursor->active_count = 0;
+    cursor->next = 0;
+    cursor->raster_y = -1;
+    cursor->generation = list->generation;
+}
+
+uint __ram_func(sprite_list_advance)(sprite_list_cursor_t *cursor, const sprite_list_t *list, uint raster_y) {
+    if (raster_y >= list->raster_h)
+        return 0;
+    if ((int) raster_y < cursor->raster_y || cursor->generation != list->generation) {
+        cursor->active_count = 0;
+        cursor->next = 0;
+        cursor->generation = list->generation;
+    }
+    cursor->raster_y = raster_y;
+    const sprite_t *sprites = list->sprites;
+    uint16_t *active = cursor->active;
+    // Retire sprites which ended above this row (rows may be skipped when cores share the scanlines)
+    uint n = 0;
+    for (uint i = 0; i < cursor->active_count; i++) {
+        const sprite_t *sp = &sprites[active[i]];
+        if (sp->y + (int) sprite_height(sp) > (int) raster_y)
+            active[n++] = active[i];
+    }
+    // Activate sprites starting on or above this row, keeping the active list in draw order
+    uint end = list->row_end[raster_y];
+    while (cursor->next < end) {
+        uint16_t index = list->order[cursor->next++];
+        const sprite_t *sp = &sprites[index];
+        if (sp->y + (int) sprite_height(sp) <= (int) raster_y)
+            continue;
+        uint j = n++;
+        while (j > 0 && active[j - 1] > index) {
+            active[j] = active[j - 1];
+            j--;
+        }
+        active[j] = index;
+    }
+    cursor->active_count = n;
+    return n;
+}
+
+void __ram_func(sprite_list_sprite8)(uint8_t *scanbuf, const sprite_list_t *list, sprite_list_cursor_t *cursor,
+                                     uint raster_y, uint raster_w) {
+    uint n = sprite_list_advance(cursor, list, raster_y);
+    for (uint i = 0; i < n; i++)
+        sprite_sprite8(scanbuf, &list->sprites[cursor->active[i]], raster_y, raster_w);
+}
+
+void __ram_func(sprite_list_sprite16)(uint16_t *scanbuf, const sprite_list_t *list, sprite_list_cursor_t *cursor,
+                                      uint raster_y, uint raster_w) {
+    uint n = sprite_list_advance(cursor, list, raster_y);
+    for (uint i = 0; i < n; i++)
+        sprite_sprite16(scanbuf, &list->sprites[cursor->active[i]], raster_y, raster_w);
+}
+
+// ----------------------------------------------------------------------------
+// Occlusion culled rendering
+
+void sprite_coverage_init(sprite_coverage_t *cov, uint max_covered, uint max_pieces) {
+    assert(max_covered > 0 && max_covered <= 0xffff && max_pieces > 0 && max_pieces <= 0xffff);
+    cov->covered = (struct sprite_coverage_interval *) malloc(max_covered * sizeof(struct sprite_coverage_interval));
+    cov->pieces = (struct sprite_coverage_piece *) malloc(max_pieces * sizeof(struct sprite_coverage_piece));
+    if (!cov->covered || !cov->pieces)
+        panic("out of memory for sprite coverage");
+    cov->covered_count = 0;
+    cov->max_covered = max_covered;
+    cov->piece_count = 0;
+    cov->max_pieces = max_pieces;
+    memset(&cov->stats, 0, sizeof(cov->stats));
+}
+
+// Raster range [start, end) a sprite writes on raster_y, trimmed to its opaque pixels if it has metadata.
+// solid is set if every pixel in the range is opaque.
+static inline intersect_t _get_sprite_run16(const sprite_t *sp, uint raster_y, uint raster_w, bool *solid) {
+    intersect_t isct = _get_sprite_intersect(sp, raster_y, raster_w);
+    *solid = false;
+    if (isct.size_x > 0 && sp->has_opacity_metadata) {
+        uint32_t meta = _get_sprite_metadata(sp, sprite_width(sp), sizeof(uint16_t))[isct.tex_offs_y];
+        isct = _intersect_with_metadata(isct, meta);
+        *solid = !!(meta & (1u << 31));
+    }
+    return isct;
+}
+
+static inline void _coverage_add(sprite_coverage_t *cov, int start, int end) {
+    struct sprite_coverage_interval *covered = cov->covered;
+    uint n = cov->covered_count;
+    uint i = 0;
+    while (i < n && covered[i].end < start)
+        i++;
+    // Merge with every interval overlapping or touching [start, end)
+    uint j = i;
+    while (j < n && covered[j].start <= end) {
+        start = MIN(start, covered[j].start);
+        end = MAX(end, covered[j].end);
+        j++;
+    }
+    if (j == i) {
+        // If we are out of room, this range just doesn't get culled
+        if (n == cov->max_covered) {
+            cov->stats.full++;
+            return;
+        }
+        memmove(covered + i + 1, covered + i, (n - i) * sizeof(covered[0]));
+        n++;
+    } else if (j > i + 1) {
+        memmove(covered + i + 1, covered + j, (n - j) * sizeof(covered[0]));
+        n -= j - i - 1;
+    }
+    covered[i].start = start;
+    covered[i].end = end;
+    cov->covered_count = n;
+}
+
+// Add the uncovered parts of [start, end) to the piece list, returning false if they don't fit
+static inline bool _coverage_clip(sprite_coverage_t *cov, const sprite_t *sp, int start, int end, bool solid) {
+    const struct sprite_coverage_interval *covered = cov->covered;
+    uint n = cov->covered_count;
+    uint i = 0;
+    while (i < n && covered[i].end <= start)
+        i++;
+    int x = start;
+    for (; i < n && covered[i].start < end; i++) {
+        if (covered[i].start > x) {
+            if (cov->piece_count == cov->max_pieces)
+                return false;
+            cov->pieces[cov->piece_count++] = (struct sprite_coverage_piece) {sp, x, covered[i].start, solid};
+        }
+        x = MAX(x, covered[i].end);
+    }
+    if (x < end) {
+        if (cov->piece_count == cov->max_pieces)
+            return false;
+        cov->pieces[cov->piece_count++] = (struct sprite_coverage_piece) {sp, x, end, solid};
+    }
+    return true;
+}
+
+void __ram_func(sprite_sprites16_culled)(uint16_t *scanbuf, uint16_t bgcol, sprite_coverage_t *cov,
+                                         const sprite_t *sprites, const uint16_t *indices, uint count, uint raster_y,
+                                         uint raster_w) {
+    cov->covered_count = 0;
+    cov->piece_count = 0;
+    uint32_t plain_written = raster_w;
+    bool overflow = false;
+    // Front to back: clip each sprite against the solid runs in front of it
+    for (int i = (int) count - 1; i >= 0; i--) {
+        const sprite_t *sp = &sprites[indices ? indices[i] : i];
+        bool solid;
+        intersect_t isct = _get_sprite_run16(sp, raster_y, raster_w, &solid);
+        if (isct.size_x <= 0)
+            continue;
+        plain_written += isct.size_x;
+        int start = sp->x + isct.tex_offs_x;
+        int end = start + isct.size_x;
+        if (!overflow && !_coverage_clip(cov, sp, start, end, solid))
+            overflow = true;
+        if (solid)
+            _coverage_add(cov, start, end);
+    }
+    if (overflow) {
+        cov->stats.overflows++;
+        cov->stats.written += plain_written;
+        sprite_fill16(scanbuf, bgcol, raster_w);
+        for (uint i = 0; i < count; i++)
+            sprite_sprite16(scanbuf, &sprites[indices ? indices[i] : i], raster_y, raster_w);
+        return;
+    }
+    // Back to front: background where nothing solid landed, then the surviving pieces
+    uint32_t written = 0;
+    int x = 0;
+    for (uint i = 0; i < cov->covered_count; i++) {
+        if (cov->covered[i].start > x)
+            sprite_fill16(scanbuf + x, bgcol, cov->covered[i].start - x);
+        written += cov->covered[i].start - x;
+        x = cov->covered[i].end;
+    }
+    if (x < (int) raster_w) {
+        sprite_fill16(scanbuf + x, bgcol, raster_w - x);
+        written += raster_w - x;
+    }
+    for (int i = (int) cov->piece_count - 1; i >= 0; i--) {
+        const struct sprite_coverage_piece *piece = &cov->pieces[i];
+        const sprite_t *sp = piece->sp;
+        const uint16_t *src = (const uint16_t *) sp->img + ((int) raster_y - sp->y) * (int) sprite_width(sp) +
+                              (piece->start - sp->x);
+        uint len = piece->end - piece->start;
+        if (piece->solid)
+            sprite_blit16(scanbuf + piece->start, src, len);
+        else
+            sprite_blit16_alpha(scanbuf + piece->start, src, len);
+        written += len;
+    }
+    cov->stats.written += written;
+    cov->stats.culled += plain_written - written;
+}
+
+void __ram_func(sprite_list_sprite16_culled)(uint16_t *scanbuf, uint16_t bgcol, sprite_coverage_t *cov,
+                                             const sprite_list_t *list, sprite_list_cursor_t *cursor, uint raster_y,
+                                             uint raster_w) {
+    uint n = sprite_list_advance(cursor, list, raster_y);
+    sprite_sprites16_culled(scanbuf, bgcol, cov, list->sprites, cursor->active, n, raster_y, raster_w);
+}
@@ -10,16 +10,38 @@
 #include "pico.h"
 #include "affine_transform.h"
 
+// The affine sprite functions need the SIO interpolators, so are only available on device
+#ifndef SPRITE_AFFINE
+#define SPRITE_AFFINE PICO_ON_DEVICE
+#endif
+
+// Sprite images are stored row by row with no padding. If width and height are both 0 the sprite is a square of side
+// 1 << log_size (the fast path); otherwise it is width x height pixels, and log_size is unused. Affine sprites must
+// have power of 2 dimensions, though they need not be square.
+//
+// Sprites may have opacity metadata after the pixel data, starting at the next word boundary: one word per row,
+// with the first opaque pixel in bits 30:16, one past the last opaque pixel in bits 15:0, and bit 31 set if every
+// pixel in between is opaque.
 typedef struct sprite {
     int16_t x;
     int16_t y;
     const void *img;
-    uint8_t log_size; // always square
+    uint8_t log_size;
     bool has_opacity_metadata;
+    uint16_t width;
+    uint16_t height;
 } sprite_t;
 
+static inline uint sprite_width(const sprite_t *sp) {
+    return sp->width ? sp->width : 1u << sp->log_size;
+}
+
+static inline uint sprite_height(const sprite_t *sp) {
+    return sp->width ? sp->height : 1u << sp->log_size;
+}
+
 // ----------------------------------------------------------------------------
-// Functions from sprite.S
+// Functions from sprite.S (or sprite_kernels.c, which has C versions of the same kernels for other platforms)
 
 // Constant-colour span
 void sprite_fill8(uint8_t *dst, uint8_t colour, uint len);
@@ -31,11 +53,13 @@ void sprite_blit8_alpha(uint8_t *dst, const uint8_t *src, uint len);
 void sprite_blit16(uint16_t *dst, const uint16_t *src, uint len);
 void sprite_blit16_alpha(uint16_t *dst, const uint16_t *src, uint len);
 
+#if SPRITE_AFFINE
 // These are just inner loops, and require INTERP0 to be configured before calling:
 void sprite_ablit8_loop(uint8_t *dst, uint len);
 void sprite_ablit8_alpha_loop(uint8_t *dst, uint len);
 void sprite_ablit16_loop(uint16_t *dst, uint len);
 void sprite_ablit16_alpha_loop(uint16_t *dst, uint len);
+#endif
 
 // ----------------------------------------------------------------------------
 // Functions from sprite.c
@@ -44,10 +68,91 @@ void sprite_ablit16_alpha_loop(uint16_t *dst, uint len);
 void sprite_sprite8(uint8_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w);
 void sprite_sprite16(uint16_t *scanbuf, const sprite_t *sp, uint raster_y, uint raster_w);
 
+#if SPRITE_AFFINE
 // As above, but apply an affine transform on sprite texture lookups (SLOW, even with interpolator)
 void sprite_asprite8(uint8_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y,
                      uint raster_w);
 void sprite_asprite16(uint16_t *scanbuf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y,
                       uint raster_w);
+#endif
+
+// ----------------------------------------------------------------------------
+// Sprite lists
+
+// A sprite list buckets its sprites by their first visible row once per frame, so that walking the scanlines only
+// ever looks at the sprites on the current line, rather than rejecting every sprite on every line.
+typedef struct sprite_list {
+    const sprite_t *sprites;
+    uint16_t count;
+    uint16_t raster_h;
+    uint16_t visible;     // number of sprites intersecting the raster as of the last update
+    uint16_t *order;      // indices of the visible sprites, sorted by first visible row (then by index)
+    uint16_t *row_end;    // row_end[y] is the number of entries in order whose first visible row is <= y
+    uint32_t generation;  // incremented by every update
+} sprite_list_t;
+
+// Active sprite state for walking down the scanlines of a frame; each rendering core needs its own
+typedef struct sprite_list_cursor {
+    uint16_t *active;     // indices of the sprites intersecting the current row, in draw (index) order
+    uint16_t active_count;
+    uint16_t next;        // next entry in list->order to activate
+    int raster_y;
+    uint32_t generation;
+} sprite_list_cursor_t;
+
+void sprite_list_init(sprite_list_t *list, const sprite_t *sprites, uint count, uint raster_h);
+// Re-bucket the sprites; call once per frame after moving them
+void sprite_list_update(sprite_list_t *list, uint raster_w);
+
+void sprite_list_cursor_init(sprite_list_cursor_t *cursor, const sprite_list_t *list);
+// Update the active sprites for raster_y, returning how many there are. raster_y must increase within a frame; going
+// backwards (or a sprite_list_update) restarts the walk from the top.
+uint sprite_list_advance(sprite_list_cursor_t *cursor, const sprite_list_t *list, uint raster_y);
+
+// Render all the sprites intersecting raster_y, in index order
+void sprite_list_sprite8(uint8_t *scanbuf, const sprite_list_t *list, sprite_list_cursor_t *cursor, uint raster_y,
+                         uint raster_w);
+void sprite_list_sprite16(uint16_t *scanbuf, const sprite_list_t *list, sprite_list_cursor_t *cursor, uint raster_y,
+                          uint raster_w);
+
+// ----------------------------------------------------------------------------
+// Occlusion culled rendering
+
+// Renders a scanline's sprites front to back, building a list of the raster ranges already covered by solid runs
+// (from opacity metadata) of the sprites in front, and only keeping the parts of each sprite that are not covered.
+// The surviving pieces and the uncovered background are then drawn back to front, so non-solid sprites still blend
+// correctly. Each rendering core needs its own sprite_coverage_t.
+typedef struct sprite_coverage {
+    struct sprite_coverage_interval {
+        int16_t start;
+        int16_t end;
+    } *covered;           // sorted, disjoint and non adjacent
+    struct sprite_coverage_piece {
+        const sprite_t *sp;
+        int16_t start;
+        int16_t end;
+        bool solid;
+    } *pieces;
+    uint16_t covered_count;
+    uint16_t max_covered;
+    uint16_t piece_count;
+    uint16_t max_pieces;
+    struct {
+        uint32_t written;     // pixels written, including the background
+        uint32_t culled;      // pixels a plain back to front render would also have written
+        uint32_t overflows;   // lines rendered without culling because there were more than max_pieces pieces
+        uint32_t full;        // opaque ranges not used for culling because there were already max_covered intervals
+    } stats;
+} sprite_coverage_t;
+
+void sprite_coverage_init(sprite_coverage_t *cov, uint max_covered, uint max_pieces);
+
+// Fill the background with bgcol and render sprites (later sprites in front). If indices is not NULL, the sprites
+// drawn are sprites[indices[0..count-1]], otherwise sprites[0..count-1].
+void sprite_sprites16_culled(uint16_t *scanbuf, uint16_t bgcol, sprite_coverage_t *cov, const sprite_t *sprites,
+                             const uint16_t *indices, uint count, uint raster_y, uint raster_w);
+void sprite_list_sprite16_culled(uint16_t *scanbuf, uint16_t bgcol, sprite_coverage_t *cov,
+                                 const sprite_list_t *list, sprite_list_cursor_t *cursor, uint raster_y,
+                                 uint raster_w);
 
 #endif
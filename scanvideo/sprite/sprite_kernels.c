@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// C versions of the kernels in sprite.S, for platforms other than Arm (RISC-V, host) or for comparison with the
+// assembly. They have the same semantics, including the pixel order of the affine loops.
+
+#include "sprite.h"
+
+#include "pico/platform.h" // for __not_in_flash
+#if SPRITE_AFFINE
+#include "hardware/interp.h"
+#endif
+
+#define __ram_func(foo) __not_in_flash_func(foo)
+
+// RAGB2132 and RGAB5515 both have alpha in bit 5
+#define ALPHA_MASK_8BPP (1u << 5)
+#define ALPHA_MASK_16BPP (1u << 5)
+
+// ----------------------------------------------------------------------------
+// Colour fill
+
+void __ram_func(sprite_fill8)(uint8_t *dst, uint8_t colour, uint len) {
+    for (uint i = 0; i < len; i++)
+        dst[i] = colour;
+}
+
+void __ram_func(sprite_fill16)(uint16_t *dst, uint16_t colour, uint len) {
+    if (len && ((uintptr_t) dst & 2)) {
+        *dst++ = colour;
+        len--;
+    }
+    // Word stores for the bulk of the fill
+    uint32_t colour2 = colour | ((uint32_t) colour << 16);
+    uint32_t *dst2 = (uint32_t *) dst;
+    for (uint i = 0; i < len / 2; i++)
+        dst2[i] = colour2;
+    if (len & 1)
+        dst[len - 1] = colour;
+}
+
+// ----------------------------------------------------------------------------
+// Non-AT sprite
+
+void __ram_func(sprite_blit8)(uint8_t *dst, const uint8_t *src, uint len) {
+    for (uint i = 0; i < len; i++)
+        dst[i] = src[i];
+}
+
+void __ram_func(sprite_blit8_alpha)(uint8_t *dst, const uint8_t *src, uint len) {
+    for (uint i = 0; i < len; i++) {
+        uint8_t p = src[i];
+        if (p & ALPHA_MASK_8BPP)
+            dst[i] = p;
+    }
+}
+
+void __ram_func(sprite_blit16)(uint16_t *dst, const uint16_t *src, uint len) {
+    for (uint i = 0; i < len; i++)
+        dst[i] = src[i];
+}
+
+void __ram_func(sprite_blit16_alpha)(uint16_t *dst, const uint16_t *src, uint len) {
+    for (uint i = 0; i < len; i++) {
+        uint16_t p = src[i];
+        if (p & ALPHA_MASK_16BPP)
+            dst[i] = p;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Affine-transformed sprite (INTERP0 must be configured by the caller)
+
+#if SPRITE_AFFINE
+// As in sprite.S, we walk backward along the span; CTRL is read before POP_FULL, so the overflow flag is for the
+// texture coordinate being popped.
+void __ram_func(sprite_ablit8_loop)(uint8_t *dst, uint len) {
+    interp_hw_t *interp = interp0;
+    while (len--) {
+        uint32_t ctrl = interp->ctrl[0];
+        const uint8_t *src = (const uint8_t *) interp->pop[2];
+        if (!(ctrl & SIO_INTERP0_CTRL_LANE0_OVERF_BITS))
+            dst[len] = *src;
+    }
+}
+
+void __ram_func(sprite_ablit8_alpha_loop)(uint8_t *dst, uint len) {
+    interp_hw_t *interp = interp0;
+    while (len--) {
+        uint32_t ctrl = interp->ctrl[0];
+        const uint8_t *src = (const uint8_t *) interp->pop[2];
+        if (!(ctrl & SIO_INTERP0_CTRL_LANE0_OVERF_BITS)) {
+            uint8_t p = *src;
+            if (p & ALPHA_MASK_8BPP)
+                dst[len] = p;
+        }
+    }
+}
+
+void __ram_func(sprite_ablit16_loop)(uint16_t *dst, uint len) {
+    interp_hw_t *interp = interp0;
+    while (len--) {
+        uint32_t ctrl = interp->ctrl[0];
+        const uint16_t *src = (const uint16_t *) interp->pop[2];
+        if (!(ctrl & SIO_INTERP0_CTRL_LANE0_OVERF_BITS))
+            dst[len] = *src;
+    }
+}
+
+void __ram_func(sprite_ablit16_alpha_loop)(uint16_t *dst, uint len) {
+    interp_hw_t *interp = interp0;
+    while (len--) {
+        uint32_t ctrl = interp->ctrl[0];
+        const uint16_t *src = (const uint16_t *) interp->pop[2];
+        if (!(ctrl & SIO_INTERP0_CTRL_LANE0_OVERF_BITS)) {
+            uint16_t p = *src;
+            if (p & ALPHA_MASK_16BPP)
+                dst[len] = p;
+        }
+    }
+}
+#endif
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico.h"
+#include "pico/stdlib.h"
+#include "sprite.h"
+
+// Checks the sprite kernels (sprite.S or sprite_kernels.c, whichever this build uses) against straightforward
+// reference loops on random data, lengths and alignments, along with sprite_sprite8/16 and the occlusion culled
+// renderer built on them, then times each kernel. The affine loops need the interpolator, so are only checked and
+// timed on device.
+
+#ifndef SPRITE_BENCH_CASES
+#define SPRITE_BENCH_CASES 20000
+#endif
+
+#ifndef SPRITE_BENCH_TIMING_PASSES
+#define SPRITE_BENCH_TIMING_PASSES 200
+#endif
+
+#define MAX_LEN 700
+// guard pixels either side of the destination, which must not be touched
+#define GUARD 8
+
+static uint16_t __attribute__((aligned(4))) dst_buf[MAX_LEN + 2 * GUARD + 2];
+static uint16_t __attribute__((aligned(4))) ref_buf[MAX_LEN + 2 * GUARD + 2];
+static uint16_t __attribute__((aligned(4))) src_buf[MAX_LEN + 2];
+
+static struct {
+    uint32_t cases;
+    uint32_t failures;
+} results;
+
+static uint32_t rand_state = 0x12345678;
+
+static uint32_t next_rand() {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+static int rand_range(int lo, int hi) {
+    return lo + (int) (next_rand() % (uint32_t) (hi - lo + 1));
+}
+
+static void report_failure(const char *fmt, ...) {
+    results.failures++;
+    if (results.failures <= 20) {
+        va_list args;
+        va_start(args, fmt);
+        printf("FAIL ");
+        vprintf(fmt, args);
+        printf("\n");
+        va_end(args);
+    }
+}
+
+static void randomize(void *buf, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) ((uint8_t *) buf)[i] = next_rand();
+}
+
+static void prepare(size_t bytes) {
+    randomize(dst_buf, bytes);
+    memcpy(ref_buf, dst_buf, bytes);
+    randomize(src_buf, sizeof(src_buf));
+}
+
+enum kernel {
+    FILL8, FILL16, BLIT8, BLIT16, BLIT8_ALPHA, BLIT16_ALPHA, KERNEL_COUNT
+};
+static const char *kernel_names[] = {
+        "sprite_fill8", "sprite_fill16", "sprite_blit8", "sprite_blit16", "sprite_blit8_alpha", "sprite_blit16_alpha"
+};
+
+static void run_kernel(enum kernel k, void *dst, const void *src, uint16_t colour, uint len) {
+    switch (k) {
+        case FILL8: sprite_fill8(dst, colour, len); break;
+        case FILL16: sprite_fill16(dst, colour, len); break;
+        case BLIT8: sprite_blit8(dst, src, len); break;
+        case BLIT16: sprite_blit16(dst, src, len); break;
+        case BLIT8_ALPHA: sprite_blit8_alpha(dst, src, len); break;
+        case BLIT16_ALPHA: sprite_blit16_alpha(dst, src, len); break;
+        default: break;
+    }
+}
+
+// RAGB2132 and RGAB5515 both have alpha in bit 5
+static void run_reference(enum kernel k, void *dst, const void *src, uint16_t colour, uint len) {
+    uint8_t *d8 = dst;
+    uint16_t *d16 = dst;
+    const uint8_t *s8 = src;
+    const uint16_t *s16 = src;
+    for (uint i = 0; i < len; i++) {
+        switch (k) {
+            case FILL8: d8[i] = colour; break;
+            case FILL16: d16[i] = colour; break;
+            case BLIT8: d8[i] = s8[i]; break;
+            case BLIT16: d16[i] = s16[i]; break;
+            case BLIT8_ALPHA: if (s8[i] & 0x20) d8[i] = s8[i]; break;
+            case BLIT16_ALPHA: if (s16[i] & 0x20) d16[i] = s16[i]; break;
+            default: break;
+        }
+    }
+}
+
+static void check_kernels() {
+    for (enum kernel k = 0; k < KERNEL_COUNT; k++) {
+        uint32_t failures = results.failures;
+        bool wide = k == FILL16 || k == BLIT16 || k == BLIT16_ALPHA;
+        for (int i = 0; i < SPRITE_BENCH_CASES; i++) {
+            // every short length (the unrolled loop entry points) and alignment, then random ones
+            int len = i < 64 * 4 ? i / 4 : rand_range(0, MAX_LEN);
+            int dst_offset = wide ? (i & 1) : (i & 3);
+            int src_offset = wide ? ((i >> 1) & 1) : rand_range(0, 3);
+            size_t pixel_bytes = wide ? 2 : 1;
+            uint8_t *dst = (uint8_t *) dst_buf + (GUARD + dst_offset) * pixel_bytes;
+            uint8_t *ref = (uint8_t *) ref_buf + (GUARD + dst_offset) * pixel_bytes;
+            const uint8_t *src = (const uint8_t *) src_buf + src_offset * pixel_bytes;
+            uint16_t colour = next_rand();
+            prepare(sizeof(dst_buf));
+            run_kernel(k, dst, src, colour, len);
+            run_reference(k, ref, src, colour, len);
+            results.cases++;
+            if (memcmp(dst_buf, ref_buf, sizeof(dst_buf))) {
+                report_failure("%s: len %d dst offset %d src offset %d", kernel_names[k], len, dst_offset, src_offset);
+            }
+        }
+        printf("%-20s %d cases, %lu failures\n", kernel_names[k], SPRITE_BENCH_CASES,
+               (unsigned long) (results.failures - failures));
+    }
+}
+
+// a random sprite image with opacity metadata, mostly solid rows with transparent edges
+static void *random_sprite_image(int w, int h, size_t pixel_bytes) {
+    size_t pixels = ((w * h * pixel_bytes + 3) & ~3u);
+    uint8_t *img = malloc(pixels + h * sizeof(uint32_t));
+    uint32_t *meta = (uint32_t *) (img + pixels);
+    for (int y = 0; y < h; y++) {
+        int start = rand_range(0, w), end = rand_range(start, w);
+        bool holes = rand_range(0, 3) == 0;
+        for (int x = 0; x < w; x++) {
+            uint16_t p = next_rand();
+            bool opaque = x >= start && x < end && (!holes || (p & 0x100));
+            p = opaque ? p | 0x20 : p & ~0x20;
+            if (pixel_bytes == 1) img[y * w + x] = p; else ((uint16_t *) img)[y * w + x] = p;
+        }
+        meta[y] = (start << 16) | end | (holes ? 0 : 1u << 31);
+    }
+    return img;
+}
+
+static uint16_t get_pixel(const void *img, int i, size_t pixel_bytes) {
+    return pixel_bytes == 1 ? ((const uint8_t *) img)[i] : ((const uint16_t *) img)[i];
+}
+
+static void set_pixel(void *buf, int i, uint16_t p, size_t pixel_bytes) {
+    if (pixel_bytes == 1) ((uint8_t *) buf)[i] = p; else ((uint16_t *) buf)[i] = p;
+}
+
+// sprite_sprite8/16 against a per pixel reference, on random (square and non-square) sprites and positions
+static void check_sprites() {
+    uint32_t cases = results.cases, failures = results.failures;
+    for (int i = 0; i < SPRITE_BENCH_CASES / 10; i++) {
+        size_t pixel_bytes = (i & 1) ? 2 : 1;
+        sprite_t sp = {0};
+        if (i & 2) {
+            sp.log_size = rand_range(0, 6);
+        } else {
+            sp.width = rand_range(1, 70);
+            sp.height = rand_range(1, 70);
+        }
+        int w = sprite_width(&sp), h = sprite_height(&sp);
+        void *img = random_sprite_image(w, h, pixel_bytes);
+        sp.img = img;
+        sp.has_opacity_metadata = i & 4;
+        uint raster_w = rand_range(1, MAX_LEN);
+        sp.x = rand_range(-w, raster_w);
+        sp.y = rand_range(-h, 10);
+        for (uint y = 0; y < 10; y++) {
+            prepare(sizeof(dst_buf));
+            void *dst = (uint8_t *) dst_buf + GUARD * pixel_bytes;
+            void *ref = (uint8_t *) ref_buf + GUARD * pixel_bytes;
+            if (pixel_bytes == 1) sprite_sprite8(dst, &sp, y, raster_w); else sprite_sprite16(dst, &sp, y, raster_w);
+            int ty = (int) y - sp.y;
+            for (int x = 0; ty >= 0 && ty < h && x < w; x++) {
+                uint16_t p = get_pixel(img, ty * w + x, pixel_bytes);
+                if (sp.x + x >= 0 && sp.x + x < (int) raster_w && (p & 0x20)) set_pixel(ref, sp.x + x, p, pixel_bytes);
+            }
+            results.cases++;
+            if (memcmp(dst_buf, ref_buf, sizeof(dst_buf))) {
+                report_failure("sprite_sprite%d: %dx%d at %d,%d raster_y %d", (int) pixel_bytes * 8, w, h, sp.x, sp.y,
+                               y);
+            }
+        }
+        free(img);
+    }
+    printf("sprites: %lu cases, %lu failures\n", (unsigned long) (results.cases - cases),
+           (unsigned long) (results.failures - failures));
+}
+
+// the culled render must give the same pixels as filling and drawing every sprite
+static void check_culled() {
+    uint32_t cases = results.cases, failures = results.failures;
+    static sprite_coverage_t cov, cov_tiny;
+    sprite_coverage_init(&cov, 8, 24);
+    // so small that the piece overflow fallback and the full coverage list are both hit often
+    sprite_coverage_init(&cov_tiny, 1, 2);
+    sprite_t sprites[24];
+    void *imgs[count_of(sprites)];
+    for (int frame = 0; frame < SPRITE_BENCH_CASES / 200; frame++) {
+        uint count = rand_range(0, count_of(sprites));
+        uint raster_w = rand_range(1, MAX_LEN);
+        for (uint i = 0; i < count; i++) {
+            sprite_t *sp = &sprites[i];
+            memset(sp, 0, sizeof(*sp));
+            sp->width = rand_range(1, 200);
+            sp->height = rand_range(1, 32);
+            imgs[i] = random_sprite_image(sp->width, sp->height, 2);
+            sp->img = imgs[i];
+            sp->has_opacity_metadata = rand_range(0, 3) != 0;
+            sp->x = rand_range(-sp->width, raster_w);
+            sp->y = rand_range(-sp->height, 31);
+        }
+        for (uint y = 0; y < 32; y++) {
+            for (uint tiny = 0; tiny < 2; tiny++) {
+                uint16_t bgcol = next_rand();
+                prepare(sizeof(dst_buf));
+                sprite_fill16(ref_buf + GUARD, bgcol, raster_w);
+                for (uint i = 0; i < count; i++) sprite_sprite16(ref_buf + GUARD, &sprites[i], y, raster_w);
+                sprite_sprites16_culled(dst_buf + GUARD, bgcol, tiny ? &cov_tiny : &cov, sprites, NULL, count, y,
+                                        raster_w);
+                results.cases++;
+                if (memcmp(dst_buf, ref_buf, sizeof(dst_buf))) {
+                    report_failure("sprite_sprites16_culled: %d sprites raster_w %d raster_y %d%s", count, raster_w, y,
+                                   tiny ? " (tiny coverage)" : "");
+                }
+            }
+        }
+        for (uint i = 0; i < count; i++) free(imgs[i]);
+    }
+    printf("culled: %lu cases, %lu failures (%lu lines overflowed; with tiny coverage %lu overflowed, %lu ranges not "
+           "covered)\n", (unsigned long) (results.cases - cases), (unsigned long) (results.failures - failures),
+           (unsigned long) cov.stats.overflows, (unsigned long) cov_tiny.stats.overflows,
+           (unsigned long) cov_tiny.stats.full);
+    if (!cov_tiny.stats.overflows || !cov_tiny.stats.full) {
+        report_failure("sprite_sprites16_culled: tiny coverage didn't reach both fallbacks");
+    }
+}
+
+#if SPRITE_AFFINE
+// Models the interpolator set up by sprite_asprite8/16: the span is walked backward starting from the texture
+// coordinate one past its end, and texels outside the (power of 2) texture are skipped
+static void reference_asprite(void *buf, const sprite_t *sp, const affine_transform_t atrans, uint raster_y,
+                              uint raster_w, size_t pixel_bytes) {
+    int w = sprite_width(sp), h = sprite_height(sp);
+    int tex_offs_y = (int) raster_y - sp->y;
+    if (tex_offs_y < 0 || tex_offs_y >= h) return;
+    int x_start = MAX(0, sp->x);
+    int tex_offs_x = x_start - sp->x;
+    int size_x = MIN(sp->x + w, (int) raster_w) - x_start;
+    if (size_x <= 0) return;
+    int32_t u = mul_fp1616(atrans[0], (tex_offs_x + size_x) * AF_ONE) + mul_fp1616(atrans[1], tex_offs_y * AF_ONE) +
+                atrans[2];
+    int32_t v = mul_fp1616(atrans[3], (tex_offs_x + size_x) * AF_ONE) + mul_fp1616(atrans[4], tex_offs_y * AF_ONE) +
+                atrans[5];
+    for (int i = size_x - 1; i >= 0; i--) {
+        uint32_t tu = (uint32_t) u >> 16, tv = (uint32_t) v >> 16;
+        if (tu < (uint32_t) w && tv < (uint32_t) h) {
+            uint16_t p = get_pixel(sp->img, tv * w + tu, pixel_bytes);
+            if (p & 0x20) set_pixel(buf, x_start + i, p, pixel_bytes);
+        }
+        u -= atrans[0];
+        v -= atrans[3];
+    }
+}
+
+static void random_transform(affine_transform_t atrans, int w, int h) {
+    affine_identity(atrans);
+    if (rand_range(0, 3)) {
+        affine_translate(atrans, -w / 2 * AF_ONE, -h / 2 * AF_ONE);
+        affine_rotate(atrans, next_rand());
+        affine_scale(atrans, rand_range(AF_ONE / 2, 2 * AF_ONE), rand_range(AF_ONE / 2, 2 * AF_ONE));
+        affine_translate(atrans, w / 2 * AF_ONE, h / 2 * AF_ONE);
+    }
+}
+
+static void check_affine() {
+    uint32_t cases = results.cases, failures = results.failures;
+    for (int i = 0; i < SPRITE_BENCH_CASES / 10; i++) {
+        size_t pixel_bytes = (i & 1) ? 2 : 1;
+        sprite_t sp = {0};
+        // (a side of 1 would give an empty interpolator mask)
+        if (i & 2) {
+            sp.log_size = rand_range(1, 6);
+        } else {
+            sp.width = 1u << rand_range(1, 6);
+            sp.height = 1u << rand_range(1, 6);
+        }
+        int w = sprite_width(&sp), h = sprite_height(&sp);
+        void *img = random_sprite_image(w, h, pixel_bytes);
+        sp.img = img;
+        uint raster_w = rand_range(1, MAX_LEN);
+        sp.x = rand_range(-w, raster_w);
+        sp.y = rand_range(-h, 10);
+        affine_transform_t atrans;
+        random_transform(atrans, w, h);
+        for (uint y = 0; y < 10; y++) {
+            prepare(sizeof(dst_buf));
+            void *dst = (uint8_t *) dst_buf + GUARD * pixel_bytes;
+            if (pixel_bytes == 1) {
+                sprite_asprite8(dst, &sp, atrans, y, raster_w);
+            } else {
+                sprite_asprite16(dst, &sp, atrans, y, raster_w);
+            }
+            reference_asprite((uint8_t *) ref_buf + GUARD * pixel_bytes, &sp, atrans, y, raster_w, pixel_bytes);
+            results.cases++;
+            if (memcmp(dst_buf, ref_buf, sizeof(dst_buf))) {
+                report_failure("sprite_asprite%d: %dx%d at %d,%d raster_y %d", (int) pixel_bytes * 8, w, h, sp.x, sp.y,
+                               y);
+            }
+        }
+        free(img);
+    }
+    printf("affine sprites: %lu cases, %lu failures\n", (unsigned long) (results.cases - cases),
+           (unsigned long) (results.failures - failures));
+}
+#endif
+
+static void time_kernels(uint len) {
+    prepare(sizeof(dst_buf));
+    for (uint i = 0; i < MAX_LEN; i++) src_buf[i] |= (i & 1) ? 0x20 : 0; // about 3/4 opaque for the alpha blits
+    uint reps = SPRITE_BENCH_TIMING_PASSES * (MAX_LEN / len);
+    for (enum kernel k = 0; k < KERNEL_COUNT; k++) {
+        absolute_time_t start = get_absolute_time();
+        for (uint i = 0; i < reps; i++) run_kernel(k, dst_buf, src_buf, i, len);
+        int64_t us = absolute_time_diff_us(start, get_absolute_time());
+        if (us <= 0) us = 1;
+        printf("%-20s %4d pixels %8.1f Mpixels/s\n", kernel_names[k], len, reps * len / (double) us);
+    }
+#if SPRITE_AFFINE
+    // the affine loops via sprite_asprite16, with an identity transform on a sprite wider than the span
+    static uint16_t __attribute__((aligned(4))) texture[MAX_LEN * 2];
+    sprite_t sp = {.img = texture, .width = 1024, .height = 1};
+    affine_transform_t atrans;
+    affine_identity(atrans);
+    absolute_time_t start = get_absolute_time();
+    for (uint i = 0; i < reps; i++) sprite_asprite16(dst_buf, &sp, atrans, 0, len);
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    if (us <= 0) us = 1;
+    printf("%-20s %4d pixels %8.1f Mpixels/s (including interpolator setup)\n", "sprite_asprite16", len,
+           reps * len / (double) us);
+#endif
+}
+
+int main() {
+    stdio_init_all();
+
+    check_kernels();
+    check_sprites();
+    check_culled();
+#if SPRITE_AFFINE
+    check_affine();
+#endif
+    if (results.failures) {
+        printf("%lu of %lu cases FAILED\n", (unsigned long) results.failures, (unsigned long) results.cases);
+    } else {
+        printf("all %lu cases passed\n", (unsigned long) results.cases);
+    }
+
+    time_kernels(640);
+    time_kernels(16);
+    return 0;
+}
@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "pico.h"
 #include "hardware/uart.h"
@@ -27,7 +28,16 @@
 #define VGA_MODE vga_mode_640x480_60
 #define DUAL_CORE_RENDER
 // #define TURBO_BOOST 1
+// todo the berry counts reachable at 640x480 (with and without the options below) are still to be measured on a
+//  device: build with PRINT_SPRITE_STATS and raise this until the worst scanline time nears the time each core has for
+//  a scanline, which with DUAL_CORE_RENDER is two line periods (~63us at 640x480)
 #define N_BERRIES 45
+// bucket the berries by row once per frame, so each scanline only visits the berries on it
+#define USE_SPRITE_LIST
+// render front to back, skipping background and berry pixels hidden behind the solid parts of nearer berries
+//#define FRONT_TO_BACK_RENDER
+// print visible berry counts and worst case scanline render times once a second
+//#define PRINT_SPRITE_STATS
 
 CU_REGISTER_DEBUG_PINS(generation)
 CU_SELECT_DEBUG_PINS(generation)
@@ -123,6 +133,20 @@ sprite_t berry[N_BERRIES];
 int vx[N_BERRIES];
 int vy[N_BERRIES];
 
+#ifdef USE_SPRITE_LIST
+static sprite_list_t berry_list;
+static sprite_list_cursor_t berry_cursor[2];
+#endif
+
+#ifdef FRONT_TO_BACK_RENDER
+static sprite_coverage_t berry_coverage[2];
+#endif
+
+#ifdef PRINT_SPRITE_STATS
+static uint32_t worst_line_us[2];
+static uint max_active[2];
+#endif
+
 void __time_critical_func(render_scanline)(struct scanvideo_scanline_buffer *dest, int core) {
     int l = scanvideo_scanline_number(dest->scanline_id);
     uint16_t *colour_buf = raw_scanline_prepare(dest, VGA_MODE.width);
@@ -130,11 +154,36 @@ void __time_critical_func(render_scanline)(struct scanvideo_scanline_buffer *des
     DEBUG_PINS_SET(generation, (core + 1));
     DEBUG_PINS_SET(generation, 4);
     const uint16_t bgcol = PICO_SCANVIDEO_PIXEL_FROM_RGB8(0x40, 0xc0, 0xff);
+#ifdef PRINT_SPRITE_STATS
+    uint32_t t0 = time_us_32();
+#endif
+#ifdef FRONT_TO_BACK_RENDER
+    // the background is filled as part of the culled render
+    DEBUG_PINS_CLR(generation, 4);
+#ifdef USE_SPRITE_LIST
+    sprite_list_sprite16_culled(colour_buf, bgcol, &berry_coverage[core], &berry_list, &berry_cursor[core], l,
+                                VGA_MODE.width);
+#else
+    sprite_sprites16_culled(colour_buf, bgcol, &berry_coverage[core], berry, NULL, N_BERRIES, l, VGA_MODE.width);
+#endif
+#else
     sprite_fill16(colour_buf, bgcol, VGA_MODE.width);
     DEBUG_PINS_CLR(generation, 4);
 
+#ifdef USE_SPRITE_LIST
+    sprite_list_sprite16(colour_buf, &berry_list, &berry_cursor[core], l, VGA_MODE.width);
+#else
     for (int i = 0; i < N_BERRIES; ++i)
         sprite_sprite16(colour_buf, &berry[i], l, VGA_MODE.width);
+#endif
+#endif
+#ifdef PRINT_SPRITE_STATS
+    uint32_t t = time_us_32() - t0;
+    if (t > worst_line_us[core]) worst_line_us[core] = t;
+#ifdef USE_SPRITE_LIST
+    if (berry_cursor[core].active_count > max_active[core]) max_active[core] = berry_cursor[core].active_count;
+#endif
+#endif
 
     DEBUG_PINS_CLR(generation, (core + 1));
     raw_scanline_finish(dest);
@@ -168,6 +217,34 @@ void __time_critical_func(frame_update_logic)() {
             berry[i].img = vx[i] < 0 ? raspberry_128x128_flip : raspberry_128x128;
         }
     }
+#ifdef USE_SPRITE_LIST
+    sprite_list_update(&berry_list, VGA_MODE.width);
+#endif
+#ifdef PRINT_SPRITE_STATS
+    static uint frames;
+    if (++frames == 60) {
+        // with DUAL_CORE_RENDER each core has two line periods (~63us at 640x480) to render a scanline
+        printf("%d berries", N_BERRIES);
+#ifdef USE_SPRITE_LIST
+        printf(", %d visible, at most %d/%d on a line", berry_list.visible, max_active[0], max_active[1]);
+#endif
+        printf(", worst line %d/%dus", (int) worst_line_us[0], (int) worst_line_us[1]);
+#ifdef FRONT_TO_BACK_RENDER
+        // pixel writes per screen pixel, with and without culling
+        uint32_t written = berry_coverage[0].stats.written + berry_coverage[1].stats.written;
+        uint32_t culled = berry_coverage[0].stats.culled + berry_coverage[1].stats.culled;
+        uint32_t pixels = 60 * VGA_MODE.width * VGA_MODE.height;
+        printf(", overdraw %d%% -> %d%%", (int) ((written + culled) / (pixels / 100)),
+               (int) (written / (pixels / 100)));
+        memset(&berry_coverage[0].stats, 0, sizeof(berry_coverage[0].stats));
+        memset(&berry_coverage[1].stats, 0, sizeof(berry_coverage[1].stats));
+#endif
+        printf("\n");
+        frames = 0;
+        worst_line_us[0] = worst_line_us[1] = 0;
+        max_active[0] = max_active[1] = 0;
+    }
+#endif
 }
 
 int main(void) {
@@ -205,6 +282,16 @@ int main(void) {
         vx[i] = random_velocity();
         vy[i] = random_velocity();
     }
+#ifdef USE_SPRITE_LIST
+    sprite_list_init(&berry_list, berry, N_BERRIES, VGA_MODE.height);
+    sprite_list_update(&berry_list, VGA_MODE.width);
+    sprite_list_cursor_init(&berry_cursor[0], &berry_list);
+    sprite_list_cursor_init(&berry_cursor[1], &berry_list);
+#endif
+#ifdef FRONT_TO_BACK_RENDER
+    sprite_coverage_init(&berry_coverage[0], 32, 256);
+    sprite_coverage_init(&berry_coverage[1], 32, 256);
+#endif
 
     return vga_main();
 }
@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Encodes a paletted image (up to 16 colors) as 4 bit vogon data for the render library, writing C source for the
+// palette32 and image_data (with row_offsets) in the same form as demo1's data.c.
+//
+// Each row is encoded by dynamic programming over the pixel position, trying every command that could start there,
+// so the result is the smallest possible encoding of the row (or the cheapest to decode, with --optimise cycles).
+// The size and estimated decode cost are reported against a simple greedy encoder.
+//
+// Input is binary PPM (P6), or PAM (P7) with TUPLTYPE RGB_ALPHA for translucent colors; convert other formats with
+// e.g. ImageMagick: convert logo.png -colors 16 logo.pam
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vogon_commands.h"
+
+#define MAX_SHORT_COLOR_RUN (0x3f + MIN_COLOR_SPAN_4BIT)
+#define MAX_SHORT_RAW_PAIRS 0x40
+#define MAX_LONG_RUN 0x10000
+
+// rough Cortex-M0+ cycle costs of render_spans' unclipped loop (command dispatch, then the work for the pixels); the
+// point is the relative cost of the commands, not the absolute numbers
+#define CYCLES_COMMAND 12
+#define CYCLES_LONG_LENGTH 6
+#define CYCLES_SINGLE_PIXEL 8
+#define CYCLES_COLOR_RUN 12
+#define CYCLES_RAW_RUN 14
+#define CYCLES_RAW_PAIR 11
+
+enum command {
+    CMD_SINGLE,
+    CMD_COLOR_SHORT,
+    CMD_COLOR_LONG,
+    CMD_RAW_SHORT,
+    CMD_RAW_LONG
+};
+
+static struct {
+    bool optimise_cycles;
+    const char *name;
+    const char *output;
+} options = {false, "image", NULL};
+
+static uint32_t command_bytes(enum command cmd, int length) {
+    switch (cmd) {
+        case CMD_SINGLE:
+            return 1;
+        case CMD_COLOR_SHORT:
+            return 2;
+        case CMD_COLOR_LONG:
+            return 4;
+        case CMD_RAW_SHORT:
+            return 1 + length / 2;
+        default:
+            return 3 + length / 2;
+    }
+}
+
+static uint32_t command_cycles(enum command cmd, int length) {
+    uint32_t cycles = CYCLES_COMMAND;
+    if (cmd == CMD_COLOR_LONG || cmd == CMD_RAW_LONG) cycles += CYCLES_LONG_LENGTH;
+    switch (cmd) {
+        case CMD_SINGLE:
+            return cycles + CYCLES_SINGLE_PIXEL;
+        case CMD_COLOR_SHORT:
+        case CMD_COLOR_LONG:
+            return cycles + CYCLES_COLOR_RUN;
+        default:
+            return cycles + CYCLES_RAW_RUN + (length / 2) * CYCLES_RAW_PAIR;
+    }
+}
+
+// what is minimised: the chosen measure, then the other one to break ties
+static uint64_t command_cost(enum command cmd, int length) {
+    uint64_t bytes = command_bytes(cmd, length), cycles = command_cycles(cmd, length);
+    return options.optimise_cycles ? (cycles << 32) | bytes : (bytes << 32) | cycles;
+}
+
+struct totals {
+    uint64_t bytes;
+    uint64_t cycles;
+    uint32_t commands;
+};
+
+static void add_command(struct totals *totals, enum command cmd, int length) {
+    totals->bytes += command_bytes(cmd, length);
+    totals->cycles += command_cycles(cmd, length);
+    totals->commands++;
+}
+
+static uint8_t *emit_command(uint8_t *out, const uint8_t *pixels, enum command cmd, int length) {
+    switch (cmd) {
+        case CMD_SINGLE:
+            *out++ = SINGLE_PIXEL | pixels[0];
+            break;
+        case CMD_COLOR_SHORT:
+            *out++ = COLOR_PIXELS_SHORT | (length - MIN_COLOR_SPAN_4BIT);
+            *out++ = pixels[0];
+            break;
+        case CMD_COLOR_LONG:
+            *out++ = COLOR_PIXELS_LONG;
+            *out++ = (length - 1) & 0xff;
+            *out++ = (length - 1) >> 8;
+            *out++ = pixels[0];
+            break;
+        case CMD_RAW_SHORT:
+        case CMD_RAW_LONG:
+            if (cmd == CMD_RAW_SHORT) {
+                *out++ = RAW_PIXELS_SHORT | (length / 2 - 1);
+            } else {
+                *out++ = RAW_PIXELS_LONG;
+                *out++ = (length - 1) & 0xff;
+                *out++ = (length - 1) >> 8;
+            }
+            for (int i = 0; i < length; i += 2) {
+                *out++ = pixels[i] | (pixels[i + 1] << 4);
+            }
+            break;
+    }
+    return out;
+}
+
+static enum command color_command(int length) {
+    return length <= MAX_SHORT_COLOR_RUN ? CMD_COLOR_SHORT : CMD_COLOR_LONG;
+}
+
+static enum command raw_command(int length) {
+    return length / 2 <= MAX_SHORT_RAW_PAIRS ? CMD_RAW_SHORT : CMD_RAW_LONG;
+}
+
+// ---------------------------------------------------------------- encoders
+
+// scratch for the row encoders
+static int width;
+static int *same; // same[i] is the length of the run of one color starting at i
+static uint64_t *best; // best[i] is the cost of encoding from i to the end of the row
+static uint8_t *choice_cmd;
+static int *choice_length;
+
+static void find_runs(const uint8_t *pixels) {
+    same[width - 1] = 1;
+    for (int i = width - 2; i >= 0; i--) {
+        same[i] = pixels[i] == pixels[i + 1] ? same[i + 1] + 1 : 1;
+    }
+}
+
+static uint8_t *encode_row_optimal(uint8_t *out, const uint8_t *pixels, struct totals *totals) {
+    find_runs(pixels);
+    best[width] = 0;
+    for (int i = width - 1; i >= 0; i--) {
+        int remaining = width - i;
+#define consider(cmd, length) if (true) { \
+            uint64_t cost = command_cost(cmd, length) + best[i + (length)]; \
+            if (cost < best[i]) { \
+                best[i] = cost; \
+                choice_cmd[i] = cmd; \
+                choice_length[i] = length; \
+            } \
+        } else __builtin_unreachable()
+        best[i] = UINT64_MAX;
+        consider(CMD_SINGLE, 1);
+        int max_run = same[i] < MAX_LONG_RUN ? same[i] : MAX_LONG_RUN;
+        for (int length = MIN_COLOR_SPAN_4BIT; length <= max_run; length++) {
+            consider(color_command(length), length);
+        }
+        int max_raw = remaining < MAX_LONG_RUN ? remaining : MAX_LONG_RUN;
+        for (int length = 2; length <= max_raw; length += 2) {
+            consider(raw_command(length), length);
+        }
+#undef consider
+    }
+    for (int i = 0; i < width; i += choice_length[i]) {
+        out = emit_command(out, pixels + i, choice_cmd[i], choice_length[i]);
+        add_command(totals, choice_cmd[i], choice_length[i]);
+    }
+    *out++ = END_OF_LINE;
+    totals->bytes++;
+    return out;
+}
+
+// color runs wherever there are enough of the same color, raw pixels in between (with a single pixel for an odd one)
+static uint8_t *encode_row_greedy(uint8_t *out, const uint8_t *pixels, struct totals *totals) {
+    find_runs(pixels);
+    int i = 0;
+    while (i < width) {
+        if (same[i] >= MIN_COLOR_SPAN_4BIT) {
+            int length = same[i] < MAX_LONG_RUN ? same[i] : MAX_LONG_RUN;
+            out = emit_command(out, pixels + i, color_command(length), length);
+            add_command(totals, color_command(length), length);
+            i += length;
+            continue;
+        }
+        int end = i;
+        while (end < width && same[end] < MIN_COLOR_SPAN_4BIT && end - i < 2 * MAX_SHORT_RAW_PAIRS) end++;
+        int length = (end - i) & ~1;
+        if (length) {
+            out = emit_command(out, pixels + i, CMD_RAW_SHORT, length);
+            add_command(totals, CMD_RAW_SHORT, length);
+            i += length;
+        }
+        if (i < end) {
+            out = emit_command(out, pixels + i, CMD_SINGLE, 1);
+            add_command(totals, CMD_SINGLE, 1);
+            i++;
+        }
+    }
+    *out++ = END_OF_LINE;
+    totals->bytes++;
+    return out;
+}
+
+// decodes a row to check the encoding
+static bool decode_row(const uint8_t *encoding, const uint8_t *pixels) {
+    int x = 0;
+    while (true) {
+        uint8_t c = *encoding++;
+        int length;
+        if (c == END_OF_LINE) {
+            return x == width;
+        } else if ((c & 0xc0) == RAW_PIXELS_SHORT || c == RAW_PIXELS_LONG) {
+            if (c == RAW_PIXELS_LONG) {
+                length = 1 + encoding[0] + (encoding[1] << 8);
+                encoding += 2;
+            } else {
+                length = ((c & 0x3f) + 1) * 2;
+            }
+            if (x + length > width) return false;
+            for (int i = 0; i < length; i += 2, encoding++) {
+                if (pixels[x++] != (*encoding & 0xf) || pixels[x++] != (*encoding >> 4)) return false;
+            }
+        } else if ((c & 0xc0) == COLOR_PIXELS_SHORT || c == COLOR_PIXELS_LONG) {
+            if (c == COLOR_PIXELS_LONG) {
+                length = 1 + encoding[0] + (encoding[1] << 8);
+                encoding += 2;
+            } else {
+                length = (c & 0x3f) + MIN_COLOR_SPAN_4BIT;
+            }
+            if (x + length > width) return false;
+            for (int i = 0; i < length; i++) {
+                if (pixels[x++] != *encoding) return false;
+            }
+            encoding++;
+        } else if ((c & 0xf0) == SINGLE_PIXEL) {
+            if (x == width || pixels[x++] != (c & 0xf)) return false;
+        } else {
+            return false;
+        }
+    }
+}
+
+// ---------------------------------------------------------------- input
+
+static int height;
+static uint8_t *indices;
+static uint32_t palette[16]; // 0xAABBGGRR as in palette32
+static int palette_size;
+
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "%s%s%s\n", message, detail ? ": " : "", detail ? detail : "");
+    exit(1);
+}
+
+static int read_token(FILE *f, char *token, int size) {
+    int c, n = 0;
+    do {
+        c = fgetc(f);
+        if (c == '#') {
+            while (c != '\n' && c != EOF) c = fgetc(f);
+        }
+    } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+    while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' && n < size - 1) {
+        token[n++] = (char) c;
+        c = fgetc(f);
+    }
+    token[n] = 0;
+    return n;
+}
+
+static void read_image(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) fail("Can't open", filename);
+    char token[64];
+    int maxval = 0, depth = 3;
+    read_token(f, token, sizeof(token));
+    if (!strcmp(token, "P6")) {
+        read_token(f, token, sizeof(token));
+        width = atoi(token);
+        read_token(f, token, sizeof(token));
+        height = atoi(token);
+        read_token(f, token, sizeof(token));
+        maxval = atoi(token);
+    } else if (!strcmp(token, "P7")) {
+        while (read_token(f, token, sizeof(token)) && strcmp(token, "ENDHDR")) {
+            char value[64];
+            read_token(f, value, sizeof(value));
+            if (!strcmp(token, "WIDTH")) width = atoi(value);
+            else if (!strcmp(token, "HEIGHT")) height = atoi(value);
+            else if (!strcmp(token, "DEPTH")) depth = atoi(value);
+            else if (!strcmp(token, "MAXVAL")) maxval = atoi(value);
+        }
+        if (depth != 3 && depth != 4) fail("Only RGB or RGB_ALPHA PAM files are supported", filename);
+    } else {
+        fail("Not a binary PPM (P6) or PAM (P7) file", filename);
+    }
+    if (width <= 0 || width > 0xffff || height <= 0 || maxval != 255) fail("Unsupported image size or depth", filename);
+    uint8_t *rgba = malloc((size_t) width * height * depth);
+    indices = malloc((size_t) width * height);
+    if (fread(rgba, depth, (size_t) width * height, f) != (size_t) width * height) fail("Truncated image", filename);
+    fclose(f);
+    for (size_t i = 0; i < (size_t) width * height; i++) {
+        const uint8_t *p = rgba + i * depth;
+        uint32_t alpha = depth == 4 ? p[3] : 0xff;
+        // fully transparent pixels are all the same color
+        uint32_t color = alpha ? (alpha << 24) | (p[2] << 16) | (p[1] << 8) | p[0] : 0;
+        int n;
+        for (n = 0; n < palette_size && palette[n] != color; n++);
+        if (n == palette_size) {
+            if (palette_size == 16) fail("Image has more than 16 colors", filename);
+            palette[palette_size++] = color;
+        }
+        indices[i] = n;
+    }
+    free(rgba);
+}
+
+// ---------------------------------------------------------------- output
+
+static void write_bytes(FILE *out, const char *name, const char *type, const void *data, int count, int size) {
+    fprintf(out, "__const_data %s %s[] = {", type, name);
+    for (int i = 0; i < count; i++) {
+        if (!(i % (size == 1 ? 16 : 12))) fprintf(out, "\n        ");
+        if (size == 1) {
+            fprintf(out, "0x%02x, ", ((const uint8_t *) data)[i]);
+        } else {
+            fprintf(out, "0x%04x, ", ((const uint16_t *) data)[i]);
+        }
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+static void write_source(FILE *out, const uint8_t *encoding, int size, const uint16_t *row_offsets) {
+    const char *name = options.name;
+    bool opaque = false, semi = false, transparent = false;
+    for (int i = 0; i < palette_size; i++) {
+        uint32_t alpha = palette[i] >> 24;
+        opaque |= alpha == 0xff;
+        semi |= alpha && alpha != 0xff;
+        transparent |= !alpha;
+    }
+    fprintf(out, "// generated by vogon_encoder\n\n#include \"pico.h\"\n#include \"image.h\"\n\n");
+    fprintf(out, "#ifndef __const_data\n#define __const_data const\n#endif\n\n");
+    fprintf(out, "__const_data struct palette32 %s_palette = {\n        .size = %d,\n        .flags = ", name,
+            palette_size);
+    const char *sep = "";
+    if (opaque) fprintf(out, "%sCF_HAS_OPAQUE", sep), sep = " | ";
+    if (semi) fprintf(out, "%sCF_HAS_SEMI_TRANSPARENT", sep), sep = " | ";
+    if (transparent) fprintf(out, "%sCF_HAS_TRANSPARENT", sep);
+    fprintf(out, ",\n        .entries = {\n");
+    for (int i = 0; i < palette_size; i++) {
+        fprintf(out, "                0x%08x%s\n", palette[i], i == palette_size - 1 ? "" : ",");
+    }
+    fprintf(out, "        }\n};\n\n");
+    char array_name[128];
+    snprintf(array_name, sizeof(array_name), "%s_image_data_bytes", name);
+    write_bytes(out, array_name, "uint8_t", encoding, size, 1);
+    snprintf(array_name, sizeof(array_name), "%s_image_data_offsets", name);
+    write_bytes(out, array_name, "uint16_t", row_offsets, height + 1, 2);
+    fprintf(out, "__const_data struct image_data %s_image_data = {\n"
+                 "        .format = IMG_FMT_4BIT_VOGON,\n"
+                 "        .width = %d,\n"
+                 "        .height = %d,\n"
+                 "        .blob = {\n"
+                 "                .size = sizeof(%s_image_data_bytes),\n"
+                 "                .bytes = %s_image_data_bytes\n"
+                 "        },\n"
+                 "        .row_offsets = %s_image_data_offsets\n"
+                 "};\n", name, width, height, name, name, name);
+}
+
+static void report(const char *name, const struct totals *totals) {
+    fprintf(stderr, "%-8s %8llu bytes (%5.1f per row), %6u commands, ~%8llu cycles (%6.1f per row)\n", name,
+            (unsigned long long) totals->bytes, totals->bytes / (double) height, totals->commands,
+            (unsigned long long) totals->cycles, totals->cycles / (double) height);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: vogon_encoder [--optimise bytes|cycles] [--name <name>] [-o <file.c>] <image.ppm|pam>\n\n"
+                    "Writes C source for <name>_palette and <name>_image_data (to stdout by default).\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--optimise") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "cycles")) options.optimise_cycles = true;
+            else if (strcmp(argv[i], "bytes")) usage();
+        } else if (!strcmp(argv[i], "--name") && i + 1 < argc) {
+            options.name = argv[++i];
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (argv[i][0] == '-' || input) {
+            usage();
+        } else {
+            input = argv[i];
+        }
+    }
+    if (!input) usage();
+    read_image(input);
+
+    same = malloc(width * sizeof(int));
+    best = malloc((width + 1) * sizeof(uint64_t));
+    choice_cmd = malloc(width);
+    choice_length = malloc(width * sizeof(int));
+    // worst case is a long raw run per row
+    size_t max_size = (size_t) height * (width / 2 + 8);
+    uint8_t *encoding = malloc(max_size);
+    uint8_t *greedy_encoding = malloc(max_size);
+    uint16_t *row_offsets = malloc((height + 1) * sizeof(uint16_t));
+    struct totals optimal = {0}, greedy = {0};
+    uint8_t *out = encoding, *greedy_out = greedy_encoding;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *pixels = indices + (size_t) y * width;
+        if (out - encoding > 0xffff) fail("Encoded image is too big for 16 bit row offsets", NULL);
+        row_offsets[y] = out - encoding;
+        out = encode_row_optimal(out, pixels, &optimal);
+        if (!decode_row(encoding + row_offsets[y], pixels)) fail("Internal error: bad encoding", NULL);
+        const uint8_t *greedy_row = greedy_out;
+        greedy_out = encode_row_greedy(greedy_out, pixels, &greedy);
+        if (!decode_row(greedy_row, pixels)) fail("Internal error: bad greedy encoding", NULL);
+    }
+    if (out - encoding > 0xffff) fail("Encoded image is too big for 16 bit row offsets", NULL);
+    row_offsets[height] = out - encoding;
+
+    fprintf(stderr, "%s: %dx%d, %d colors, optimising %s\n", input, width, height, palette_size,
+            options.optimise_cycles ? "decode cycles" : "size");
+    report("greedy", &greedy);
+    report("optimal", &optimal);
+    fprintf(stderr, "         %+.1f%% bytes, %+.1f%% cycles\n",
+            100.0 * ((double) optimal.bytes - (double) greedy.bytes) / (double) greedy.bytes,
+            100.0 * ((double) optimal.cycles - (double) greedy.cycles) / (double) greedy.cycles);
+
+    FILE *f = options.output ? fopen(options.output, "w") : stdout;
+    if (!f) fail("Can't create", options.output);
+    write_source(f, encoding, (int) (out - encoding), row_offsets);
+    if (f != stdout) fclose(f);
+    return 0;
+}